@@ -0,0 +1,109 @@
+#ifndef ALIGNEDBUFFER_H
+#define ALIGNEDBUFFER_H
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <valarray>
+
+// Tag of the constructors that leave elements uninitialized
+struct Uninitialized {};
+
+//---------------------------------------------------------
+// AlignedBuffer class
+// Contiguous array of trivial T whose first element is aligned to
+// Alignment bytes (a cache line by default), for aligned vector
+// loads of the whole array. Elements are zero initialized unless
+// constructed with Uninitialized, for arrays that are overwritten
+// immediately.
+//
+// Converts to std::valarray<T> and supports operator[]( slice ) for
+// code written against the valarray storage of DataFrame.
+//---------------------------------------------------------
+template< class T, size_t Alignment = 64 >
+class AlignedBuffer {
+
+    static_assert( std::is_trivial< T >::value,
+                   "AlignedBuffer: T must be a trivial type" );
+    static_assert( Alignment and not ( Alignment & ( Alignment - 1 ) ),
+                   "AlignedBuffer: Alignment must be a power of 2" );
+
+    T      *elements;
+    size_t  N;
+
+    static T *Allocate( size_t N ) {
+        if ( N == 0 ) { return nullptr; }
+        // Whole lines: a vector load of the tail stays in the allocation
+        size_t bytes = ( N * sizeof( T ) + Alignment - 1 ) &
+                       ~( Alignment - 1 );
+        void  *p     = nullptr;
+        if ( posix_memalign( &p, Alignment, bytes ) ) {
+            throw std::bad_alloc();
+        }
+        // Zero the padding after the last element
+        std::memset( static_cast< char * >( p ) + N * sizeof( T ), 0,
+                     bytes - N * sizeof( T ) );
+        return static_cast< T * >( p );
+    }
+
+public:
+    AlignedBuffer() : elements( nullptr ), N( 0 ) {}
+
+    explicit AlignedBuffer( size_t N ) : elements( Allocate( N ) ), N( N ) {
+        if ( N ) { std::memset( elements, 0, N * sizeof( T ) ); }
+    }
+
+    AlignedBuffer( size_t N, Uninitialized ) :
+        elements( Allocate( N ) ), N( N ) {}
+
+    AlignedBuffer( const AlignedBuffer &other ) :
+        elements( Allocate( other.N ) ), N( other.N ) {
+        if ( N ) { std::memcpy( elements, other.elements, N * sizeof( T ) ); }
+    }
+
+    AlignedBuffer( AlignedBuffer &&other ) :
+        elements( other.elements ), N( other.N ) {
+        other.elements = nullptr;
+        other.N        = 0;
+    }
+
+    AlignedBuffer &operator=( AlignedBuffer other ) {
+        std::swap( elements, other.elements );
+        std::swap( N,        other.N        );
+        return *this;
+    }
+
+    ~AlignedBuffer() { std::free( elements ); }
+
+    size_t size() const { return N; }
+
+    T       *data()       { return elements; }
+    const T *data() const { return elements; }
+
+    T       &operator[]( size_t i )       { return elements[ i ]; }
+    const T &operator[]( size_t i ) const { return elements[ i ]; }
+
+    T       *begin()       { return elements; }
+    T       *end()         { return elements + N; }
+    const T *begin() const { return elements; }
+    const T *end()   const { return elements + N; }
+
+    //-----------------------------------------------------------------
+    // valarray compatibility
+    //-----------------------------------------------------------------
+    std::valarray< T > operator[]( std::slice s ) const {
+        std::valarray< T > values( s.size() );
+        for ( size_t i = 0; i < s.size(); i++ ) {
+            values[ i ] = elements[ s.start() + i * s.stride() ];
+        }
+        return values;
+    }
+
+    operator std::valarray< T >() const {
+        return std::valarray< T >( elements, N );
+    }
+};
+
+#endif
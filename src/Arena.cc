@@ -0,0 +1,109 @@
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "Arena.h"
+#include "Profile.h"
+
+namespace {
+    thread_local Arena *currentArena = nullptr;
+}
+
+//----------------------------------------------------------------
+// Arena
+//----------------------------------------------------------------
+Arena::Arena( size_t blockBytes ) :
+    block_i( 0 ), offset( 0 ), blockBytes( blockBytes ),
+    allocations( 0 ), systemAllocations( 0 ) {}
+
+Arena::~Arena() { Release(); }
+
+//----------------------------------------------------------------
+// Bump allocation in the current block, else the next block that
+// fits, else a new block of at least blockBytes
+//----------------------------------------------------------------
+void *Arena::Allocate( size_t bytes, size_t alignment ) {
+
+    EDM_PROFILE_COUNT( ArenaAllocations, 1 );
+    allocations++;
+
+    for ( ; block_i < blocks.size(); block_i++, offset = 0 ) {
+        Block    &block   = blocks[ block_i ];
+        uintptr_t address = (uintptr_t) block.data + offset;
+        size_t    start   = offset +
+            ( alignment - address % alignment ) % alignment;
+
+        if ( start + bytes <= block.size ) {
+            offset = start + bytes;
+            return block.data + start;
+        }
+        if ( block_i + 1 == blocks.size() ) { break; }
+    }
+
+    // New block, aligned by malloc to max_align_t
+    Block block;
+    block.size = std::max( blockBytes, bytes + alignment );
+    block.data = static_cast< char * >( std::malloc( block.size ) );
+    if ( not block.data ) { throw std::bad_alloc(); }
+    systemAllocations++;
+
+    blocks.push_back( block );
+    block_i = blocks.size() - 1;
+
+    uintptr_t address = (uintptr_t) block.data;
+    size_t    start   = ( alignment - address % alignment ) % alignment;
+    offset = start + bytes;
+    return block.data + start;
+}
+
+//----------------------------------------------------------------
+void Arena::Rewind( const Mark &mark ) {
+    if ( mark.block_i < blocks.size() ) {
+        block_i = mark.block_i;
+        offset  = mark.offset;
+    }
+    else { // blocks released since the mark
+        block_i = 0;
+        offset  = 0;
+    }
+}
+
+//----------------------------------------------------------------
+void Arena::Release() {
+    for ( auto &block : blocks ) { std::free( block.data ); }
+    blocks.clear();
+    block_i = 0;
+    offset  = 0;
+}
+
+//----------------------------------------------------------------
+size_t Arena::BytesReserved() const {
+    size_t bytes = 0;
+    for ( auto &block : blocks ) { bytes += block.size; }
+    return bytes;
+}
+
+//----------------------------------------------------------------
+// Thread arena and scopes
+//----------------------------------------------------------------
+Arena &ThreadArena() {
+    thread_local Arena threadArena;
+    return currentArena ? *currentArena : threadArena;
+}
+
+ArenaScope::ArenaScope() :
+    arena( ThreadArena() ), mark( arena.Position() ),
+    previous( currentArena ), installed( false ) {}
+
+ArenaScope::ArenaScope( Arena &arena ) :
+    arena( arena ), mark( arena.Position() ),
+    previous( currentArena ), installed( true ) {
+    currentArena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+    arena.Rewind( mark );
+    if ( installed ) { currentArena = previous; }
+}
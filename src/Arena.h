@@ -0,0 +1,123 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+//---------------------------------------------------------
+// Arena class
+// Monotonic memory for call scoped temporaries: Allocate() bumps an
+// offset in a list of blocks, deallocation is a no-op. Memory is
+// returned to the arena by rewinding to a Mark, the blocks are kept
+// and reused by the next allocations.
+//
+// Not thread safe: each thread uses its own arena, ThreadArena().
+//---------------------------------------------------------
+class Arena {
+
+    struct Block {
+        char  *data;
+        size_t size;
+    };
+
+    std::vector< Block > blocks;
+    size_t               block_i;     // current block
+    size_t               offset;      // first free byte of blocks[ block_i ]
+    size_t               blockBytes;  // minimum size of a new block
+    size_t               allocations; // Allocate() calls served
+    size_t               systemAllocations; // blocks allocated
+
+public:
+    struct Mark {
+        size_t block_i;
+        size_t offset;
+    };
+
+    explicit Arena( size_t blockBytes = 64 * 1024 );
+    ~Arena();
+
+    Arena( const Arena & )            = delete;
+    Arena &operator=( const Arena & ) = delete;
+
+    void *Allocate( size_t bytes,
+                    size_t alignment = alignof( std::max_align_t ) );
+
+    Mark Position() const { return { block_i, offset }; }
+    void Rewind( const Mark &mark );
+
+    // Return the memory of all blocks to the system
+    void Release();
+
+    size_t Allocations()       const { return allocations;       }
+    size_t SystemAllocations() const { return systemAllocations; }
+    size_t BytesReserved()     const;
+};
+
+//---------------------------------------------------------
+// Arena of the calling thread: the innermost ArenaScope arena, or a
+// thread local arena kept for the life of the thread so that its
+// blocks are reused by every call on the thread.
+//---------------------------------------------------------
+Arena &ThreadArena();
+
+//---------------------------------------------------------
+// ArenaScope class
+// Allocations from arena within the scope are released at the end of
+// the scope. ArenaScope( arena ) also makes arena the ThreadArena() of
+// the scope: the hook to run calls on a caller owned arena, as a batch
+// worker reusing one arena across its jobs.
+//---------------------------------------------------------
+class ArenaScope {
+    Arena      &arena;
+    Arena::Mark mark;
+    Arena      *previous;  // ThreadArena() of the enclosing scope
+    bool        installed;
+
+public:
+    ArenaScope();                        // scope on ThreadArena()
+    explicit ArenaScope( Arena &arena ); // install arena for the scope
+    ~ArenaScope();
+
+    ArenaScope( const ArenaScope & )            = delete;
+    ArenaScope &operator=( const ArenaScope & ) = delete;
+
+    Arena &Get() { return arena; }
+};
+
+//---------------------------------------------------------
+// Standard allocator on an Arena, ThreadArena() by default.
+// Containers must not outlive the ArenaScope they are created in.
+//---------------------------------------------------------
+template< class T >
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    Arena *arena;
+
+    ArenaAllocator() : arena( &ThreadArena() ) {}
+    explicit ArenaAllocator( Arena &arena ) : arena( &arena ) {}
+    template< class U >
+    ArenaAllocator( const ArenaAllocator< U > &other ) :
+        arena( other.arena ) {}
+
+    T *allocate( size_t N ) {
+        return static_cast< T * >( arena->Allocate( N * sizeof( T ),
+                                                    alignof( T ) ) );
+    }
+    void deallocate( T *, size_t ) {}
+
+    template< class U >
+    bool operator==( const ArenaAllocator< U > &other ) const {
+        return arena == other.arena;
+    }
+    template< class U >
+    bool operator!=( const ArenaAllocator< U > &other ) const {
+        return arena != other.arena;
+    }
+};
+
+template< class T >
+using ArenaVector = std::vector< T, ArenaAllocator< T > >;
+
+#endif
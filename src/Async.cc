@@ -0,0 +1,137 @@
+
+#include "Async.h"
+#include "ThreadPool.h"
+
+namespace {
+    // Job of the calling thread, nullptr outside asynchronous jobs
+    thread_local const AsyncControl *currentJob = nullptr;
+
+    //------------------------------------------------------------
+    // Control and messages of the job for the scope of a job task
+    //------------------------------------------------------------
+    class JobScope {
+        const AsyncControl *previous;
+        MessageScope        messages;
+
+    public:
+        explicit JobScope( const AsyncControl &control ) :
+            previous( currentJob ), messages( control.Messages() ) {
+            currentJob = &control;
+        }
+        ~JobScope() { currentJob = previous; }
+    };
+
+    //------------------------------------------------------------
+    // Run job as a task of the shared pool, its value or exception
+    // to the future
+    //------------------------------------------------------------
+    template< class T >
+    std::future< T > Submit( const AsyncControl    &control,
+                             std::function< T() >   job ) {
+
+        std::shared_ptr< std::promise< T > >
+            promise = std::make_shared< std::promise< T > >();
+        std::future< T > future = promise->get_future();
+
+        SharedThreadPool().Submit( [ control, job, promise ]() {
+            try {
+                if ( control.Cancelled() ) { throw AsyncCancelled(); }
+                JobScope scope( control );
+                promise->set_value( job() );
+            }
+            catch ( ... ) {
+                promise->set_exception( std::current_exception() );
+            }
+        } );
+
+        return future;
+    }
+}
+
+//----------------------------------------------------------------
+// AsyncControl
+//----------------------------------------------------------------
+AsyncControl::AsyncControl( ProgressHandler progress,
+                            MessageHandler  messages ) :
+    state( std::make_shared< State >() ) {
+    state->cancelled = false;
+    state->progress  = progress;
+    state->messages  = messages;
+}
+
+//----------------------------------------------------------------
+// Cancellation check each row, progress each 1% of the rows
+//----------------------------------------------------------------
+void ReportProgress( const char *stage, size_t done, size_t total ) {
+
+    if ( not currentJob ) { return; }
+
+    if ( currentJob->Cancelled() ) { throw AsyncCancelled(); }
+
+    const ProgressHandler &progress = currentJob->Progress();
+    size_t step = std::max( total / 100, (size_t) 1 );
+    if ( progress and ( done % step == 0 or done == total ) ) {
+        progress( stage, done, total );
+    }
+}
+
+//----------------------------------------------------------------
+// Simplex
+//----------------------------------------------------------------
+std::future< DataFrame<double> > SimplexAsync( AsyncControl control,
+                                               std::string  pathIn,
+                                               std::string  dataFile,
+                                               std::string  pathOut,
+                                               std::string  predictFile,
+                                               std::string  lib,
+                                               std::string  pred,
+                                               int          E,
+                                               int          Tp,
+                                               int          knn,
+                                               int          tau,
+                                               std::string  columns,
+                                               std::string  target,
+                                               bool         embedded,
+                                               bool         verbose,
+                                               std::string  neighborCache ) {
+
+    std::function< DataFrame<double>() > job = [=]() {
+        return Simplex( pathIn, dataFile, pathOut, predictFile, lib, pred,
+                        E, Tp, knn, tau, columns, target, embedded,
+                        verbose, neighborCache );
+    };
+
+    return Submit( control, job );
+}
+
+//----------------------------------------------------------------
+// SMap
+//----------------------------------------------------------------
+std::future< SMapValues > SMapAsync( AsyncControl control,
+                                     std::string  pathIn,
+                                     std::string  dataFile,
+                                     std::string  pathOut,
+                                     std::string  predictFile,
+                                     std::string  lib,
+                                     std::string  pred,
+                                     int          E,
+                                     int          Tp,
+                                     int          knn,
+                                     int          tau,
+                                     double       theta,
+                                     std::string  columns,
+                                     std::string  target,
+                                     std::string  smapFile,
+                                     std::string  jacobians,
+                                     bool         embedded,
+                                     bool         verbose,
+                                     std::string  neighborCache ) {
+
+    std::function< SMapValues() > job = [=]() {
+        return SMap( pathIn, dataFile, pathOut, predictFile, lib, pred,
+                     E, Tp, knn, tau, theta, columns, target, smapFile,
+                     jacobians, embedded, verbose, neighborCache );
+    };
+
+    return Submit( control, job );
+}
@@ -0,0 +1,106 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// Thrown out of a cancelled job, and by the future of a job
+// cancelled before it started
+//---------------------------------------------------------
+class AsyncCancelled : public std::runtime_error {
+public:
+    AsyncCancelled() : std::runtime_error( "EDM job cancelled.\n" ) {}
+};
+
+// Progress of a stage of a job: done of total rows
+typedef std::function< void( const std::string &stage,
+                             size_t done, size_t total ) > ProgressHandler;
+
+//---------------------------------------------------------
+// AsyncControl class
+// Handle on an asynchronous job, copies share the job state.
+//
+// Cancel() stops the job at its next progress point: the future then
+// throws AsyncCancelled. progress is called on the job thread as the
+// prediction rows of FindNeighbors() and of the projection are done,
+// about 100 times per stage. messages receives the verbose messages
+// of the job, they are discarded if it is null: a job writes nothing
+// to std::cout.
+//---------------------------------------------------------
+class AsyncControl {
+
+    struct State {
+        std::atomic< bool > cancelled;
+        ProgressHandler     progress;
+        MessageHandler      messages;
+    };
+
+    std::shared_ptr< State > state;
+
+public:
+    explicit AsyncControl( ProgressHandler progress = nullptr,
+                           MessageHandler  messages = nullptr );
+
+    void Cancel()          { state->cancelled = true; }
+    bool Cancelled() const { return state->cancelled; }
+
+    const ProgressHandler &Progress() const { return state->progress; }
+    const MessageHandler  &Messages() const { return state->messages; }
+};
+
+//---------------------------------------------------------
+// Progress point of the row loops: throws AsyncCancelled if the job
+// of the calling thread is cancelled, else reports done of total rows
+// of stage. No-op outside an asynchronous job.
+//---------------------------------------------------------
+void ReportProgress( const char *stage, size_t done, size_t total );
+
+//---------------------------------------------------------
+// Simplex() and SMap() as tasks of the shared pool (ThreadPool.h),
+// results are collected from the futures as the jobs finish.
+//---------------------------------------------------------
+std::future< DataFrame<double> > SimplexAsync(
+    AsyncControl control      = AsyncControl(),
+    std::string  pathIn       = "./data/",
+    std::string  dataFile     = "",
+    std::string  pathOut      = "./",
+    std::string  predictFile  = "",
+    std::string  lib          = "1  10",
+    std::string  pred         = "11 20",
+    int          E            = 0,
+    int          Tp           = 1,
+    int          knn          = 0,
+    int          tau          = 1,
+    std::string  colNames     = "",
+    std::string  targetName   = "",
+    bool         embedded     = true,
+    bool         verbose      = true,
+    std::string  neighborCache= "" );
+
+std::future< SMapValues > SMapAsync(
+    AsyncControl control         = AsyncControl(),
+    std::string  pathIn          = "./data/",
+    std::string  dataFile        = "",
+    std::string  pathOut         = "./",
+    std::string  predictFile     = "",
+    std::string  lib             = "1  10",
+    std::string  pred            = "11 20",
+    int          E               = 0,
+    int          Tp              = 1,
+    int          knn             = 0,
+    int          tau             = 1,
+    double       theta           = 0,
+    std::string  columns         = "",
+    std::string  target          = "",
+    std::string  smapFile        = "",
+    std::string  jacobians       = "",
+    bool         embedded        = true,
+    bool         verbose         = true,
+    std::string  neighborCache   = "" );
+
+#endif
@@ -5,20 +5,216 @@
 // Common code to Simplex and Smap that loads data,
 // embeds, computes neighbors.
 //----------------------------------------------------------
-DataEmbedNN LoadDataEmbedNN( Parameters  param,
-                             std::string columns ) {
+DataEmbedNN LoadDataEmbedNN( Parameters  &param,
+                             std::string  columns ) {
 
     //----------------------------------------------------------
     // Load data to DataIO
     //----------------------------------------------------------
     DataIO dio = DataIO( param.pathIn, param.dataFile );
 
+    return EmbedNN( dio, param, columns );
+}
+
+//----------------------------------------------------------
+// Common code to Simplex and Smap that embeds data already
+// loaded in dio, and computes neighbors.
+//----------------------------------------------------------
+DataEmbedNN EmbedNN( const DataIO &dio,
+                     Parameters   &param,
+                     std::string   columns ) {
+
+    DataEmbedNN dataEmbedNN = EmbedData( dio, param, columns );
+
+    EmbeddingRows( param, dataEmbedNN );
+
+    FindEmbedNeighbors( dataEmbedNN, param );
+
+    return dataEmbedNN;
+}
+
+//----------------------------------------------------------
+// Data block and target already in memory: block columns are
+// the embedding, target the value of each block row. Time of
+// the output is the row number, 1 for the first row.
+//----------------------------------------------------------
+DataEmbedNN BlockNN( const DataFrame<double>     &block,
+                     const std::valarray<double> &target,
+                     const Parameters            &param ) {
+
+    if ( target.size() != block.NRows() ) {
+        std::stringstream errMsg;
+        errMsg << "BlockNN(): target size " << target.size()
+               << " does not match the " << block.NRows()
+               << " rows of the block.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    DataFrame<double> data( block.NRows(), 2, "Time Target",
+                            Uninitialized() );
+    for ( size_t row = 0; row < block.NRows(); row++ ) {
+        data( row, 0 ) = row + 1;
+        data( row, 1 ) = target[ row ];
+    }
+
+    DataFrame<double> targets( block.NRows(), 1, "Target" );
+    targets.WriteColumn( 0, target );
+
+    DataEmbedNN dataEmbedNN = DataEmbedNN( DataIO( data ), block, target,
+                                           targets, Neighbors() );
+
+    FindEmbedNeighbors( dataEmbedNN, param );
+
+    return dataEmbedNN;
+}
+
+//----------------------------------------------------------
+// Nearest neighbors of the data block of dataEmbedNN, from the
+// neighbor cache if enabled
+//----------------------------------------------------------
+void FindEmbedNeighbors( DataEmbedNN      &dataEmbedNN,
+                         const Parameters &param ) {
+
+    Neighbors &neighbors = dataEmbedNN.neighbors;
+
+    if ( param.neighborCachePath.size() ) {
+        uint64_t key = 0;
+        if ( dataEmbedNN.floatFrame.NColumns() ) {
+            key = NeighborCacheKey( dataEmbedNN.floatFrame, param );
+        }
+        else if ( dataEmbedNN.embeddingView.NColumns() ) {
+            key = NeighborCacheKey( dataEmbedNN.embeddingView.Source(), param );
+        }
+        else {
+            key = NeighborCacheKey( dataEmbedNN.dataFrame, param );
+        }
+
+        if ( not LoadNeighborCache( param.neighborCachePath, key, neighbors ) ) {
+            neighbors = FindBlockNeighbors( dataEmbedNN, param );
+            SaveNeighborCache( param.neighborCachePath, key, neighbors );
+        }
+        else if ( param.verbose ) {
+            std::stringstream msg;
+            msg << "LoadDataEmbedNN(): neighbors read from "
+                << NeighborCacheFile( param.neighborCachePath, key ) << "\n";
+            Message( msg.str() );
+        }
+    }
+    else {
+        neighbors = FindBlockNeighbors( dataEmbedNN, param );
+    }
+}
+
+//----------------------------------------------------------
+// Neighbors of the data block: single precision, lagged view
+// or materialized
+//----------------------------------------------------------
+Neighbors FindBlockNeighbors( const DataEmbedNN &dataEmbedNN,
+                              const Parameters  &param ) {
+
+    if ( dataEmbedNN.floatFrame.NColumns() ) {
+        return FindNeighbors( dataEmbedNN.floatFrame, param );
+    }
+    if ( dataEmbedNN.embeddingView.NColumns() ) {
+        return FindNeighbors( dataEmbedNN.embeddingView, param );
+    }
+    return FindNeighbors( dataEmbedNN.dataFrame, param );
+}
+
+Neighbors FindBlockNeighbors( const NeighborIndex &index,
+                              const DataEmbedNN   &dataEmbedNN,
+                              const Parameters    &param ) {
+
+    if ( dataEmbedNN.floatFrame.NColumns() ) {
+        return FindNeighbors( index, dataEmbedNN.floatFrame, param );
+    }
+    if ( dataEmbedNN.embeddingView.NColumns() ) {
+        return FindNeighbors( index, dataEmbedNN.embeddingView, param );
+    }
+    return FindNeighbors( index, dataEmbedNN.dataFrame, param );
+}
+
+//----------------------------------------------------------
+// Index of the library rows of the data block
+//----------------------------------------------------------
+void BuildBlockIndex( NeighborIndex     &index,
+                      const DataEmbedNN &dataEmbedNN,
+                      const Parameters  &param ) {
+
+    if ( dataEmbedNN.floatFrame.NColumns() ) {
+        index.Build( dataEmbedNN.floatFrame, param );
+    }
+    else if ( dataEmbedNN.embeddingView.NColumns() ) {
+        index.Build( dataEmbedNN.embeddingView, param );
+    }
+    else {
+        index.Build( dataEmbedNN.dataFrame, param );
+    }
+}
+
+//----------------------------------------------------------
+// embedded = false: library and prediction rows past the end
+// of the embedding are removed
+//----------------------------------------------------------
+void EmbeddingRows( Parameters        &param,
+                    const DataEmbedNN &dataEmbedNN ) {
+
+    size_t N_rows = dataEmbedNN.NRows();
+
+    if ( param.embedded or not N_rows ) {
+        return;
+    }
+
+    IntervalSet embeddingRows( 0, N_rows - 1 );
+
+    if ( param.prediction.size() and param.prediction.back() >= N_rows ) {
+        param.prediction = param.prediction.Intersection( embeddingRows );
+        if ( param.verbose ) {
+            std::stringstream msg;
+            msg << "EmbeddingRows(): prediction rows past row " << N_rows
+                << " of the embedding are not predicted.\n";
+            Message( msg.str() );
+        }
+    }
+    if ( param.library.size() and param.library.back() >= N_rows ) {
+        param.library = param.library.Intersection( embeddingRows );
+        if ( param.verbose ) {
+            std::stringstream msg;
+            msg << "EmbeddingRows(): library rows past row " << N_rows
+                << " of the embedding are not used.\n";
+            Message( msg.str() );
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Embedding (or multivariable block) and targets of the data
+// in dio, neighbors are not computed.
+//----------------------------------------------------------
+DataEmbedNN EmbedData( const DataIO     &dio,
+                       const Parameters &param,
+                       std::string       columns ) {
+
     //----------------------------------------------------------
     // Extract or embedd data block
     //----------------------------------------------------------
-    DataFrame<double> dataBlock; // Multivariate or embedded DataFrame
+    DataFrame<double> dataBlock;     // Multivariate or embedded DataFrame
+    EmbeddingView     embeddingView; // laggedView : embedding not made
+    DataFrame<float>  floatBlock;    // singlePrecision : neither made
+    bool              lagged = param.laggedView and not param.embedded;
 
-    if ( param.embedded ) {
+    if ( param.singlePrecision ) {
+        // Single precision block from the columns, E = 1 if embedded
+        std::vector< size_t >      columnIndex;
+        std::vector< std::string > colNames;
+        EmbedColumns( dio.DFrame(), columns, columnIndex, colNames );
+        floatBlock = param.embedded ?
+            MakeBlock< float >( dio.DFrame(), 1, 1, columnIndex,
+                                colNames, false ) :
+            MakeBlock< float >( dio.DFrame(), param.E, param.tau,
+                                columnIndex, colNames, param.verbose );
+    }
+    else if ( param.embedded ) {
         // Data is multivariable block, no embedding needed
         if ( param.columnNames.size() ) {
          dataBlock = dio.DFrame().DataFrameFromColumnNames(param.columnNames);
@@ -31,10 +227,17 @@ DataEmbedNN LoadDataEmbedNN( Parameters  param,
                                       " are empty" );
         }
     }
+    else if ( lagged ) {
+        // embedded = false, laggedView = true: lagged view of the columns
+        std::vector< size_t >      columnIndex;
+        std::vector< std::string > colNames;
+        EmbedColumns( dio.DFrame(), columns, columnIndex, colNames );
+        embeddingView = EmbeddingView( dio.DFrame(), param.E, param.tau,
+                                       columnIndex, colNames );
+    }
     else {
         // embedded = false: create the embedding block
-        dataBlock = Embed( param.pathIn, param.dataFile,
-                           param.E,      param.tau,
+        dataBlock = Embed( dio.DFrame(), param.E, param.tau,
                            columns,      param.verbose );
     }
     
@@ -54,18 +257,44 @@ DataEmbedNN LoadDataEmbedNN( Parameters  param,
     }
 
     //----------------------------------------------------------
-    // Nearest neighbors
+    // Targets: row-major so the targets of a library row are contiguous
     //----------------------------------------------------------
-    Neighbors neighbors = FindNeighbors( dataBlock, param );
+    DataFrame<double> targets;
+    if ( param.targetIndices.size() > 1 ) {
+        targets = dio.DFrame().DataFrameFromColumnIndex( param.targetIndices );
+        for ( auto ti : param.targetIndices ) {
+            targets.ColumnNames().push_back( dio.DFrame().ColumnNames()[ti] );
+        }
+        targets.BuildColumnNameIndex();
+    }
+    else if ( param.targetNames.size() > 1 ) {
+        targets = dio.DFrame().DataFrameFromColumnNames( param.targetNames );
+    }
+    else {
+        std::string targetName = param.targetName;
+        if ( not targetName.size() ) {
+            targetName = dio.DFrame().ColumnNames()[ param.targetIndex ?
+                                                     param.targetIndex : 1 ];
+        }
+        targets = DataFrame<double>( target_vec.size(), 1, targetName );
+        targets.WriteColumn( 0, target_vec );
+    }
 
     // Create struct to return the objects
-    DataEmbedNN dataEmbedNN = DataEmbedNN(dio, dataBlock, target_vec, neighbors);
+    DataEmbedNN dataEmbedNN = DataEmbedNN( dio, dataBlock, target_vec,
+                                           targets, Neighbors() );
+    dataEmbedNN.embeddingView = embeddingView;
+    dataEmbedNN.floatFrame    = floatBlock;
 
     return dataEmbedNN;
 }
 
 //----------------------------------------------------------
 // Common code to Simplex and Smap for output generation
+// Each prediction interval is followed by Tp rows: the prediction
+// of row i is Tp rows below its Time and Observation, within the
+// rows of its interval. Disjoint intervals are not shifted into
+// each other.
 //----------------------------------------------------------
 DataFrame<double> FormatOutput( Parameters            param,
                                 size_t                N_row,
@@ -73,42 +302,105 @@ DataFrame<double> FormatOutput( Parameters            param,
                                 DataFrame<double>     dataFrameIn,
                                 std::valarray<double> target_vec )
 {
+    const std::vector< IntervalSet::Interval > &intervals =
+        param.prediction.Intervals();
 
-    std::slice pred_i = std::slice( param.prediction[0], N_row, 1 );
-    
-    // Time vector with additional Tp points
-    //----------------------------------------------------
-    std::valarray<double> time( N_row + param.Tp );
+    size_t N_out = N_row + intervals.size() * param.Tp;
+
+    std::valarray<double> time          ( N_out );
+    std::valarray<double> observations  ( N_out );
+    std::valarray<double> predictionsOut( N_out );
+
+    size_t row = 0; // output row
+    size_t i   = 0; // prediction row
     
-    // Insert times from prediction. Time is the 1st column
-    time = dataFrameIn.Column( 0 )[ pred_i ];
-    // Insert Tp times at end
-    for ( size_t i = N_row; i < N_row + param.Tp; i++ ) {
-        time[ i ] = time[ i - 1 ] + param.Tp;
-    }
+    for ( const IntervalSet::Interval &interval : intervals ) {
+        size_t N_interval = interval.second - interval.first + 1;
 
-    // Observations: add Tp nan at end
-    //----------------------------------------------------
-    std::valarray<double> observations( N_row + param.Tp );
-    observations[ std::slice( 0, N_row, 1 ) ] = target_vec[ pred_i ];
-    for ( size_t i = N_row; i < N_row + param.Tp; i++ ) {
-        observations[ i ] = NAN;
-    }
+        // Predictions: Tp nan at start of the interval
+        for ( size_t t = 0; t < param.Tp; t++ ) {
+            predictionsOut[ row + t ] = NAN;
+        }
 
-    // Predictions: insert Tp nan at start
-    //----------------------------------------------------
-    std::valarray<double> predictionsOut( N_row + param.Tp );
-    for ( size_t i = 0; i < param.Tp; i++ ) {
-        predictionsOut[ i ] = NAN;
+        // Times and observations of the prediction rows, time is the
+        // 1st column, predictions shifted by Tp
+        for ( size_t j = 0; j < N_interval; j++, i++ ) {
+            time        [ row + j ] = dataFrameIn( param.prediction[ i ], 0 );
+            observations[ row + j ] = target_vec[ param.prediction[ i ] ];
+            predictionsOut[ row + j + param.Tp ] = predictions[ i ];
+        }
+        row += N_interval;
+
+        // Tp times at end of the interval, observations nan
+        for ( size_t t = 0; t < param.Tp; t++, row++ ) {
+            time        [ row ] = time[ row - 1 ] + param.Tp;
+            observations[ row ] = NAN;
+        }
     }
-    predictionsOut[ std::slice(param.Tp, N_row, 1) ] = predictions;
 
     // Create output DataFrame
-    DataFrame<double> dataFrame( N_row + param.Tp, 3 );
+    DataFrame<double> dataFrame( N_out, 3 );
     dataFrame.ColumnNames() = { "Time", "Observations", "Predictions" };
+    dataFrame.BuildColumnNameIndex();
     dataFrame.WriteColumn( 0, time );
     dataFrame.WriteColumn( 1, observations );
     dataFrame.WriteColumn( 2, predictionsOut );
     
     return dataFrame;
 }
+
+//----------------------------------------------------------
+// Row of the FormatOutput() DataFrame holding the prediction of
+// prediction row i: i + Tp, plus Tp for each interval before the
+// interval of row i
+//----------------------------------------------------------
+size_t FormatOutputRow( const Parameters &param, size_t i ) {
+    size_t N_before = 0; // prediction rows of the preceding intervals
+    size_t row      = i + param.Tp;
+
+    for ( const IntervalSet::Interval &interval :
+              param.prediction.Intervals() ) {
+        N_before += interval.second - interval.first + 1;
+        if ( i < N_before ) {
+            break;
+        }
+        row += param.Tp;
+    }
+    return row;
+}
+
+//----------------------------------------------------------
+// Output for multiple targets: Time, then Observations(target)
+// and Predictions(target) for each target column
+//----------------------------------------------------------
+DataFrame<double> FormatOutput( Parameters            param,
+                                size_t                N_row,
+                                DataFrame<double>     predictions,
+                                DataFrame<double>     dataFrameIn,
+                                DataFrame<double>     targets )
+{
+    size_t N_targets = targets.NColumns();
+
+    DataFrame<double> dataFrame( N_row + param.prediction.Intervals().size()
+                                 * param.Tp, 2 * N_targets + 1 );
+    
+    for ( size_t t = 0; t < N_targets; t++ ) {
+        DataFrame<double> targetOut = FormatOutput( param, N_row,
+                                                    predictions.Column( t ),
+                                                    dataFrameIn,
+                                                    targets.Column( t ) );
+        if ( t == 0 ) {
+            dataFrame.ColumnNames().push_back( "Time" );
+            dataFrame.WriteColumn( 0, targetOut.Column( 0 ) );
+        }
+        
+        const std::string &name = targets.ColumnNames()[ t ];
+        dataFrame.ColumnNames().push_back( "Observations(" + name + ")" );
+        dataFrame.ColumnNames().push_back( "Predictions("  + name + ")" );
+        dataFrame.WriteColumn( 2 * t + 1, targetOut.Column( 1 ) );
+        dataFrame.WriteColumn( 2 * t + 2, targetOut.Column( 2 ) );
+    }
+    dataFrame.BuildColumnNameIndex();
+    
+    return dataFrame;
+}
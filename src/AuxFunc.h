@@ -4,6 +4,7 @@
 #include "DataIO.h"
 #include "Neighbors.h"
 #include "Embed.h"
+#include "NeighborCache.h"
 
 //----------------------------------------------------------------
 // Data Input, embedding and NN structure to accomodate
@@ -12,24 +13,111 @@
 struct DataEmbedNN {
     DataIO                dio;
     DataFrame<double>     dataFrame;
-    std::valarray<double> targetVec;
+    std::valarray<double> targetVec; // first target
+    DataFrame<double>     targets;   // all targets, one column each
     Neighbors             neighbors;
+    EmbeddingView         embeddingView; // laggedView in place of dataFrame
+    DataFrame<float>      floatFrame;    // singlePrecision in place of both
     
     // Constructor
     DataEmbedNN( DataIO                dio,
                  DataFrame<double>     dataFrame,
                  std::valarray<double> targetVec,
+                 DataFrame<double>     targets,
                  Neighbors             neighbors ) :
         dio( dio ), dataFrame( dataFrame ), targetVec( targetVec ),
-        neighbors( neighbors ) {}
+        targets( targets ), neighbors( neighbors ) {}
+
+    // Element of the data block: single precision, lagged view
+    // or materialized
+    double Block( size_t row, size_t col ) const {
+        if ( floatFrame.NColumns() ) { return floatFrame( row, col ); }
+        return embeddingView.NColumns() ? embeddingView( row, col ) :
+                                          dataFrame( row, col );
+    }
+
+    // Rows and columns of the data block
+    size_t NRows() const {
+        if ( floatFrame.NColumns() ) { return floatFrame.NRows(); }
+        return embeddingView.NColumns() ? embeddingView.NRows() :
+                                          dataFrame.NRows();
+    }
+    size_t NColumns() const {
+        if ( floatFrame.NColumns() ) { return floatFrame.NColumns(); }
+        return embeddingView.NColumns() ? embeddingView.NColumns() :
+                                          dataFrame.NColumns();
+    }
 };
 
-DataEmbedNN LoadDataEmbedNN( Parameters  param,
-                             std::string columns );
+// LoadDataEmbedNN() and EmbedNN() drop the rows of param.library
+// and param.prediction past the end of the embedding
+DataEmbedNN LoadDataEmbedNN( Parameters  &param,
+                             std::string  columns );
+
+DataEmbedNN EmbedNN( const DataIO &dio,
+                     Parameters   &param,
+                     std::string   columns );
+
+DataEmbedNN BlockNN( const DataFrame<double>     &block,
+                     const std::valarray<double> &target,
+                     const Parameters            &param );
+
+void FindEmbedNeighbors( DataEmbedNN      &dataEmbedNN,
+                         const Parameters &param );
+
+// FindNeighbors() and NeighborIndex::Build() of the data block of
+// dataEmbedNN, of the type it is held in
+Neighbors FindBlockNeighbors( const DataEmbedNN &dataEmbedNN,
+                              const Parameters  &param );
+
+Neighbors FindBlockNeighbors( const NeighborIndex &index,
+                              const DataEmbedNN   &dataEmbedNN,
+                              const Parameters    &param );
+
+void BuildBlockIndex( NeighborIndex     &index,
+                      const DataEmbedNN &dataEmbedNN,
+                      const Parameters  &param );
+
+// embedded = false: the embedding has tau * (E-1) fewer rows than
+// the data. Remove the library and prediction rows past its end.
+void EmbeddingRows( Parameters        &param,
+                    const DataEmbedNN &dataEmbedNN );
+
+// EmbedNN() without the neighbors. param.singlePrecision makes the
+// block a DataFrame<float> from the data: no double block or view.
+DataEmbedNN EmbedData( const DataIO     &dio,
+                       const Parameters &param,
+                       std::string       columns );
+
+DataFrame<double> SimplexProjection( const Parameters  &param,
+                                     const DataEmbedNN &dataEmbedNN );
+
+SMapValues SMapProjection( const Parameters  &param,
+                           const DataEmbedNN &dataEmbedNN );
+
+// Projections of param.prediction rows with neighbors in place
+// of dataEmbedNN.neighbors
+DataFrame<double> SimplexProjection( const Parameters  &param,
+                                     const DataEmbedNN &dataEmbedNN,
+                                     const Neighbors   &neighbors );
+
+SMapValues SMapProjection( const Parameters  &param,
+                           const DataEmbedNN &dataEmbedNN,
+                           const Neighbors   &neighbors );
     
 DataFrame<double> FormatOutput( Parameters            param,
                                 size_t                N_row,
                                 std::valarray<double> predictions,
                                 DataFrame<double>     dataFrameIn,
                                 std::valarray<double> target_vec );
+
+DataFrame<double> FormatOutput( Parameters            param,
+                                size_t                N_row,
+                                DataFrame<double>     predictions,
+                                DataFrame<double>     dataFrameIn,
+                                DataFrame<double>     targets );
+
+// Row of the FormatOutput() DataFrame with the prediction of
+// param.prediction row i
+size_t FormatOutputRow( const Parameters &param, size_t i );
 #endif
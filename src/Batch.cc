@@ -0,0 +1,267 @@
+
+#include <chrono>
+#include <fstream>
+
+#include "Batch.h"
+#include "Parameter.h"
+#include "AuxFunc.h"
+#include "ThreadPool.h"
+
+namespace {
+    //------------------------------------------------------------
+    // Split a manifest line on commas, keeping spaces inside fields
+    //------------------------------------------------------------
+    std::vector< std::string > SplitFields( const std::string &line ) {
+        std::vector< std::string > fields;
+        std::stringstream lineStrm( line );
+        std::string       field;
+
+        while ( std::getline( lineStrm, field, ',' ) ) {
+            size_t first = field.find_first_not_of( " \t\r" );
+            size_t last  = field.find_last_not_of ( " \t\r" );
+            if ( first == std::string::npos ) {
+                fields.push_back( "" );
+            }
+            else {
+                fields.push_back( field.substr( first, last - first + 1 ) );
+            }
+        }
+        return fields;
+    }
+
+    //------------------------------------------------------------
+    // Run one job through the projection without file output
+    //------------------------------------------------------------
+    BatchResult RunBatchJob( const BatchJob &job, size_t job_i ) {
+
+        BatchResult result;
+        result.job    = job_i;
+        result.N_pred = 0;
+        result.error  = ErrorAccumulator().Error(); // NAN, N = 0
+
+        try {
+            Parameters param( job.method, job.pathIn, job.dataFile, "", "",
+                              job.lib, job.pred, job.E, job.Tp, job.knn,
+                              job.tau, job.theta, job.columns, job.target,
+                              job.embedded, false );
+
+            DataEmbedNN dataEmbedNN = LoadDataEmbedNN( param, job.columns );
+
+            DataFrame< double > predictions;
+            if ( job.method == Method::SMap ) {
+                predictions = SMapProjection( param, dataEmbedNN ).predictions;
+            }
+            else {
+                predictions = SimplexProjection( param, dataEmbedNN );
+            }
+
+            // Observations and Predictions of the first target
+            result.error  = ComputeError( predictions.Column( 1 ),
+                                          predictions.Column( 2 ) );
+            result.N_pred = param.prediction.size();
+        }
+        catch ( const std::exception &e ) {
+            result.errorMessage = e.what();
+        }
+
+        return result;
+    }
+}
+
+//----------------------------------------------------------------
+// Read manifest of jobs from path/manifestFile
+//----------------------------------------------------------------
+std::vector< BatchJob > ReadBatchManifest( std::string path,
+                                           std::string manifestFile ) {
+
+    std::ifstream manifestStrm( path + manifestFile );
+    if ( not manifestStrm.is_open() ) {
+        std::stringstream errMsg;
+        errMsg << "ReadBatchManifest(): file " << path + manifestFile
+               << " is not open for reading.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    std::vector< std::string > header;
+    std::vector< BatchJob >    jobs;
+    std::string                line;
+    size_t                     lineNumber = 0;
+
+    while ( std::getline( manifestStrm, line ) ) {
+        lineNumber++;
+
+        if ( line.find_first_not_of( " \t\r" ) == std::string::npos or
+             line[ line.find_first_not_of( " \t\r" ) ] == '#' ) {
+            continue;
+        }
+
+        std::vector< std::string > fields = SplitFields( line );
+
+        if ( header.empty() ) {
+            for ( auto field : fields ) { header.push_back( ToLower(field) ); }
+            if ( std::find( header.begin(), header.end(), "datafile" ) ==
+                 header.end() ) {
+                std::stringstream errMsg;
+                errMsg << "ReadBatchManifest(): " << manifestFile
+                       << " header has no dataFile field.\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+            continue;
+        }
+
+        if ( fields.size() > header.size() ) {
+            std::stringstream errMsg;
+            errMsg << "ReadBatchManifest(): " << manifestFile << " line "
+                   << lineNumber << " has " << fields.size()
+                   << " fields, the header has " << header.size() << ".\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        BatchJob job;
+        job.pathIn = path;
+
+        for ( size_t i = 0; i < fields.size(); i++ ) {
+            const std::string &name  = header[ i ];
+            const std::string &value = fields[ i ];
+
+            if ( value.empty() ) { continue; }
+
+            if      ( name == "path"     ) { job.pathIn   = value; }
+            else if ( name == "datafile" ) { job.dataFile = value; }
+            else if ( name == "lib"      ) { job.lib      = value; }
+            else if ( name == "pred"     ) { job.pred     = value; }
+            else if ( name == "columns"  ) { job.columns  = value; }
+            else if ( name == "target"   ) { job.target   = value; }
+            else if ( name == "e"        ) { job.E     = std::stoi( value ); }
+            else if ( name == "tp"       ) { job.Tp    = std::stoi( value ); }
+            else if ( name == "knn"      ) { job.knn   = std::stoi( value ); }
+            else if ( name == "tau"      ) { job.tau   = std::stoi( value ); }
+            else if ( name == "theta"    ) { job.theta = std::stod( value ); }
+            else if ( name == "embedded" ) {
+                std::string embedded = ToLower( value );
+                job.embedded = embedded == "1" or embedded == "true";
+            }
+            else if ( name == "method" ) {
+                std::string method = ToLower( value );
+                if      ( method == "simplex" ) { job.method = Method::Simplex; }
+                else if ( method == "smap"    ) { job.method = Method::SMap;    }
+                else {
+                    std::stringstream errMsg;
+                    errMsg << "ReadBatchManifest(): " << manifestFile
+                           << " line " << lineNumber << " invalid method "
+                           << value << ".\n";
+                    throw std::runtime_error( errMsg.str() );
+                }
+            }
+            else {
+                std::stringstream errMsg;
+                errMsg << "ReadBatchManifest(): " << manifestFile
+                       << " unknown field " << name << ".\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+        }
+
+        jobs.push_back( job );
+    }
+
+    return jobs;
+}
+
+//----------------------------------------------------------------
+// Run all jobs as a TaskGroup of nThreads on the shared pool.
+// Each thread appends results to its own buffer, the buffers are
+// merged in job order once all jobs are done. Each thread runs its
+// jobs on its own Arena: the temporaries of every job reuse the
+// arena blocks of the previous jobs.
+//----------------------------------------------------------------
+std::vector< BatchResult > Batch( const std::vector< BatchJob > &jobs,
+                                  std::string pathOut,
+                                  std::string outputFile,
+                                  size_t      nThreads,
+                                  bool        verbose ) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector< BatchResult > results;
+    {
+        TaskGroup group( nThreads );
+
+        std::vector< std::vector< BatchResult > >
+            workerResults( group.Slots() );
+        std::vector< Arena > workerArenas( group.Slots() );
+
+        for ( size_t job_i = 0; job_i < jobs.size(); job_i++ ) {
+            group.Submit( [ &group, &jobs, &workerResults, &workerArenas,
+                            job_i ]() {
+                size_t     worker = group.ThreadSlot();
+                ArenaScope scope( workerArenas[ worker ] );
+                workerResults[ worker ].push_back(
+                    RunBatchJob( jobs[ job_i ], job_i ) );
+            } );
+        }
+
+        group.Wait();
+
+        results.reserve( jobs.size() );
+        for ( auto &buffer : workerResults ) {
+            results.insert( results.end(), buffer.begin(), buffer.end() );
+        }
+    }
+
+    std::sort( results.begin(), results.end(),
+               []( const BatchResult &a, const BatchResult &b ) {
+                   return a.job < b.job; } );
+
+    //------------------------------------------------------------
+    // Consolidated output
+    //------------------------------------------------------------
+    if ( outputFile.size() ) {
+        std::ofstream outStrm( pathOut + outputFile );
+        if ( not outStrm.is_open() ) {
+            std::stringstream errMsg;
+            errMsg << "Batch(): bad file permissions: "
+                   << pathOut + outputFile << ".\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        outStrm.precision( 4 );
+        outStrm.setf( std::ios::fixed, std::ios::floatfield );
+
+        outStrm << "job,dataFile,method,E,Tp,knn,tau,theta,target,"
+                   "N,rho,RMSE,MAE,error\n";
+
+        for ( auto &result : results ) {
+            const BatchJob &job = jobs[ result.job ];
+
+            std::string message = result.errorMessage;
+            std::replace( message.begin(), message.end(), ',',  ' ' );
+            std::replace( message.begin(), message.end(), '\n', ' ' );
+
+            outStrm << result.job << "," << job.dataFile << ","
+                    << ( job.method == Method::SMap ? "SMap" : "Simplex" )
+                    << "," << job.E << "," << job.Tp << "," << job.knn
+                    << "," << job.tau << "," << job.theta << ","
+                    << job.target << "," << result.N_pred << ","
+                    << result.error.rho  << "," << result.error.RMSE << ","
+                    << result.error.MAE  << "," << message << "\n";
+        }
+    }
+
+    if ( verbose ) {
+        double seconds = std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - start ).count();
+
+        size_t nFailed = 0;
+        for ( auto &result : results ) {
+            if ( result.errorMessage.size() ) { nFailed++; }
+        }
+
+        std::stringstream msg;
+        msg << "Batch(): " << jobs.size() << " series (" << nFailed
+            << " failed) in " << seconds << " s : "
+            << jobs.size() / seconds << " series/s" << std::endl;
+        Message( msg.str() );
+    }
+
+    return results;
+}
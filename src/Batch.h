@@ -0,0 +1,56 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// Batch processing of many independent series.
+//
+// A manifest is a csv file with a header line naming the fields
+// of each job. dataFile is required, the other fields are optional:
+//
+//   path,dataFile,method,lib,pred,E,Tp,knn,tau,theta,columns,target,embedded
+//
+// Fields are comma delimited. lib, pred, columns and target are
+// space delimited within a field, for example: 1 100,101 198
+// Blank lines and lines starting with # are ignored.
+//---------------------------------------------------------
+struct BatchJob {
+    Method      method;
+    std::string pathIn;
+    std::string dataFile;
+    std::string lib;
+    std::string pred;
+    int         E;
+    int         Tp;
+    int         knn;
+    int         tau;
+    double      theta;
+    std::string columns;
+    std::string target;
+    bool        embedded;
+
+    BatchJob() : method( Method::Simplex ), pathIn( "./" ),
+                 E( 0 ), Tp( 1 ), knn( 0 ), tau( 1 ), theta( 0 ),
+                 embedded( false ) {}
+};
+
+struct BatchResult {
+    size_t      job;          // index of the job in the manifest
+    VectorError error;        // prediction error of the (first) target
+    size_t      N_pred;       // number of prediction rows
+    std::string errorMessage; // exception message if the job failed
+};
+
+std::vector< BatchJob > ReadBatchManifest( std::string path,
+                                           std::string manifestFile );
+
+// Run jobs on nThreads of the shared pool (0 : all). If outputFile is
+// not empty one consolidated csv of all job results is written to
+// pathOut.
+std::vector< BatchResult > Batch( const std::vector< BatchJob > &jobs,
+                                  std::string pathOut    = "./",
+                                  std::string outputFile = "",
+                                  size_t      nThreads   = 0,
+                                  bool        verbose    = false );
+#endif
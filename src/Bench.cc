@@ -0,0 +1,328 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+#include "Common.h"
+#include "DataIO.h"
+#include "Embed.h"
+#include "Generators.h"
+#include "Neighbors.h"
+
+//----------------------------------------------------------------
+// Benchmark suite: Distance(), FindNeighbors() in double and
+// single precision, MakeBlock() and Column() in row and column major
+// layout, csv read and write, Simplex() and SMap() end to end on
+// synthetic Lorenz '63 and tent map series of 10^3 rows up to maxRows
+// in decades.
+//
+// MakeBlock ColumnMajor+RowMajor is the column major embedding
+// converted to the row major layout of FindNeighbors(), to compare
+// with the row major MakeBlock.
+//
+// Each case runs repeat times; the minimum and median seconds are
+// reported with rate = items / minimum seconds, where items are the
+// distances, prediction rows, embedding rows or csv rows of the case.
+// Series are deterministic so results are comparable between builds.
+// Cases that scale with library x prediction rows are limited in
+// library size: brute force FindNeighbors and Simplex to 10^4 rows,
+// SMap (knn = all library rows) to 2000.
+//
+// Results are written to stdout as csv, and to outputFile as json
+// if its name ends in .json, else as csv.
+//
+// Usage: Bench [maxRows=100000] [repeat=3] [outputFile]
+//----------------------------------------------------------------
+namespace {
+    const size_t maxLibrary    = 10000; // brute force and Simplex
+    const size_t maxSMapLib    = 2000;
+    const size_t N_prediction  = 1000;
+    const size_t N_SMapPred    = 200;
+    const char  *benchDataFile = "BenchData.csv";
+
+    struct BenchResult {
+        std::string name;
+        std::string data;
+        size_t      N;      // rows of the data
+        int         E;
+        int         knn;
+        std::string algorithm;
+        size_t      items;  // units of work timed: rate = items / min
+        double      minSeconds;
+        double      medianSeconds;
+    };
+
+    //------------------------------------------------------------
+    // Minimum and median seconds of repeat calls of f
+    //------------------------------------------------------------
+    void Time( std::function< void() > f, size_t repeat,
+               double &minSeconds, double &medianSeconds ) {
+        std::vector< double > seconds;
+        for ( size_t i = 0; i < repeat; i++ ) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            seconds.push_back( std::chrono::duration< double >(
+                std::chrono::steady_clock::now() - start ).count() );
+        }
+        std::sort( seconds.begin(), seconds.end() );
+        minSeconds    = seconds.front();
+        medianSeconds = seconds[ seconds.size() / 2 ];
+    }
+
+    std::string Interval( size_t start, size_t stop ) {
+        std::stringstream interval;
+        interval << start << " " << stop;
+        return interval.str();
+    }
+
+    std::string CSV( const std::vector< BenchResult > &results ) {
+        std::stringstream csv;
+        csv << "name,data,N,E,knn,algorithm,items,min_s,median_s,rate\n";
+        for ( auto &r : results ) {
+            csv << r.name << "," << r.data << "," << r.N << "," << r.E << ","
+                << r.knn << "," << r.algorithm << "," << r.items << ","
+                << r.minSeconds << "," << r.medianSeconds << ","
+                << r.items / r.minSeconds << "\n";
+        }
+        return csv.str();
+    }
+
+    std::string JSON( const std::vector< BenchResult > &results,
+                      size_t repeat ) {
+        std::stringstream json;
+        json << "{\"compiler\":\"" << __VERSION__ << "\",\"repeat\":"
+             << repeat << ",\"results\":[";
+        for ( size_t i = 0; i < results.size(); i++ ) {
+            const BenchResult &r = results[ i ];
+            json << ( i ? "," : "" ) << "\n {\"name\":\"" << r.name
+                 << "\",\"data\":\"" << r.data << "\",\"N\":" << r.N
+                 << ",\"E\":" << r.E << ",\"knn\":" << r.knn
+                 << ",\"algorithm\":\"" << r.algorithm << "\",\"items\":"
+                 << r.items << ",\"min_s\":" << r.minSeconds
+                 << ",\"median_s\":" << r.medianSeconds
+                 << ",\"rate\":" << r.items / r.minSeconds << "}";
+        }
+        json << "\n]}";
+        return json.str();
+    }
+}
+
+int main( int argc, char *argv[] ) {
+
+    size_t      maxRows    = argc > 1 ? std::stoul( argv[1] ) : 100000;
+    size_t      repeat     = argc > 2 ? std::stoul( argv[2] ) : 3;
+    std::string outputFile = argc > 3 ? argv[3] : "";
+
+    if ( repeat < 1 ) { repeat = 1; }
+
+    std::vector< BenchResult > results;
+
+    auto Run = [ &results, repeat ]( BenchResult result,
+                                     std::function< void() > f ) {
+        Time( f, repeat, result.minSeconds, result.medianSeconds );
+        results.push_back( result );
+        std::cerr << result.name << " " << result.data << " N " << result.N
+                  << " E " << result.E << " knn " << result.knn << " "
+                  << result.algorithm << " " << result.minSeconds << " s"
+                  << std::endl;
+    };
+
+    try {
+        for ( size_t N = 1000; N <= maxRows; N *= 10 ) {
+
+            for ( std::string name : { "Lorenz", "Tent" } ) {
+                DataFrame< double > data = name == "Lorenz" ? Lorenz63( N )
+                                                            : TentMap( N );
+                std::string column = name == "Lorenz" ? "V1" : "x";
+
+                //--------------------------------------------------
+                // MakeBlock and Column() by layout
+                //--------------------------------------------------
+                DataFrame< double, ColumnMajor > cdata( data );
+                std::vector< size_t >      columnIndex( 1, 1 );
+                std::vector< std::string > columnNames( 1, column );
+
+                for ( int E : { 3, 10 } ) {
+                    Run( { "MakeBlock", name, N, E, 0, "RowMajor", N },
+                         [ &data, E, &columnIndex, &columnNames ]() {
+                             MakeBlock( data, E, 1, columnIndex,
+                                        columnNames, false );
+                         } );
+                    Run( { "MakeBlock", name, N, E, 0, "ColumnMajor", N },
+                         [ &cdata, E, &columnIndex, &columnNames ]() {
+                             MakeBlock( cdata, E, 1, columnIndex,
+                                        columnNames, false );
+                         } );
+                    Run( { "MakeBlock", name, N, E, 0,
+                           "ColumnMajor+RowMajor", N },
+                         [ &cdata, E, &columnIndex, &columnNames ]() {
+                             DataFrame< double > block(
+                                 MakeBlock( cdata, E, 1, columnIndex,
+                                            columnNames, false ) );
+                         } );
+                }
+
+                for ( int E : { 3, 10 } ) {
+                    DataFrame< double > block = MakeBlock(
+                        data, E, 1, columnIndex, columnNames, false );
+                    DataFrame< double, ColumnMajor > cblock( block );
+                    volatile double sum = 0;
+                    Run( { "Column", name, N, E, 0, "RowMajor", N },
+                         [ &block, &sum ]() {
+                             double s = 0;
+                             for ( size_t col = 0; col < block.NColumns();
+                                   col++ ) {
+                                 s += block.Column( col ).sum();
+                             }
+                             sum = s;
+                         } );
+                    Run( { "Column", name, N, E, 0, "ColumnMajor", N },
+                         [ &cblock, &sum ]() {
+                             double s = 0;
+                             for ( size_t col = 0; col < cblock.NColumns();
+                                   col++ ) {
+                                 s += cblock.Column( col ).sum();
+                             }
+                             sum = s;
+                         } );
+                }
+
+                //--------------------------------------------------
+                // Distance: consecutive embedding rows
+                //--------------------------------------------------
+                for ( int E : { 3, 10 } ) {
+                    DataFrame< double > block = Embed( data, E, 1, column );
+                    volatile double sum = 0;
+                    Run( { "Distance", name, N, E, 0, "Euclidean", N - 1 },
+                         [ &block, E, &sum ]() {
+                             double s = 0;
+                             for ( size_t row = 1; row < block.NRows();
+                                   row++ ) {
+                                 s += Distance( &block( row - 1, 0 ),
+                                                &block( row, 0 ), E,
+                                                DistanceMetric::Euclidean );
+                             }
+                             sum = s;
+                         } );
+                }
+
+                //--------------------------------------------------
+                // FindNeighbors: N_prediction rows at the end
+                //--------------------------------------------------
+                size_t N_pred = std::min( N_prediction, N / 2 );
+                size_t N_lib  = N - N_pred;
+
+                for ( int E : { 3, 10 } ) {
+                    DataFrame< double > block = Embed( data, E, 1, column );
+                    DataFrame< float >  fblock = MakeBlock< float >(
+                        data, E, 1, columnIndex, columnNames, false );
+                    size_t N_block = block.NRows(); // E - 1 rows shorter
+
+                    for ( int knn : { E + 1, 20 } ) {
+                        Parameters param( Method::Simplex, "", "", "", "",
+                                          Interval( 1, N_block - N_pred ),
+                                          Interval( N_block - N_pred + 1,
+                                                    N_block ),
+                                          E, 1, knn );
+
+                        for ( NeighborAlgorithm algorithm :
+                              { NeighborAlgorithm::BruteForce,
+                                NeighborAlgorithm::KDTree } ) {
+                            if ( algorithm == NeighborAlgorithm::BruteForce
+                                 and N_lib > maxLibrary ) { continue; }
+
+                            std::string algorithmName =
+                                algorithm == NeighborAlgorithm::KDTree ?
+                                "KDTree" : "BruteForce";
+
+                            param.neighborAlgorithm = algorithm;
+                            Run( { "FindNeighbors", name, N, E, knn,
+                                   algorithmName, N_pred },
+                                 [ &block, &param ]() {
+                                     FindNeighbors( block, param );
+                                 } );
+
+                            // Single precision block
+                            Run( { "FindNeighbors", name, N, E, knn,
+                                   algorithmName + "Float", N_pred },
+                                 [ &fblock, &param ]() {
+                                     FindNeighbors( fblock, param );
+                                 } );
+                        }
+                    }
+                }
+
+                //--------------------------------------------------
+                // csv write and read
+                //--------------------------------------------------
+                DataIO dio( data );
+                Run( { "WriteData", name, N, 0, 0, "", N },
+                     [ &dio ]() { dio.WriteData( "./", benchDataFile ); } );
+                Run( { "ReadData", name, N, 0, 0, "", N },
+                     []() { DataIO( "./", benchDataFile ); } );
+
+                //--------------------------------------------------
+                // Simplex and SMap from the csv file
+                //--------------------------------------------------
+                // lib and pred are rows of the embedding, E - 1 rows
+                // shorter than the data
+                int    E       = 3;
+                size_t N_embed = N - ( E - 1 );
+                size_t N_sLib  = N_embed - N_pred;
+
+                if ( N_sLib <= maxLibrary ) {
+                    Run( { "Simplex", name, N, E, E + 1, "BruteForce",
+                           N_pred },
+                         [ &column, N_sLib, N_embed, E ]() {
+                             Simplex( "./", benchDataFile, "./", "",
+                                      Interval( 1, N_sLib ),
+                                      Interval( N_sLib + 1, N_embed ),
+                                      E, 1, 0, 1, column, column,
+                                      false, false );
+                         } );
+                }
+
+                size_t N_smapPred = std::min( N_SMapPred, N / 2 );
+                size_t N_smapLib  = std::min( N_embed - N_smapPred,
+                                              maxSMapLib );
+                Run( { "SMap", name, N, E,
+                       (int) N_smapLib, "BruteForce", N_smapPred },
+                     [ &column, N_smapLib, N_smapPred, E ]() {
+                         SMap( "./", benchDataFile, "./", "",
+                               Interval( 1, N_smapLib ),
+                               Interval( N_smapLib + 1,
+                                         N_smapLib + N_smapPred ),
+                               E, 1, 0, 1, 2, column, column, "", "",
+                               false, false );
+                     } );
+
+                std::remove( benchDataFile );
+            }
+        }
+
+        std::cout << CSV( results );
+
+        if ( outputFile.size() ) {
+            std::ofstream outStrm( outputFile );
+            if ( not outStrm.is_open() ) {
+                std::stringstream errMsg;
+                errMsg << "Bench: file " << outputFile
+                       << " is not open for writing.\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+            bool json = outputFile.size() > 5 and
+                outputFile.compare( outputFile.size() - 5, 5, ".json" ) == 0;
+            outStrm << ( json ? JSON( results, repeat ) : CSV( results ) )
+                    << std::endl;
+        }
+    }
+    catch ( const std::exception &e ) {
+        std::cout << "Exception caught in main:\n";
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
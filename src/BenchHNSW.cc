@@ -0,0 +1,181 @@
+
+#include <chrono>
+#include <random>
+#include <set>
+
+#include "DataIO.h"
+#include "Embed.h"
+#include "Neighbors.h"
+#include "HNSW.h"
+
+//----------------------------------------------------------------
+// Recall vs speed of the approximate (HNSW) FindNeighbors()
+// against the exact brute force and KDTree searches.
+//
+// The V1 column of LorenzData1000.csv is upsampled by linear
+// interpolation with small gaussian noise to create a large
+// library, then embedded with tau = upsample so the lags span
+// the original sampling interval.
+//
+// FindNeighbors() times include building the index. For HNSW the
+// graph build and the queries of each ef are also timed separately
+// since one graph serves any number of queries.
+//
+// Usage: BenchHNSW [upsample=100] [E=12] [N_pred=500] [outputFile]
+//----------------------------------------------------------------
+namespace {
+    double Seconds( std::chrono::steady_clock::time_point start ) {
+        return std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - start ).count();
+    }
+
+    // Fraction of exact neighbors (per row) found by approximate
+    double Recall( const Neighbors &exact, const Neighbors &approximate ) {
+        size_t found = 0;
+        size_t total = 0;
+        for ( size_t row = 0; row < exact.neighbors.NRows(); row++ ) {
+            std::set< int > exactRow;
+            for ( size_t k = 0; k < exact.neighbors.NColumns(); k++ ) {
+                exactRow.insert( exact.neighbors( row, k ) );
+            }
+            for ( size_t k = 0; k < approximate.neighbors.NColumns(); k++ ) {
+                found += exactRow.count( approximate.neighbors( row, k ) );
+            }
+            total += exactRow.size();
+        }
+        return (double) found / total;
+    }
+}
+
+int main( int argc, char *argv[] ) {
+
+    int         upsample = argc > 1 ? std::stoi( argv[1] ) : 100;
+    int         E        = argc > 2 ? std::stoi( argv[2] ) : 12;
+    int         N_pred   = argc > 3 ? std::stoi( argv[3] ) : 500;
+    std::string outputFile = argc > 4 ? argv[4] : "";
+
+    try {
+        //----------------------------------------------------------
+        // Upsampled synthetic series
+        //----------------------------------------------------------
+        DataIO dio = DataIO( "../data/", "LorenzData1000.csv" );
+        std::valarray< double > time = dio.DFrame().Column( 0 );
+        std::valarray< double > V1   = dio.DFrame().VectorColumnName( "V1" );
+
+        std::mt19937                     generator( 1 );
+        std::normal_distribution<double> noise( 0, 1E-3 );
+
+        size_t N_rows = ( V1.size() - 1 ) * upsample + 1;
+        DataFrame< double > dataFrame( N_rows, 2, "Time V1" );
+        for ( size_t row = 0; row < N_rows; row++ ) {
+            size_t i = row / upsample;
+            double f = (double) ( row % upsample ) / upsample;
+            size_t j = std::min( i + 1, V1.size() - 1 );
+            dataFrame( row, 0 ) = time[i] + f * ( time[j] - time[i] );
+            dataFrame( row, 1 ) = V1[i]   + f * ( V1[j]   - V1[i] ) +
+                                  noise( generator );
+        }
+
+        DataFrame< double > block = Embed( dataFrame, E, upsample, "V1" );
+
+        size_t N_lib = block.NRows() - N_pred;
+        std::stringstream lib_str;
+        std::stringstream pred_str;
+        lib_str  << 1         << " " << N_lib;
+        pred_str << N_lib + 1 << " " << block.NRows();
+
+        Parameters param( Method::Simplex, "", "", "", "",
+                          lib_str.str(), pred_str.str(), E, 1, 0, upsample );
+
+        std::cout << "BenchHNSW: library " << N_lib << " prediction "
+                  << N_pred << " E " << E << " knn " << param.knn
+                  << std::endl;
+
+        std::stringstream results;
+        results << "method,M,ef,build_s,query_s,recall\n";
+
+        //----------------------------------------------------------
+        // Exact
+        //----------------------------------------------------------
+        auto start = std::chrono::steady_clock::now();
+        Neighbors exact = FindNeighbors( block, param );
+        double bruteSeconds = Seconds( start );
+        results << "BruteForce,0,0,0," << bruteSeconds << ",1\n";
+
+        param.neighborAlgorithm = NeighborAlgorithm::KDTree;
+        start = std::chrono::steady_clock::now();
+        Neighbors kdTree = FindNeighbors( block, param );
+        results << "KDTree,0,0,0," << Seconds( start ) << ","
+                << Recall( exact, kdTree ) << "\n";
+
+        param.neighborAlgorithm = NeighborAlgorithm::HNSW;
+        start = std::chrono::steady_clock::now();
+        Neighbors hnswNeighbors = FindNeighbors( block, param );
+        results << "FindNeighbors(HNSW)," << param.hnswM << "," << param.hnswEf
+                << ",0," << Seconds( start ) << ","
+                << Recall( exact, hnswNeighbors ) << "\n";
+
+        //----------------------------------------------------------
+        // Approximate: graph build, then queries for each ef
+        //----------------------------------------------------------
+        std::vector< double > points;
+        std::vector< size_t > ids;
+        for ( size_t row = 0; row + param.Tp < N_lib; row++ ) {
+            for ( size_t col = 0; col < block.NColumns(); col++ ) {
+                points.push_back( block( row, col ) );
+            }
+            ids.push_back( row );
+        }
+
+        size_t pred_row = 0;
+        std::function< bool( size_t ) > accept =
+            [ &pred_row ]( size_t lib_row ) { return lib_row != pred_row; };
+
+        for ( int M : { 8, 16, 32 } ) {
+            HNSW< double > hnsw( block.NColumns(), DistanceMetric::Euclidean,
+                                 M );
+            start = std::chrono::steady_clock::now();
+            hnsw.Build( points, ids );
+            double buildSeconds = Seconds( start );
+
+            for ( int ef : { 13, 16, 32, 64, 128, 256 } ) {
+                Neighbors approximate;
+                approximate.neighbors = DataFrame< int >( N_pred, param.knn );
+                approximate.distances = DataFrame< double >( N_pred,
+                                                             param.knn );
+
+                std::vector< size_t > neighborIds;
+                std::vector< double > neighborDistances;
+
+                start = std::chrono::steady_clock::now();
+                for ( size_t row_i = 0; row_i < (size_t) N_pred; row_i++ ) {
+                    pred_row = param.prediction[ row_i ];
+                    hnsw.Query( &block( pred_row, 0 ), param.knn, ef, accept,
+                                neighborIds, neighborDistances );
+                    for ( size_t k = 0; k < neighborIds.size(); k++ ) {
+                        approximate.neighbors( row_i, k ) = neighborIds[ k ];
+                    }
+                }
+                double querySeconds = Seconds( start );
+
+                results << "HNSW," << M << "," << ef << "," << buildSeconds
+                        << "," << querySeconds << ","
+                        << Recall( exact, approximate ) << "\n";
+            }
+        }
+
+        std::cout << results.str();
+
+        if ( outputFile.size() ) {
+            std::ofstream outStrm( outputFile );
+            outStrm << results.str();
+        }
+    }
+    catch ( const std::exception &e ) {
+        std::cout << "Exception caught in main:\n";
+        std::cout << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -1,9 +1,33 @@
 
 #include <algorithm>
+#include <stdexcept>
 
 #include "Common.h"
 #include "AuxFunc.h"
 
+namespace {
+    thread_local MessageHandler *messageHandler = nullptr;
+}
+
+//----------------------------------------------------------------
+// Message sink
+//----------------------------------------------------------------
+void Message( const std::string &message ) {
+    if ( not messageHandler ) {
+        std::cout << message;
+    }
+    else if ( *messageHandler ) {
+        ( *messageHandler )( message );
+    }
+}
+
+MessageScope::MessageScope( MessageHandler handler ) :
+    handler( handler ), previous( messageHandler ) {
+    messageHandler = &this->handler;
+}
+
+MessageScope::~MessageScope() { messageHandler = previous; }
+
 //----------------------------------------------------------------
 // 
 //----------------------------------------------------------------
@@ -56,142 +80,179 @@ bool OnlyDigits( std::string str ) {
 std::vector<std::string> SplitString( std::string inString, 
                                       std::string delimeters ) {
 
-  size_t pos       = 0;
-  size_t eos       = 0;
-  size_t wordStart = 0;
-  size_t wordEnd   = 0;
-
-  bool foundStart = false;
-  bool foundEnd   = false;
-
-  std::vector<std::string> splitString;
-  
-  std::string word;
-
-  eos = inString.length();
-
-  while ( pos <= eos ) {
-    if ( not foundStart ) {
-      if ( delimeters.find( inString[pos] ) == delimeters.npos ) {
-	// this char (inString[pos]) is not a delimeter
-	wordStart  = pos;
-	foundStart = true;
-	pos++;
-	continue;
-      }
-    }
-    if ( foundStart and not foundEnd ) {
-      if ( delimeters.find( inString[pos] ) != delimeters.npos 
-	   or pos == eos ) {
-	// this char (inString[pos]) is a delimeter or
-	// at the end of the string
-	wordEnd  = pos;
-	foundEnd = true;
-      }
-    }
-    if ( foundStart and foundEnd ) {
-      foundStart = false;
-      foundEnd   = false;
-      
-      word = inString.substr( wordStart, wordEnd - wordStart );
-      
-      // remove whitespace
-      word.erase( std::remove_if( word.begin(), word.end(), ::isspace ),
-                  word.end() );
-      
-      splitString.push_back( word );
-    }
-    if ( pos == eos ) {
-      break;
-    }
-    pos++;
-  }
-
-  return splitString;
+    std::vector<std::string> splitString;
+    SplitString( inString, delimeters, splitString );
+    return splitString;
 }
 
 //----------------------------------------------------------------
-// 
+// SplitString into words, reusing the strings of words: repeated
+// calls on lines of similar tokens do not allocate.
 //----------------------------------------------------------------
-VectorError ComputeError( std::valarray< double > obsIn,
-                          std::valarray< double > predIn ) {
+void SplitString( const std::string        &inString,
+                  const std::string        &delimeters,
+                  std::vector<std::string> &words ) {
 
-#ifdef DEBUG_ALL
-    std::cout << "ComputeError(): obs(" << obsIn.size() << "): ";
-    for ( auto o : obsIn ) { std::cout << o << " "; }
-    std::cout << std::endl;
-    std::cout << "ComputeError(): pred(" << predIn.size() << "): ";
-    for ( auto p : predIn ) { std::cout << p << " "; }
-    std::cout << std::endl;
-#endif
+    size_t pos       = 0;
+    size_t eos       = inString.length();
+    size_t wordStart = 0;
+    size_t N_words   = 0;
+    bool   foundStart = false;
 
-    // Check for nan in vectors
-    size_t nanObs  = 0;
-    size_t nanPred = 0;
-    for ( auto o : obsIn )  { if ( std::isnan( o ) ) { nanObs++;  } }
-    for ( auto p : predIn ) { if ( std::isnan( p ) ) { nanPred++; } }
+    while ( pos <= eos ) {
+        bool delimeter = pos == eos or
+                         delimeters.find( inString[pos] ) != delimeters.npos;
 
-    if ( nanObs != nanPred ) {
-        std::stringstream errMsg;
-        errMsg << "ComputeError(): obs has " << nanObs << " nan, pred has "
-               << nanPred << " nan.  ComputeError result invalid.\n";
-        std::cout << errMsg.str() << std::flush;
+        if ( not foundStart and not delimeter ) {
+            // this char (inString[pos]) is not a delimeter
+            wordStart  = pos;
+            foundStart = true;
+        }
+        else if ( foundStart and delimeter ) {
+            // this char (inString[pos]) is a delimeter or
+            // at the end of the string
+            foundStart = false;
+
+            if ( N_words == words.size() ) {
+                words.push_back( std::string() );
+            }
+            std::string &word = words[ N_words++ ];
+            word.assign( inString, wordStart, pos - wordStart );
+
+            // remove whitespace
+            word.erase( std::remove_if( word.begin(), word.end(), ::isspace ),
+                        word.end() );
+        }
+        pos++;
     }
 
-    // JP: Assume that nan are at the beginning of predictions and
-    //     at the end of observations... probably not a robust assumption
-    std::valarray<double> pred( predIn.size() - 2 * nanPred );
-    std::valarray<double> obs ( predIn.size() - 2 * nanPred );
-    if ( nanPred > 0 ) {
-        // ignore nanPred initial pred, and nanObs end obs
-        pred = predIn[ std::slice( nanPred, pred.size() - nanPred - 1, 1 ) ];
-        obs  = obsIn [ std::slice( nanPred, pred.size() - nanPred - 1, 1 ) ];
+    words.resize( N_words );
+}
+
+//----------------------------------------------------------------
+// Error of obs and pred in one sweep, nan pairs are skipped
+//----------------------------------------------------------------
+VectorError ComputeError( const std::valarray< double > &obs,
+                          const std::valarray< double > &pred ) {
+
+    if ( obs.size() != pred.size() ) {
+        std::stringstream errMsg;
+        errMsg << "ComputeError(): obs size " << obs.size()
+               << " does not match pred size " << pred.size() << ".\n";
+        throw std::runtime_error( errMsg.str() );
     }
-    else {
-        pred = std::valarray<double>( predIn );
-        obs  = std::valarray<double>( obsIn );
+
+    ErrorAccumulator accumulator;
+    for ( size_t i = 0; i < obs.size(); i++ ) {
+        accumulator.Add( obs[ i ], pred[ i ] );
     }
 
 #ifdef DEBUG_ALL
-    std::cout << "ComputeError(): obs(" << obs.size() << "): ";
-    for ( auto o : obs ) { std::cout << o << " "; }
-    std::cout << std::endl;
-    std::cout << "ComputeError(): pred(" << pred.size() << "): ";
-    for ( auto p : pred ) { std::cout << p << " "; }
-    std::cout << std::endl;
+    std::cout << "ComputeError(): " << accumulator.Count() << " of "
+              << obs.size() << " pairs without nan." << std::endl;
 #endif
 
-    size_t N = pred.size();
-        
-    std::valarray< double > two( 2, N );
-
-    double sumPred    = pred.sum();
-    double sumObs     = obs.sum();
-    double meanPred   = sumPred / N;
-    double meanObs    = sumObs  / N;
-    double sumSqrPred = pow( pred, two ).sum();
-    double sumSqrObs  = pow( obs,  two ).sum();
-    double sumErr     = abs( obs - pred ).sum();
-    double sumSqrErr  = pow( obs - pred, two ).sum();
-    double sumProd    = ( obs * pred ).sum();
-    double rho;
-
-    if ( sumSqrPred * N == sumSqrPred ) {
-        rho = 0;
+    return accumulator.Error();
+}
+
+//----------------------------------------------------------------
+// 
+//----------------------------------------------------------------
+void ErrorAccumulator::Clear() {
+    N        = 0;
+    meanObs  = meanPred = 0;
+    M2Obs    = M2Pred   = coMoment = 0;
+    sumErr    = sumErrC    = 0;
+    sumAbsErr = sumAbsErrC = 0;
+    sumSqrErr = sumSqrErrC = 0;
+}
+
+namespace {
+    // sum += value with Kahan compensation c
+    inline void KahanAdd( double &sum, double &c, double value ) {
+        double y = value - c;
+        double t = sum + y;
+        c   = ( t - sum ) - y;
+        sum = t;
     }
-    else {
-        rho = ( sumProd - N * meanObs * meanPred ) /
-            ( std::sqrt( ( sumSqrObs  - N * pow( meanObs,  2 ) ) ) *
-              std::sqrt( ( sumSqrPred - N * pow( meanPred, 2 ) ) ) );
+}
+
+//----------------------------------------------------------------
+// Welford update of the means and co-moments with one pair
+//----------------------------------------------------------------
+void ErrorAccumulator::Add( double obs, double pred ) {
+
+    if ( std::isnan( obs ) or std::isnan( pred ) ) {
+        return;
     }
 
+    N++;
+    double deltaObs  = obs  - meanObs;
+    double deltaPred = pred - meanPred;
+    meanObs  += deltaObs  / N;
+    meanPred += deltaPred / N;
+    M2Obs    += deltaObs  * ( obs  - meanObs  );
+    M2Pred   += deltaPred * ( pred - meanPred );
+    coMoment += deltaObs  * ( pred - meanPred );
+
+    double err = pred - obs;
+    KahanAdd( sumErr,    sumErrC,    err );
+    KahanAdd( sumAbsErr, sumAbsErrC, std::abs( err ) );
+    KahanAdd( sumSqrErr, sumSqrErrC, err * err );
+}
+
+//----------------------------------------------------------------
+// Combine with the pairs of another accumulator (Chan et al.)
+//----------------------------------------------------------------
+void ErrorAccumulator::Add( const ErrorAccumulator &other ) {
+
+    if ( not other.N ) { return; }
+    if ( not N ) { *this = other; return; }
+
+    double N_a       = N;
+    double N_b       = other.N;
+    double N_ab      = N_a + N_b;
+    double deltaObs  = other.meanObs  - meanObs;
+    double deltaPred = other.meanPred - meanPred;
+
+    M2Obs    += other.M2Obs  + deltaObs  * deltaObs  * N_a * N_b / N_ab;
+    M2Pred   += other.M2Pred + deltaPred * deltaPred * N_a * N_b / N_ab;
+    coMoment += other.coMoment + deltaObs * deltaPred * N_a * N_b / N_ab;
+    meanObs  += deltaObs  * N_b / N_ab;
+    meanPred += deltaPred * N_b / N_ab;
+    N        += other.N;
+
+    KahanAdd( sumErr,    sumErrC,    other.sumErr    - other.sumErrC    );
+    KahanAdd( sumAbsErr, sumAbsErrC, other.sumAbsErr - other.sumAbsErrC );
+    KahanAdd( sumSqrErr, sumSqrErrC, other.sumSqrErr - other.sumSqrErrC );
+}
+
+//----------------------------------------------------------------
+// rho, RMSE, MAE, bias and R2 of the pairs so far.
+// All nan if no pairs, rho = 0 if obs or pred is constant.
+//----------------------------------------------------------------
+VectorError ErrorAccumulator::Error() const {
+
     VectorError vectorError = VectorError();
-    
-    vectorError.RMSE = sqrt( sumSqrErr / N );
+    vectorError.N = N;
 
-    vectorError.MAE = sumErr / N;
+    if ( not N ) {
+        vectorError.rho  = vectorError.RMSE = vectorError.MAE = NAN;
+        vectorError.bias = vectorError.R2   = NAN;
+        return vectorError;
+    }
+
+    if ( M2Obs > 0 and M2Pred > 0 ) {
+        vectorError.rho = coMoment / std::sqrt( M2Obs * M2Pred );
+    }
+    else {
+        vectorError.rho = 0;
+    }
+
+    vectorError.RMSE = std::sqrt( sumSqrErr / N );
+    vectorError.MAE  = sumAbsErr / N;
+    vectorError.bias = sumErr    / N;
+    vectorError.R2   = M2Obs > 0 ? 1 - sumSqrErr / M2Obs : NAN;
 
-    vectorError.rho = rho;
-    
     return vectorError;
 }
@@ -1,6 +1,7 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -9,6 +10,8 @@
 #include <cctype>
 #include <cmath>
 
+#include "Arena.h"
+#include "Profile.h"
 #include "DataFrame.h" // #include Common.h
 
 // Type definitions
@@ -16,13 +19,47 @@ typedef std::vector<std::pair<std::string, std::vector<double>>> NamedData;
 
 // Enumerations
 enum class Method         { None, Embed, Simplex, SMap };
-enum class DistanceMetric { Euclidean, Manhattan };
+enum class DistanceMetric { Euclidean, Manhattan, Chebyshev };
+enum class NeighborAlgorithm { BruteForce, KDTree, HNSW, VPTree };
 
 // Data structs
 struct VectorError {
     double rho;
     double RMSE;
     double MAE;
+    double bias; // mean( pred - obs )
+    double R2;   // 1 - SSE / SST of obs
+    size_t N;    // number of ( obs, pred ) pairs without nan
+};
+
+//---------------------------------------------------------
+// ErrorAccumulator
+// Single pass, allocation free accumulation of prediction error.
+// Pairs with a nan in obs or pred are skipped wherever they are.
+// Means and co-moments are updated with Welford's recurrence, the
+// error sums with Kahan compensation. Add() can be called as
+// observations stream in, Error() at any time.
+//---------------------------------------------------------
+class ErrorAccumulator {
+    size_t N;
+    double meanObs;
+    double meanPred;
+    double M2Obs;     // sum of squared deviations of obs
+    double M2Pred;    // sum of squared deviations of pred
+    double coMoment;  // sum of ( obs - meanObs ) * ( pred - meanPred )
+    double sumErr,    sumErrC;     // Kahan sums and compensations
+    double sumAbsErr, sumAbsErrC;  // of pred - obs, |pred - obs|
+    double sumSqrErr, sumSqrErrC;  // and ( pred - obs )^2
+
+public:
+    ErrorAccumulator() { Clear(); }
+
+    void   Add( double obs, double pred );
+    void   Add( const ErrorAccumulator &other ); // merge of two sweeps
+    void   Clear();
+    size_t Count() const { return N; }
+
+    VectorError Error() const;
 };
 
 struct SMapValues {
@@ -34,6 +71,27 @@ struct CCMResult {
     DataFrame< double > CCM_result;
 };
 
+//---------------------------------------------------------
+// Verbose messages and warnings of the library go to Message(): to
+// the handler of the innermost MessageScope of the calling thread,
+// else to std::cout. A scope with a null handler discards messages.
+//---------------------------------------------------------
+typedef std::function< void( const std::string & ) > MessageHandler;
+
+void Message( const std::string &message );
+
+class MessageScope {
+    MessageHandler  handler;
+    MessageHandler *previous; // handler of the enclosing scope
+
+public:
+    explicit MessageScope( MessageHandler handler );
+    ~MessageScope();
+
+    MessageScope( const MessageScope & )            = delete;
+    MessageScope &operator=( const MessageScope & ) = delete;
+};
+
 // Prototypes
 //---------------------------------------------------------
 std::string ToLower   ( std::string str );
@@ -42,8 +100,12 @@ bool        OnlyDigits( std::string str );
 std::vector<std::string> SplitString( std::string inString, 
                                       std::string delimeters = "," );
 
-VectorError ComputeError( std::valarray< double > obs,
-                          std::valarray< double > pred );
+void SplitString( const std::string        &inString,
+                  const std::string        &delimeters,
+                  std::vector<std::string> &words );
+
+VectorError ComputeError( const std::valarray< double > &obs,
+                          const std::valarray< double > &pred );
 
 DataFrame<double> Simplex( std::string pathIn       = "./data/",
                            std::string dataFile     = "",
@@ -58,7 +120,8 @@ DataFrame<double> Simplex( std::string pathIn       = "./data/",
                            std::string colNames     = "",
                            std::string targetName   = "",
                            bool        embedded     = true,
-                           bool        verbose      = true );
+                           bool        verbose      = true,
+                           std::string neighborCache= "" );
 
 SMapValues SMap( std::string pathIn          = "./data/",
                  std::string dataFile        = "",
@@ -76,7 +139,76 @@ SMapValues SMap( std::string pathIn          = "./data/",
                  std::string smapFile        = "",
                  std::string jacobians       = "",
                  bool        embedded        = true,
-                 bool        verbose         = true );
+                 bool        verbose         = true,
+                 std::string neighborCache   = "" );
+
+//---------------------------------------------------------
+// Simplex and SMap of data in memory, no file is read. dataFrame is
+// laid out as a data file: time in column 0, columns and target are
+// column names. Output files are opt-in: predictions are written to
+// pathOut/predictFile, S-Map coefficients to pathOut/smapFile, only
+// if the file name is given.
+//---------------------------------------------------------
+DataFrame<double> Simplex( const DataFrame<double> &dataFrame,
+                           std::string lib          = "1  10",
+                           std::string pred         = "11 20",
+                           int         E            = 0,
+                           int         Tp           = 1,
+                           int         knn          = 0,
+                           int         tau          = 1,
+                           std::string colNames     = "",
+                           std::string targetName   = "",
+                           bool        embedded     = true,
+                           bool        verbose      = true,
+                           std::string pathOut      = "./",
+                           std::string predictFile  = "",
+                           std::string neighborCache= "" );
+
+SMapValues SMap( const DataFrame<double> &dataFrame,
+                 std::string lib             = "1  10",
+                 std::string pred            = "11 20",
+                 int         E               = 0,
+                 int         Tp              = 1,
+                 int         knn             = 0,
+                 int         tau             = 1,
+                 double      theta           = 0,
+                 std::string columns         = "",
+                 std::string target          = "",
+                 std::string jacobians       = "",
+                 bool        embedded        = true,
+                 bool        verbose         = true,
+                 std::string pathOut         = "./",
+                 std::string predictFile     = "",
+                 std::string smapFile        = "",
+                 std::string neighborCache   = "" );
+
+//---------------------------------------------------------
+// Simplex and SMap of an embedding already made: the columns of
+// block are the E dimensions, target[ row ] the target value of
+// block row. lib and pred are block rows, Time of the output is
+// the row number, 1 for the first row.
+//---------------------------------------------------------
+DataFrame<double> Simplex( const DataFrame<double>     &block,
+                           const std::valarray<double> &target,
+                           std::string lib          = "1  10",
+                           std::string pred         = "11 20",
+                           int         Tp           = 1,
+                           int         knn          = 0,
+                           bool        verbose      = true,
+                           std::string pathOut      = "./",
+                           std::string predictFile  = "" );
+
+SMapValues SMap( const DataFrame<double>     &block,
+                 const std::valarray<double> &target,
+                 std::string lib             = "1  10",
+                 std::string pred            = "11 20",
+                 int         Tp              = 1,
+                 int         knn             = 0,
+                 double      theta           = 0,
+                 bool        verbose         = true,
+                 std::string pathOut         = "./",
+                 std::string predictFile     = "",
+                 std::string smapFile        = "" );
 
 CCMResult CCM(  std::string pathIn       = "./data/",
                 std::string dataFile     = "",
@@ -0,0 +1,288 @@
+
+#include "CrossValidation.h"
+#include "AuxFunc.h"
+#include "ThreadPool.h"
+
+namespace {
+    //------------------------------------------------------------
+    // Error of obs[ begin, end ) and pred[ begin, end )
+    //------------------------------------------------------------
+    VectorError ScoredError( const std::vector< double > &obs,
+                             const std::vector< double > &pred,
+                             size_t begin, size_t end ) {
+
+        ErrorAccumulator accumulator;
+        for ( size_t i = begin; i < end; i++ ) {
+            accumulator.Add( obs[ i ], pred[ i ] );
+        }
+        return accumulator.Error();
+    }
+
+    //------------------------------------------------------------
+    // Predict the library rows at positions [ posBegin, posEnd ),
+    // each from the rows of the other folds.
+    //------------------------------------------------------------
+    void PredictFolds( const Parameters          &param,
+                       const DataEmbedNN         &data,
+                       const NeighborIndex       &index,
+                       const std::vector< int >  &foldOfRow,
+                       size_t                     posBegin,
+                       size_t                     posEnd,
+                       std::vector< double >     &observations,
+                       std::vector< double >     &predictions ) {
+
+        std::vector< size_t > rows;
+        rows.reserve( posEnd - posBegin );
+        for ( size_t pos = posBegin; pos < posEnd; pos++ ) {
+            rows.push_back( param.library[ pos ] );
+        }
+
+        Parameters foldParam = param;
+        foldParam.prediction = IntervalSet( rows );
+
+        size_t N_columns = data.NColumns();
+
+        Neighbors neighbors;
+        neighbors.neighbors = DataFrame<int>   ( rows.size(), param.knn );
+        neighbors.distances = DataFrame<double>( rows.size(), param.knn );
+
+        size_t pred_row  = 0;
+        int    pred_fold = 0;
+        size_t radius    = std::max( param.exclusionRadius, 0 );
+        std::function< bool( size_t ) > accept =
+            [ &pred_row, &pred_fold, &foldOfRow, radius ]( size_t lib_row ) {
+                return foldOfRow[ lib_row ] != pred_fold and
+                       ( lib_row + radius < pred_row or
+                         lib_row > pred_row + radius );
+            };
+
+        std::vector< double > point( N_columns );
+        std::vector< size_t > neighborIds;
+        std::vector< double > neighborDistances;
+
+        for ( size_t row_i = 0; row_i < rows.size(); row_i++ ) {
+            pred_row  = rows[ row_i ];
+            pred_fold = foldOfRow[ pred_row ];
+
+            for ( size_t col = 0; col < N_columns; col++ ) {
+                point[ col ] = data.Block( pred_row, col );
+            }
+
+            index.Query( point.data(), param.knn, accept,
+                         neighborIds, neighborDistances );
+
+            if ( neighborIds.size() < (size_t) param.knn ) {
+                std::stringstream errMsg;
+                errMsg << "CrossValidate(): Library outside the fold of row "
+                       << pred_row << " is too small to resolve "
+                       << param.knn << " knn neighbors.\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+
+            for ( size_t k = 0; k < neighborIds.size(); k++ ) {
+                neighbors.neighbors( row_i, k ) = neighborIds[ k ];
+                neighbors.distances( row_i, k ) = neighborDistances[ k ];
+            }
+        }
+
+        DataFrame< double > output;
+        if ( param.method == Method::SMap ) {
+            output = SMapProjection( foldParam, data, neighbors ).predictions;
+        }
+        else {
+            output = SimplexProjection( foldParam, data, neighbors );
+        }
+
+        // Output row FormatOutputRow() holds the prediction of row i
+        // (column 2: Predictions of the first target)
+        for ( size_t row_i = 0; row_i < rows.size(); row_i++ ) {
+            size_t target_row = rows[ row_i ] + param.Tp;
+            size_t pos        = posBegin + row_i;
+
+            predictions [ pos ] =
+                output( FormatOutputRow( foldParam, row_i ), 2 );
+            observations[ pos ] = target_row < data.targets.NRows() ?
+                                  data.targets( target_row, 0 ) : NAN;
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// Cross validation of data in dio
+//----------------------------------------------------------------
+CrossValidationResult CrossValidate( const DataIO     &dio,
+                                     const Parameters &param,
+                                     std::string       columns,
+                                     int               folds,
+                                     size_t            nThreads ) {
+
+    if ( not param.validated ) {
+        std::string errMsg( "CrossValidate(): Parameters not validated." );
+        throw std::runtime_error( errMsg );
+    }
+
+    size_t N_rows  = param.library.size();
+    size_t N_folds = folds ? folds : N_rows;
+
+    if ( folds < 0 or N_folds < 2 or N_folds > N_rows ) {
+        std::stringstream errMsg;
+        errMsg << "CrossValidate(): " << folds << " folds is invalid for "
+               << N_rows << " library rows.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    if ( param.exclusionRadius < 0 ) {
+        std::stringstream errMsg;
+        errMsg << "CrossValidate(): exclusionRadius of "
+               << param.exclusionRadius << " must be non-negative.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    //------------------------------------------------------------
+    // Folds: contiguous positions [ foldStart[f], foldStart[f+1] )
+    // of the library rows
+    //------------------------------------------------------------
+    std::vector< size_t > foldStart( N_folds + 1 );
+    size_t maxFoldSize = 0;
+    for ( size_t f = 0; f <= N_folds; f++ ) {
+        foldStart[ f ] = f * N_rows / N_folds;
+        if ( f ) {
+            maxFoldSize = std::max( maxFoldSize,
+                                    foldStart[ f ] - foldStart[ f - 1 ] );
+        }
+    }
+
+    // S-Map knn (all neighbors by default) is limited to the rows
+    // outside of any fold, its exclusion radius and the last Tp rows
+    Parameters cvParam = param;
+    if ( param.method == Method::SMap ) {
+        int N_outside = (int) N_rows - (int) maxFoldSize -
+                        2 * param.exclusionRadius - std::max( param.Tp, 0 );
+        if ( N_outside < param.E + 1 ) {
+            std::stringstream errMsg;
+            errMsg << "CrossValidate(): " << N_outside << " rows outside of "
+                   << "a fold are too few for S-Map.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+        if ( cvParam.knn > N_outside ) {
+            cvParam.knn = N_outside;
+            if ( param.verbose ) {
+                std::stringstream msg;
+                msg << "CrossValidate(): Set knn = " << cvParam.knn
+                    << " for S-Map." << std::endl;
+                Message( msg.str() );
+            }
+        }
+    }
+
+    DataEmbedNN data = EmbedData( dio, cvParam, columns );
+
+    std::vector< int > foldOfRow( param.library.back() + 1, -1 );
+    size_t fold = 0;
+    size_t pos  = 0;
+    for ( auto row : param.library ) {
+        while ( pos >= foldStart[ fold + 1 ] ) { fold++; }
+        foldOfRow[ row ] = fold;
+        pos++;
+    }
+
+    //------------------------------------------------------------
+    // One index of all library rows for all folds
+    //------------------------------------------------------------
+    NeighborIndex index;
+    BuildBlockIndex( index, data, cvParam );
+
+    //------------------------------------------------------------
+    // Tasks of consecutive folds
+    //------------------------------------------------------------
+    std::vector< double > observations( N_rows, NAN );
+    std::vector< double > predictions ( N_rows, NAN );
+    {
+        TaskGroup group( nThreads );
+        size_t N_tasks = std::min( N_folds, 4 * group.Concurrency() );
+
+        for ( size_t task = 0; task < N_tasks; task++ ) {
+            size_t posBegin = foldStart[ task       * N_folds / N_tasks ];
+            size_t posEnd   = foldStart[ ( task + 1 ) * N_folds / N_tasks ];
+
+            group.Submit( [ &, posBegin, posEnd ]() {
+                PredictFolds( cvParam, data, index, foldOfRow, posBegin, posEnd,
+                              observations, predictions );
+            } );
+        }
+
+        group.Wait();
+    }
+
+    //------------------------------------------------------------
+    // Errors and output
+    //------------------------------------------------------------
+    CrossValidationResult result;
+
+    for ( size_t f = 0; f < N_folds; f++ ) {
+        result.foldErrors.push_back(
+            ScoredError( observations, predictions,
+                         foldStart[ f ], foldStart[ f + 1 ] ) );
+    }
+    result.error = ScoredError( observations, predictions, 0, N_rows );
+
+    result.predictions = DataFrame< double >( N_rows, 4 );
+    result.predictions.ColumnNames() = { "Time", "Observations",
+                                         "Predictions", "Fold" };
+    result.predictions.BuildColumnNameIndex();
+    pos = 0;
+    for ( auto row : param.library ) {
+        size_t target_row = row + param.Tp;
+        result.predictions( pos, 0 ) = target_row < dio.DFrame().NRows() ?
+                                       dio.DFrame()( target_row, 0 ) : NAN;
+        result.predictions( pos, 1 ) = observations[ pos ];
+        result.predictions( pos, 2 ) = predictions [ pos ];
+        result.predictions( pos, 3 ) = foldOfRow[ row ];
+        pos++;
+    }
+
+    return result;
+}
+
+//----------------------------------------------------------------
+// Cross validation of pathIn/dataFile
+//----------------------------------------------------------------
+CrossValidationResult CrossValidate( std::string       pathIn,
+                                     std::string       dataFile,
+                                     std::string       lib,
+                                     int               E,
+                                     int               Tp,
+                                     int               knn,
+                                     int               tau,
+                                     double            theta,
+                                     std::string       columns,
+                                     std::string       target,
+                                     bool              embedded,
+                                     Method            method,
+                                     int               folds,
+                                     int               exclusionRadius,
+                                     NeighborAlgorithm algorithm,
+                                     size_t            nThreads,
+                                     bool              verbose ) {
+
+    DataIO dio = DataIO( pathIn, dataFile );
+
+    if ( not lib.size() ) {
+        // All rows of the data block
+        int N_rows = dio.DFrame().NRows();
+        if ( not embedded ) {
+            N_rows = N_rows - ( E - 1 ) * tau;
+        }
+        std::stringstream lib_str;
+        lib_str << 1 << " " << N_rows;
+        lib = lib_str.str();
+    }
+
+    Parameters param = Parameters( method, pathIn, dataFile, "", "",
+                                   lib, lib, E, Tp, knn, tau, theta,
+                                   columns, target, embedded, verbose );
+
+    param.exclusionRadius   = exclusionRadius;
+    param.neighborAlgorithm = algorithm;
+
+    return CrossValidate( dio, param, columns, folds, nThreads );
+}
@@ -0,0 +1,57 @@
+#ifndef CROSSVALIDATION_H
+#define CROSSVALIDATION_H
+
+#include "Common.h"
+#include "Parameter.h"
+#include "DataIO.h"
+
+//---------------------------------------------------------
+// Cross validation of Simplex or S-Map skill.
+//
+// The library rows are split into folds of contiguous rows,
+// folds = 0 is leave-one-out (one row per fold). Each fold is
+// predicted from the rows of the other folds. One NeighborIndex of
+// all library rows is built, each fold's queries reject rows of
+// the same fold (and rows within exclusionRadius) in the index
+// traversal. Folds are evaluated in parallel on the shared pool.
+//
+// Prediction row r forecasts the target at row r + Tp, rows with
+// r + Tp beyond the data are not scored.
+//---------------------------------------------------------
+struct CrossValidationResult {
+    std::vector< VectorError > foldErrors;  // error of each fold
+    VectorError                error;       // all folds pooled
+    DataFrame< double >        predictions; // Time Observations
+                                            // Predictions Fold
+};
+
+// Cross validation of data in dio, param.library rows, param.prediction
+// is ignored. param.singlePrecision indexes the float block of the
+// embedding. Folds run on nThreads of the shared pool, 0 : all.
+CrossValidationResult CrossValidate( const DataIO     &dio,
+                                     const Parameters &param,
+                                     std::string       columns,
+                                     int               folds    = 0,
+                                     size_t            nThreads = 0 );
+
+// lib = "" : all rows of the embedding
+CrossValidationResult CrossValidate(
+    std::string       pathIn          = "./data/",
+    std::string       dataFile        = "",
+    std::string       lib             = "",
+    int               E               = 0,
+    int               Tp              = 1,
+    int               knn             = 0,
+    int               tau             = 1,
+    double            theta           = 0,
+    std::string       columns         = "",
+    std::string       target          = "",
+    bool              embedded        = false,
+    Method            method          = Method::Simplex,
+    int               folds           = 0,
+    int               exclusionRadius = 0,
+    NeighborAlgorithm algorithm       = NeighborAlgorithm::KDTree,
+    size_t            nThreads        = 0,
+    bool              verbose         = false );
+
+#endif
@@ -7,28 +7,62 @@
 // with c++11 standard template implemenations.
 // A possible solution is to link against libc++ on OSX. See ../etc/.
 
+#include <algorithm>
 #include <iomanip>
+#include <type_traits>
+#include <unordered_map>
 
 #include "Common.h"
+#include "AlignedBuffer.h"
+#include "Profile.h"
 
 // Since #include DataFrame.h is in Common.h, need forward declaration
 extern std::vector<std::string> SplitString( std::string inString, 
                                              std::string delimeters );
 
+//---------------------------------------------------------
+// Element layout policies of DataFrame
+// Index() is the offset of (row,col), RowStride() the offset between
+// the elements of a row, ColumnStride() between those of a column.
+//---------------------------------------------------------
+struct RowMajor {
+    static size_t Index( size_t row, size_t col, size_t, size_t n_columns ) {
+        return row * n_columns + col;
+    }
+    static size_t RowStride( size_t, size_t ) { return 1; }
+    static size_t ColumnStride( size_t, size_t n_columns ) {
+        return n_columns;
+    }
+};
+
+struct ColumnMajor {
+    static size_t Index( size_t row, size_t col, size_t n_rows, size_t ) {
+        return col * n_rows + row;
+    }
+    static size_t RowStride( size_t n_rows, size_t ) { return n_rows; }
+    static size_t ColumnStride( size_t, size_t ) { return 1; }
+};
+
 //---------------------------------------------------------
 // DataFrame class
-// Data container is a single, contiguous valarray.
+// Data container is a single, contiguous AlignedBuffer starting on a
+// 64 byte cache line, ordered by Layout: RowMajor (default) for row
+// operations such as neighbor distances, ColumnMajor for column
+// operations such as embedding. DataFrame< T, L >( dataFrame ) converts
+// between layouts with a blocked transpose.
+// Constructors taking Uninitialized() skip zeroing the elements when
+// all are written after construction.
 // DataFrame access is through the () operator: (row,col).
 //---------------------------------------------------------
-template <class T>
+template <class T, class Layout = RowMajor>
 class DataFrame {
     
-    std::valarray<T> elements;
+    AlignedBuffer<T> elements;
     size_t           n_columns;
     size_t           n_rows;
     
-    std::vector< std::string >      columnNames;
-    std::map< std::string, size_t > columnNameToIndex;
+    std::vector< std::string >                  columnNames;
+    std::unordered_map< std::string, size_t >   columnNameToIndex;
     
     size_t maxRowPrint;
     
@@ -36,18 +70,22 @@ public:
     //-----------------------------------------------------------------
     // Constructors
     //-----------------------------------------------------------------
-    DataFrame () {}
+    DataFrame () : n_columns( 0 ), n_rows( 0 ), maxRowPrint( 10 ) {}
     
     //-----------------------------------------------------------------
     DataFrame( size_t rows, size_t columns ):
         n_rows( rows ), n_columns( columns ), elements( columns * rows ),
-        maxRowPrint( 10 ) {}
+        maxRowPrint( 10 )
+    {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+    }
     
     //-----------------------------------------------------------------
     DataFrame( size_t rows, size_t columns, std::string colNames ):
         n_rows( rows ), n_columns( columns ), elements( columns * rows ),
         columnNames( std::vector<std::string>(columns) ), maxRowPrint( 10 )
     {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
         BuildColumnNameIndex( colNames );
     }
    
@@ -57,6 +95,77 @@ public:
         n_rows( rows ), n_columns( columns ), elements( columns * rows ),
         columnNames( columnNames ), maxRowPrint( 10 )
     {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+        BuildColumnNameIndex();
+    }
+
+    //-----------------------------------------------------------------
+    // Uninitialized elements
+    //-----------------------------------------------------------------
+    DataFrame( size_t rows, size_t columns, Uninitialized u ):
+        n_rows( rows ), n_columns( columns ), elements( columns * rows, u ),
+        maxRowPrint( 10 )
+    {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+    }
+
+    //-----------------------------------------------------------------
+    DataFrame( size_t rows, size_t columns, std::string colNames,
+               Uninitialized u ):
+        n_rows( rows ), n_columns( columns ), elements( columns * rows, u ),
+        columnNames( std::vector<std::string>(columns) ), maxRowPrint( 10 )
+    {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+        BuildColumnNameIndex( colNames );
+    }
+
+    //-----------------------------------------------------------------
+    DataFrame( size_t rows, size_t columns,
+               std::vector< std::string > columnNames, Uninitialized u ):
+        n_rows( rows ), n_columns( columns ), elements( columns * rows, u ),
+        columnNames( columnNames ), maxRowPrint( 10 )
+    {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+        BuildColumnNameIndex();
+    }
+
+    //-----------------------------------------------------------------
+    // Element type and layout conversion:
+    //   DataFrame<float>( DataFrame<double> )
+    //   DataFrame<double,ColumnMajor>( DataFrame<double> )
+    //-----------------------------------------------------------------
+    template< class U, class L >
+    explicit DataFrame( const DataFrame< U, L > &dataFrame ):
+        n_rows( dataFrame.NRows() ), n_columns( dataFrame.NColumns() ),
+        elements( dataFrame.NRows() * dataFrame.NColumns(),
+                  Uninitialized() ),
+        columnNames( dataFrame.ColumnNames() ), maxRowPrint( 10 )
+    {
+        EDM_PROFILE_COUNT( DataFrameConstructions, 1 );
+
+        const U *in  = dataFrame.Data();
+        T       *out = elements.data();
+
+        if ( std::is_same< L, Layout >::value ) {
+            std::copy( in, in + size(), out );
+        }
+        else {
+            // Transpose by tiles of block x block elements that stay in
+            // cache for both the strided reads and the writes
+            const size_t block = 16;
+            for ( size_t row0 = 0; row0 < n_rows; row0 += block ) {
+                size_t row1 = std::min( row0 + block, n_rows );
+                for ( size_t col0 = 0; col0 < n_columns; col0 += block ) {
+                    size_t col1 = std::min( col0 + block, n_columns );
+                    for ( size_t row = row0; row < row1; row++ ) {
+                        for ( size_t col = col0; col < col1; col++ ) {
+                            out[ Layout::Index( row, col, n_rows, n_columns ) ]
+                                = in[ L::Index( row, col, n_rows, n_columns ) ];
+                        }
+                    }
+                }
+            }
+        }
         BuildColumnNameIndex();
     }
    
@@ -64,17 +173,21 @@ public:
     // Fortran style access operators M(row,col)
     //-----------------------------------------------------------------
     T &operator()( size_t row, size_t column ) {
-        return elements[ row * n_columns + column ];
+        return elements[ Layout::Index( row, column, n_rows, n_columns ) ];
     }
-    T operator()( size_t row, size_t column ) const {
-        return elements[ row * n_columns + column ];
+    const T &operator()( size_t row, size_t column ) const {
+        return elements[ Layout::Index( row, column, n_rows, n_columns ) ];
     }
 
     //-----------------------------------------------------------------
     // Member Accessors
     //-----------------------------------------------------------------
-    std::valarray<T>  Elements() const { return elements; }
-    std::valarray<T> &Elements()       { return elements; }
+    const AlignedBuffer<T> &Elements() const { return elements; }
+    AlignedBuffer<T>       &Elements()       { return elements; }
+
+    // Elements in Layout order, 64 byte aligned
+    const T *Data() const { return elements.data(); }
+    T       *Data()       { return elements.data(); }
     
     size_t NColumns() const { return n_columns; }
     size_t NRows()    const { return n_rows;    }
@@ -83,12 +196,10 @@ public:
     std::vector< std::string >  ColumnNames() const { return columnNames; }
     std::vector< std::string > &ColumnNames()       { return columnNames; }
     
-    std::map< std::string, size_t > ColumnNameToIndex() const {
-        return columnNameToIndex;
-    }
-    std::map< std::string, size_t > &ColumnNameToIndex() {
-        return columnNameToIndex;
-    }
+    const std::unordered_map< std::string, size_t > &
+    ColumnNameToIndex() const { return columnNameToIndex; }
+    std::unordered_map< std::string, size_t > &
+    ColumnNameToIndex()       { return columnNameToIndex; }
 
     size_t &MaxRowPrint()       { return maxRowPrint; }
     size_t  MaxRowPrint() const { return maxRowPrint; }
@@ -97,27 +208,96 @@ public:
     // Return column from index col
     //-----------------------------------------------------------------
     std::valarray<T> Column( size_t col ) const {
-        // slice (size_t start, size_t length, size_t stride)
-        return elements[ std::slice( col, n_rows, n_columns ) ];
+        const T *element = elements.data() +
+                           Layout::Index( 0, col, n_rows, n_columns );
+        size_t   stride  = Layout::ColumnStride( n_rows, n_columns );
+        if ( stride == 1 ) {
+            return std::valarray<T>( element, n_rows );
+        }
+        std::valarray<T> column( n_rows );
+        for ( size_t row = 0; row < n_rows; row++ ) {
+            column[ row ] = element[ row * stride ];
+        }
+        return column;
     }
 
     //-----------------------------------------------------------------
     // Return row from index row
     //-----------------------------------------------------------------
     std::valarray<T> Row( size_t row ) const {
-        // slice (size_t start, size_t length, size_t stride)
-        return elements[ std::slice( row * n_columns, n_columns, 1 ) ];
+        const T *element = elements.data() +
+                           Layout::Index( row, 0, n_rows, n_columns );
+        size_t   stride  = Layout::RowStride( n_rows, n_columns );
+        if ( stride == 1 ) {
+            return std::valarray<T>( element, n_columns );
+        }
+        std::valarray<T> rowVec( n_columns );
+        for ( size_t col = 0; col < n_columns; col++ ) {
+            rowVec[ col ] = element[ col * stride ];
+        }
+        return rowVec;
+    }
+
+    //------------------------------------------------------------------
+    // Column index of name through columnNameToIndex. An index entry
+    // that is missing or stale (columnNames changed without
+    // BuildColumnNameIndex()) falls back to a scan of columnNames.
+    // Return false if name is not a column.
+    //------------------------------------------------------------------
+    bool FindColumn( const std::string &name, size_t &col ) const {
+        auto ci = columnNameToIndex.find( name );
+        if ( ci != columnNameToIndex.end() and
+             ci->second < columnNames.size() and
+             columnNames[ ci->second ] == name ) {
+            col = ci->second;
+            return true;
+        }
+        auto ni = std::find( columnNames.begin(), columnNames.end(), name );
+        if ( ni == columnNames.end() ) {
+            return false;
+        }
+        col = std::distance( columnNames.begin(), ni );
+        return true;
+    }
+
+    //------------------------------------------------------------------
+    // Resolve column names to column indices in one pass
+    //------------------------------------------------------------------
+    std::vector< size_t > ColumnIndices(
+        const std::vector< std::string > &names ) const {
+
+        std::vector< size_t >      indices( names.size() );
+        std::vector< std::string > missing;
+
+        for ( size_t i = 0; i < names.size(); i++ ) {
+            if ( not FindColumn( names[ i ], indices[ i ] ) ) {
+                missing.push_back( names[ i ] );
+            }
+        }
+
+        if ( missing.size() ) {
+            std::stringstream errMsg;
+            errMsg << "DataFrame::ColumnIndices() "
+                      "Failed to find columns:\n[ ";
+            for ( auto ci = missing.begin(); ci != missing.end(); ++ci ) {
+                errMsg << *ci << " ";
+            } errMsg << "]" << std::endl;
+            errMsg << "in DataFrame columns:\n[ ";
+            for (auto ci = columnNames.begin(); ci != columnNames.end(); ++ci){
+                errMsg << *ci << " ";
+            } errMsg << "]" << std::endl;
+            throw std::runtime_error( errMsg.str() );
+        }
+        return indices;
     }
 
     //------------------------------------------------------------------
     // Return data column selected by column name
     //------------------------------------------------------------------
-    std::valarray< double > VectorColumnName( std::string column ) {
+    std::valarray< double > VectorColumnName( std::string column ) const {
         
-        std::vector< std::string >::iterator ci = std::find(columnNames.begin(),
-                                                            columnNames.end(),
-                                                            column );
-        if ( ci == columnNames.end() ) {
+        size_t col_i;
+        if ( not FindColumn( column, col_i ) ) {
             std::stringstream errMsg;
             errMsg << "DataFrame::VectorColumnName() Failed to find column: "
                    << column;
@@ -129,8 +309,6 @@ public:
             throw std::runtime_error( errMsg.str() );
         }
         
-        size_t col_i = std::distance( columnNames.begin(), ci );
-        
         std::valarray<double> vec = Column( col_i );
         
         return vec;
@@ -139,15 +317,10 @@ public:
     //-----------------------------------------------------------------
     // Return (sub)DataFrame of specified column indices
     //-----------------------------------------------------------------
-    DataFrame<double> DataFrameFromColumnIndex( std::vector<size_t> columns ) {
-        
-        DataFrame<double> M = DataFrame( n_rows, columns.size() );
-
-        size_t col_j = 0;
+    DataFrame<double> DataFrameFromColumnIndex( std::vector<size_t> columns )
+        const {
         
-        for ( size_t i = 0; i < columns.size(); i++ ) {
-            size_t col_i = columns[ i ];
-
+        for ( auto col_i : columns ) {
             if ( col_i >= n_columns ) {
                 std::stringstream errMsg;
                 errMsg << "DataFrame::DataFrameFromColumnIndex(): "
@@ -155,11 +328,14 @@ public:
                        << col_i << ") exceeds the data frame domain.\n";
                 throw std::runtime_error( errMsg.str() );
             }
-            
-            std::valarray<double> column_vec_i = Column( col_i );
+        }
 
-            M.WriteColumn( col_j, column_vec_i );
-            col_j++;
+        DataFrame<double> M( n_rows, columns.size(), Uninitialized() );
+
+        for ( size_t row = 0; row < n_rows; row++ ) {
+            for ( size_t col_j = 0; col_j < columns.size(); col_j++ ) {
+                M( row, col_j ) = (*this)( row, columns[ col_j ] );
+            }
         }
         
         return M;
@@ -167,40 +343,13 @@ public:
 
     //------------------------------------------------------------------
     // Return (sub)DataFrame selected by columnNames
-    // columnNames converted to column indices for DataFrameFromColumnIndex()
+    // columnNames resolved by ColumnIndices() for DataFrameFromColumnIndex()
     //------------------------------------------------------------------
     DataFrame< double > DataFrameFromColumnNames(
-        std::vector<std::string> colNames ) {
+        std::vector<std::string> colNames ) const {
 
-        // vector of column indices for dataDataFrame.DataFrameFromColumnIndex()
-        std::vector<size_t> col_i_vec;
-        
-        // Map column names to indices
-        std::vector<std::string>::iterator si;
-        for ( auto ci = colNames.begin(); ci != colNames.end(); ++ci ) {
-            auto si = find( columnNames.begin(), columnNames.end(), *ci );
-            
-            if ( si != columnNames.end() ) {
-                col_i_vec.push_back( std::distance( columnNames.begin(), si ) );
-            }
-        }
-        
-        // Validation
-        if ( col_i_vec.size() != colNames.size() ) {
-            std::stringstream errMsg;
-            errMsg << "DataFrame::DataFrameFromColumnNames() "
-                      "Failed to find columns:\n[ ";
-            for ( auto ci = colNames.begin(); ci != colNames.end(); ++ci ){
-                errMsg << *ci << " ";
-            } errMsg << "]" << std::endl;
-            errMsg << "in DataFrame columns:\n[ ";
-            for (auto ci = columnNames.begin(); ci != columnNames.end(); ++ci){
-                errMsg << *ci << " ";
-            } errMsg << "]" << std::endl;
-            throw std::runtime_error( errMsg.str() );
-        }
-        
-        DataFrame<double> M_col = DataFrameFromColumnIndex( col_i_vec );
+        DataFrame<double> M_col =
+            DataFrameFromColumnIndex( ColumnIndices( colNames ) );
         
         // Now insert the columnNames
         M_col.ColumnNames() = colNames;
@@ -259,9 +408,7 @@ public:
                 throw std::runtime_error( errMsg.str() );
             }
         }
-        for ( size_t i = 0; i < columnNames.size(); i++ ) {
-            columnNameToIndex[ columnNames[i] ] = i;
-        }
+        BuildIndex();
     }
 
     //-----------------------------------------------------------------
@@ -279,19 +426,31 @@ public:
                 throw std::runtime_error( errMsg.str() );
             }
         }
-        for ( size_t i = 0; i < columnNames.size(); i++ ) {
-            columnNameToIndex[ columnNames[i] ] = i;
-        }
+        BuildIndex();
         
 #ifdef DEBUG_ALL
         std::cout << "DataFrame::BuildColumnNameIndex()\n";
         for ( size_t i = 0; i < columnNames.size(); i++ ) {
             std::cout << columnNames[i] << " : "
                       << columnNameToIndex[ columnNames[i] ] << "   ";
-            columnNameToIndex[ columnNames[i] ] = i;
         } std::cout << std::endl;
 #endif
     }
+
+private:
+    //-----------------------------------------------------------------
+    // Rebuild columnNameToIndex from columnNames, the first of
+    // duplicate names is indexed
+    //-----------------------------------------------------------------
+    void BuildIndex() {
+        columnNameToIndex.clear();
+        columnNameToIndex.reserve( columnNames.size() );
+        for ( size_t i = 0; i < columnNames.size(); i++ ) {
+            columnNameToIndex.emplace( columnNames[i], i );
+        }
+    }
+
+public:
     
     //------------------------------------------------------------------
     // Print DataFrame to ostream
@@ -29,6 +29,8 @@ DataIO::DataIO ( const DataFrame<double> & data, size_t maxPrint ) :
 //------------------------------------------------------------------
 DataFrame< double > DataIO::SetupDataFrame ( NamedData csvInput ) {
 
+    EDM_PROFILE_SCOPE( SetupDataFrame );
+
     // Setup column names in same order as dataFrame
     std::vector< std::string > colNames;
     for ( NamedData::iterator iterate = csvInput.begin(); 
@@ -41,7 +43,8 @@ DataFrame< double > DataIO::SetupDataFrame ( NamedData csvInput ) {
     const size_t numCols = csvInput.size();
 
     // Initialize a DataFrame() object with (numRows, numCols, colNames)
-    DataFrame<double> dataFrame = DataFrame<double>(numRows, numCols, colNames);
+    DataFrame<double> dataFrame = DataFrame<double>(numRows, numCols, colNames,
+                                                    Uninitialized());
 
     // Transfer each data value into the data frame
     //    Another option is to use the writeColumn() DataFrame method
@@ -63,7 +66,9 @@ DataFrame< double > DataIO::SetupDataFrame ( NamedData csvInput ) {
 // 
 //----------------------------------------------------------------
 NamedData DataIO::ReadData() {
-    
+
+    EDM_PROFILE_SCOPE( ReadData );
+
     // Create input file stream and open file for input
     std::ifstream dataStrm( path + fileName );
     
@@ -133,12 +138,16 @@ NamedData DataIO::ReadData() {
     for ( size_t colIdx = 0; colIdx < colNames.size(); colIdx++ ) {
         NamedData::value_type colPair ( colNames[colIdx],
                                         std::vector<double>());
+        colPair.second.reserve( dataLines.size() );
         namedData.push_back ( colPair );
     }
     
     // Process each line in dataLines to fill in data vectors
+    // words are reused line to line
+    const std::string        delimeters( "," );
+    std::vector<std::string> words;
     for ( size_t lineIdx = 0; lineIdx < dataLines.size(); lineIdx++ ) {
-        std::vector<std::string> words = SplitString( dataLines[ lineIdx ] );
+        SplitString( dataLines[ lineIdx ], delimeters, words );
         for ( size_t colIdx = 0; colIdx < colNames.size(); colIdx++ ) {
             namedData[ colIdx ].second.push_back( std::stod( words[colIdx] ) );
         } 
@@ -169,6 +178,9 @@ NamedData DataIO::ReadData() {
 //  @return: none
 //------------------------------------------------------------------
 void DataIO::WriteData(std::string outputFilePath, std::string outputFileName) {
+
+    EDM_PROFILE_SCOPE( WriteData );
+
     //to hold the lines to print to the output file
     std::vector< std::string > fileLines;
 
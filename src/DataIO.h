@@ -44,7 +44,7 @@ public:
     size_t NumRows()     const { return dataFrame.NRows();    }
     
     DataFrame< double > &DFrame()        { return dataFrame; }
-    DataFrame< double >  DFrame()  const { return dataFrame; }
+    const DataFrame< double > &DFrame() const { return dataFrame; }
 
     // Overloads
 };
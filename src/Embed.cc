@@ -20,74 +20,60 @@ DataFrame< double > Embed ( std::string path,
                             std::string columns,
                             bool        verbose ) {
     
-    // Parameter.Validate() will convert columns into a vector of names
-    // or a vector of column indices
-    Parameters param = Parameters( Method::Embed, path, dataFile, "", "",
-                                   "1 1", "1 1", E, 0, 0, tau, 0,
-                                   columns, "", false, verbose );
-
     // Load dataFrame with column from path/file
-    // JP This is possibly redundant file I/O if called from another function
-    DataIO dio = DataIO( param.pathIn, param.dataFile );
+    DataIO dio = DataIO( path, dataFile );
     
-    // Extract the specified columns into a new dataFrame for MakeBlock
-    DataFrame< double > dataFrame;
-    std::vector< std::string > colNames;
-
-    if ( param.columnNames.size() ) {
-        // columns names are strings, use as-is
-        colNames  = param.columnNames;
-        dataFrame = dio.DFrame().DataFrameFromColumnNames(param.columnNames);
-    }
-    else if ( param.columnIndex.size() ) {
-        // columns are indices : Create column names for MakeBlock
-        for ( size_t i = 0; i < param.columnIndex.size(); i++ ) {
-            std::stringstream ss;
-            ss << "V" << param.columnIndex[i];
-            colNames.push_back( ss.str() );
-        }
-        dataFrame = dio.DFrame().DataFrameFromColumnIndex(param.columnIndex);
-    }
-    else {
-        throw std::runtime_error( "Embed(file): columnNames and columnIndex "
-                                  " are empty.\n" );
-    }
-    
-    DataFrame< double > embedding = MakeBlock( dataFrame, E, tau,
-                                               colNames, verbose );
-    return embedding;
+    return Embed( dio.DFrame(), E, tau, columns, verbose );
 }
 
 //---------------------------------------------------------
 // Embed dataFrame
 // dataFrame is passed in as a parameter
-// Note: dataFrame must have the columnNameToIndex map 
+// Column names are resolved through the columnNameToIndex map
 //---------------------------------------------------------
-DataFrame< double > Embed ( DataFrame< double > dataFrameIn,
-                            int                 E,
-                            int                 tau,
-                            std::string         columns,
-                            bool                verbose ) {
+DataFrame< double > Embed ( const DataFrame< double > &dataFrameIn,
+                            int                        E,
+                            int                        tau,
+                            std::string                columns,
+                            bool                       verbose ) {
+
+    std::vector< size_t >      columnIndex;
+    std::vector< std::string > colNames;
     
+    EmbedColumns( dataFrameIn, columns, columnIndex, colNames );
+
+    // Embed the columns directly from dataFrameIn, no (sub)DataFrame
+    DataFrame< double > embedding = MakeBlock( dataFrameIn, E, tau,
+                                               columnIndex, colNames,
+                                               verbose );
+    return embedding;
+}
+
+//---------------------------------------------------------
+// Resolve columns to dataFrame column indices and names
+//---------------------------------------------------------
+void EmbedColumns( const DataFrame< double > &dataFrame,
+                   std::string                columns,
+                   std::vector<size_t>       &columnIndex,
+                   std::vector<std::string>  &colNames ) {
+
     // Parameter.Validate will convert columns into a vector of names
     // or a vector of column indices
     Parameters param = Parameters( Method::Embed, "", "", "", "",
-                                   "1 1", "1 1", E, 0, 0, tau, 0,
-                                   columns, "", false, verbose );
+                                   "1 1", "1 1", 0, 0, 0, 1, 0,
+                                   columns, "", false, false );
 
-    if ( not param.columnIndex.size() and
-         dataFrameIn.ColumnNameToIndex().empty() ) {
-        throw std::runtime_error( "Embed(DataFrame): columnNameIndex empty.\n" );
-    }
+    columnIndex.clear();
+    colNames.clear();
 
-    // Get column names for MakeBlock
-    std::vector< std::string > colNames;
     if ( param.columnNames.size() ) {
         // column names are strings use as-is
-        colNames = param.columnNames;
+        colNames    = param.columnNames;
+        columnIndex = dataFrame.ColumnIndices( param.columnNames );
     }
     else if ( param.columnIndex.size() ) {
         // columns are indices : Create column names for MakeBlock
+        columnIndex = param.columnIndex;
         for ( size_t i = 0; i < param.columnIndex.size(); i++ ) {
             std::stringstream ss;
             ss << "V" << param.columnIndex[i];
@@ -98,36 +84,33 @@ DataFrame< double > Embed ( DataFrame< double > dataFrameIn,
         throw std::runtime_error( "Embed(DataFrame): columnNames and "
                                   " columnIndex are empty.\n" );
     }
+}
 
-    // Extract the specified columns (sub)DataFrame from dataFrameIn
-    DataFrame< double > dataFrame;
+//---------------------------------------------------------
+// Embedded data frame column names X(t-0) X(t-1)...
+//---------------------------------------------------------
+std::vector<std::string> EmbedColumnNames( std::vector<std::string> columnNames,
+                                           int                      E ) {
     
-    if ( param.columnNames.size() ) {
-        // Get a vector of column indices 
-        std::vector< size_t > col_i;
-        for ( auto colName : param.columnNames ) {
-            col_i.push_back( dataFrameIn.ColumnNameToIndex()[ colName ] );
+    std::vector< std::string > newColumnNames;
+    for ( size_t col = 0; col < columnNames.size(); col ++ ) {
+        for ( size_t e = 0; e < E; e++ ) {
+            std::stringstream ss;
+            ss << columnNames[ col ] << "(t-" << e << ")";
+            newColumnNames.push_back( ss.str() );
         }
-        dataFrame = dataFrameIn.DataFrameFromColumnIndex( col_i );
     }
-    else if ( param.columnIndex.size() ) {
-        // alread have column indices
-        dataFrame = dataFrameIn.DataFrameFromColumnIndex( param.columnIndex );
-    }
-
-    DataFrame< double > embedding = MakeBlock( dataFrame, E, tau,
-                                               colNames, verbose );
-    return embedding;
+    return newColumnNames;
 }
 
 //---------------------------------------------------------
 // MakeBlock from dataFrame
 //---------------------------------------------------------
-DataFrame< double > MakeBlock ( DataFrame< double >      dataFrame,
-                                int                      E,
-                                int                      tau,
-                                std::vector<std::string> columnNames,
-                                bool                     verbose ) {
+DataFrame< double > MakeBlock ( const DataFrame< double > &dataFrame,
+                                int                        E,
+                                int                        tau,
+                                std::vector<std::string>   columnNames,
+                                bool                       verbose ) {
 
     if ( columnNames.size() != dataFrame.NColumns() ) {
         std::stringstream errMsg;
@@ -136,60 +119,211 @@ DataFrame< double > MakeBlock ( DataFrame< double >      dataFrame,
                << "of columns specified (" << columnNames.size() << ").\n";;
         throw std::runtime_error( errMsg.str() );
     }
+
+    std::vector< size_t > columnIndex( dataFrame.NColumns() );
+    std::iota( columnIndex.begin(), columnIndex.end(), 0 );
     
-    size_t NRows    = dataFrame.NRows();        // number of input rows
-    size_t NColOut  = dataFrame.NColumns() * E; // number of output columns
-    size_t NPartial = tau * (E-1);              // rows to shift & delete
+    return MakeBlock( dataFrame, E, tau, columnIndex, columnNames, verbose );
+}
 
-    // temporary data frame to hold the embedded (shifted) data
-    DataFrame< double > shiftDataFrame( NRows, NColOut );
+//---------------------------------------------------------
+// Validate MakeBlock() arguments, return the number of partial rows
+// removed from the top of the block, reported if verbose
+//---------------------------------------------------------
+namespace {
+    size_t MakeBlockPartialRows( size_t                          NRows,
+                                 size_t                          NColumns,
+                                 int                             E,
+                                 int                             tau,
+                                 const std::vector<size_t>      &columnIndex,
+                                 const std::vector<std::string> &columnNames,
+                                 bool                            verbose ) {
 
-    // Create embedded data frame column names X(t-0) X(t-1)...
-    std::vector< std::string > newColumnNames( NColOut );
-    size_t newCol_i = 0;
-    for ( size_t col = 0; col < columnNames.size(); col ++ ) {
-        for ( size_t e = 0; e < E; e++ ) {
-            std::stringstream ss;
-            ss << columnNames[ col ] << "(t-" << e << ")";
-            newColumnNames[ newCol_i ] = ss.str();
-            newCol_i++;
+        if ( columnNames.size() != columnIndex.size() ) {
+            std::stringstream errMsg;
+            errMsg << "MakeBlock: The number of column names ("
+                   << columnNames.size() << ") is not equal to the number "
+                   << "of columns specified (" << columnIndex.size()
+                   << ").\n";
+            throw std::runtime_error( errMsg.str() );
         }
+        for ( auto col_i : columnIndex ) {
+            if ( col_i >= NColumns ) {
+                std::stringstream errMsg;
+                errMsg << "MakeBlock: column index " << col_i
+                       << " exceeds the " << NColumns
+                       << " dataFrame columns.\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+        }
+        if ( E < 1 or tau < 1 ) {
+            std::stringstream errMsg;
+            errMsg << "MakeBlock: E (" << E << ") and tau (" << tau
+                   << ") must be at least 1.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        size_t NPartial = tau * (E-1);              // rows with partial data
+
+        if ( NPartial >= NRows ) {
+            std::stringstream errMsg;
+            errMsg << "MakeBlock: tau * (E-1) = " << NPartial
+                   << " leaves no rows of the " << NRows << " input rows.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        if ( verbose ) {
+            std::stringstream msg;
+            msg << "MakeBlock(): E = " << E << " tau = " << tau << " : "
+                << NPartial << " partial rows removed, "
+                << NRows - NPartial << " rows.\n";
+            Message( msg.str() );
+        }
+
+        return NPartial;
     }
+}
 
-    // Ouput data frame with tau * E-1 fewer rows
-    DataFrame< double > embedding( NRows - NPartial, NColOut, newColumnNames );
+//---------------------------------------------------------
+// MakeBlock from the columnIndex columns of dataFrame
+// Single pass: each embedding element is written once from
+// x[ t - e * tau ] of its source column, converted to T.
+//---------------------------------------------------------
+template< class T >
+DataFrame< T > MakeBlock ( const DataFrame< double > &dataFrame,
+                           int                        E,
+                           int                        tau,
+                           std::vector<size_t>        columnIndex,
+                           std::vector<std::string>   columnNames,
+                           bool                       verbose ) {
 
-    // slice indices for each column of original & shifted data
-    std::slice slice_i = std::slice (0, NRows, 1);
+    EDM_PROFILE_SCOPE( MakeBlock );
 
-    // to keep track of where to insert column in new data frame
-    size_t colCount = 0;
+    size_t NRows    = dataFrame.NRows();        // number of input rows
+    size_t NColIn   = columnIndex.size();       // number of input columns
+    size_t NColOut  = NColIn * E;               // number of output columns
+    size_t NPartial = MakeBlockPartialRows( NRows, dataFrame.NColumns(),
+                                            E, tau, columnIndex,
+                                            columnNames, verbose );
 
-    // shift column data and write to temporary data frame
-    for ( size_t col = 0; col < dataFrame.NColumns(); col++ ) {
-        // for each embedding dimension
-        for ( size_t e = 0; e < E; e++ ) {
+    // Ouput data frame with tau * E-1 fewer rows
+    DataFrame< T > embedding( NRows - NPartial, NColOut,
+                              EmbedColumnNames( columnNames, E ),
+                              Uninitialized() );
 
-            std::valarray< double > column = dataFrame.Column( col );
+    for ( size_t row = 0; row < NRows - NPartial; row++ ) {
+        T *embedRow = &embedding( row, 0 );
+        
+        for ( size_t col = 0; col < NColIn; col++ ) {
+            size_t col_i = columnIndex[ col ];
             
-            std::valarray< double > tmp = column.shift( -e * tau )[slice_i];
+            for ( size_t e = 0; e < E; e++ ) {
+                embedRow[ col * E + e ] =
+                    dataFrame( row + NPartial - e * tau, col_i );
+            }
+        }
+    }
+    
+    return embedding;
+}
+
+// Value types of the block
+template DataFrame< double > MakeBlock( const DataFrame< double > &, int,
+                                        int, std::vector<size_t>,
+                                        std::vector<std::string>, bool );
+template DataFrame< float  > MakeBlock( const DataFrame< double > &, int,
+                                        int, std::vector<size_t>,
+                                        std::vector<std::string>, bool );
+
+//---------------------------------------------------------
+// MakeBlock in column major layout
+// Embedding column ( col, e ) is the contiguous run of source column
+// col starting at row NPartial - e * tau: one copy per column.
+//---------------------------------------------------------
+DataFrame< double, ColumnMajor > MakeBlock (
+    const DataFrame< double, ColumnMajor > &dataFrame,
+    int                                     E,
+    int                                     tau,
+    std::vector<size_t>                     columnIndex,
+    std::vector<std::string>                columnNames,
+    bool                                    verbose ) {
+
+    EDM_PROFILE_SCOPE( MakeBlock );
 
-            // These will be deleted, but set to NAN for completeness
-            tmp[ std::slice( 0, e * tau, 1 ) ] = NAN;
+    size_t NRows    = dataFrame.NRows();        // number of input rows
+    size_t NColIn   = columnIndex.size();       // number of input columns
+    size_t NColOut  = NColIn * E;               // number of output columns
+    size_t NPartial = MakeBlockPartialRows( NRows, dataFrame.NColumns(),
+                                            E, tau, columnIndex,
+                                            columnNames, verbose );
+    size_t NRowsOut = NRows - NPartial;
+
+    DataFrame< double, ColumnMajor > embedding(
+        NRowsOut, NColOut, EmbedColumnNames( columnNames, E ),
+        Uninitialized() );
 
-            shiftDataFrame.WriteColumn( colCount, tmp );
-            colCount++;
+    for ( size_t col = 0; col < NColIn; col++ ) {
+        const double *column = &dataFrame( 0, columnIndex[ col ] );
+        
+        for ( size_t e = 0; e < E; e++ ) {
+            const double *lag = column + NPartial - e * tau;
+            std::copy( lag, lag + NRowsOut, &embedding( 0, col * E + e ) );
         }
     }
+    
+    return embedding;
+}
 
-    // Delete rows with partial data
-    slice_i = std::slice ( NPartial, NRows - NPartial, 1 );
+//---------------------------------------------------------
+// EmbeddingView Constructor
+// Only the embedded columns of dataFrame are held.
+//---------------------------------------------------------
+EmbeddingView::EmbeddingView( const DataFrame< double > &dataFrame,
+                              int                        E,
+                              int                        tau,
+                              std::vector<size_t>        columnIndex,
+                              std::vector<std::string>   colNames ) :
+    E( E ), tau( tau ), NPartial( tau * (E-1) )
+{
+    if ( colNames.size() != columnIndex.size() ) {
+        std::stringstream errMsg;
+        errMsg << "EmbeddingView: The number of column names ("
+               << colNames.size() << ") is not equal to the number "
+               << "of columns specified (" << columnIndex.size() << ").\n";;
+        throw std::runtime_error( errMsg.str() );
+    }
+    if ( E < 1 or tau < 1 or NPartial >= dataFrame.NRows() ) {
+        std::stringstream errMsg;
+        errMsg << "EmbeddingView: E (" << E << ") and tau (" << tau
+               << ") invalid for " << dataFrame.NRows() << " rows.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    source      = dataFrame.DataFrameFromColumnIndex( columnIndex );
+    columnNames = EmbedColumnNames( colNames, E );
+}
 
-    // Write shifted columns to the output embedding DataFrame
-    for ( size_t i = 0; i < NColOut; i++ ) {
-        std::valarray< double > tmp = shiftDataFrame.Column( i )[ slice_i ];
-        embedding.WriteColumn( i, tmp );
+//---------------------------------------------------------
+// Return row of the embedding
+//---------------------------------------------------------
+std::valarray< double > EmbeddingView::Row( size_t row ) const {
+    std::valarray< double > rowVec( NColumns() );
+    for ( size_t col = 0; col < NColumns(); col++ ) {
+        rowVec[ col ] = (*this)( row, col );
+    }
+    return rowVec;
+}
+
+//---------------------------------------------------------
+// Materialize the embedding as MakeBlock() would
+//---------------------------------------------------------
+DataFrame< double > EmbeddingView::Materialize() const {
+    DataFrame< double > embedding( NRows(), NColumns(), columnNames,
+                                   Uninitialized() );
+    for ( size_t row = 0; row < NRows(); row++ ) {
+        for ( size_t col = 0; col < NColumns(); col++ ) {
+            embedding( row, col ) = (*this)( row, col );
+        }
     }
-    
     return embedding;
 }
@@ -9,20 +9,91 @@
 DataFrame< double > Embed ( std::string path     = "",
                             std::string dataFile = "",
                             int         E        = 0,
-                            int         tau      = 0,
+                            int         tau      = 1,
                             std::string columns  = "",
                             bool        verbose  = false );
 
 // Overloaded Embed functions : Type 2 with dataFrame
-DataFrame< double > Embed ( DataFrame< double > dataFrame,
-                            int                 E       = 0,
-                            int                 tau     = 0,
-                            std::string         columns = "",
-                            bool                verbose = false );
-
-DataFrame< double > MakeBlock ( DataFrame< double >      dataFrame,
-                                int                      E,
-                                int                      tau,
-                                std::vector<std::string> columnNames,
-                                bool                     verbose );
+DataFrame< double > Embed ( const DataFrame< double > &dataFrame,
+                            int                        E       = 0,
+                            int                        tau     = 1,
+                            std::string                columns = "",
+                            bool                       verbose = false );
+
+DataFrame< double > MakeBlock ( const DataFrame< double > &dataFrame,
+                                int                        E,
+                                int                        tau,
+                                std::vector<std::string>   columnNames,
+                                bool                       verbose );
+
+// MakeBlock of the dataFrame columns in columnIndex.
+// MakeBlock< float > is the single precision block.
+template< class T = double >
+DataFrame< T > MakeBlock ( const DataFrame< double > &dataFrame,
+                           int                        E,
+                           int                        tau,
+                           std::vector<size_t>        columnIndex,
+                           std::vector<std::string>   columnNames,
+                           bool                       verbose );
+
+// MakeBlock in column major layout: each embedding column is a copy of
+// a contiguous run of its source column. Convert to DataFrame< double >
+// for row operations such as FindNeighbors().
+DataFrame< double, ColumnMajor > MakeBlock (
+    const DataFrame< double, ColumnMajor > &dataFrame,
+    int                                     E,
+    int                                     tau,
+    std::vector<size_t>                     columnIndex,
+    std::vector<std::string>                columnNames,
+    bool                                    verbose );
+
+// Resolve columns (names or indices) to dataFrame column indices
+// and the column names used for the embedding
+void EmbedColumns( const DataFrame< double >  &dataFrame,
+                   std::string                 columns,
+                   std::vector<size_t>        &columnIndex,
+                   std::vector<std::string>   &columnNames );
+
+// Embedding column names X(t-0) X(t-1)... of each column
+std::vector<std::string> EmbedColumnNames( std::vector<std::string> columnNames,
+                                           int                      E );
+
+//---------------------------------------------------------
+// EmbeddingView class
+// Lagged view of the time-delay embedding, the embedding is never
+// materialized. Element (row, col) of the view reads the source
+// column col / E at lag e = col % E: x[ t - e * tau ].
+// Rows, columns and names are those of MakeBlock().
+//---------------------------------------------------------
+class EmbeddingView {
+
+    DataFrame< double >      source;      // the embedded input columns
+    int                      E;
+    int                      tau;
+    size_t                   NPartial;    // tau * (E-1) partial rows
+    std::vector<std::string> columnNames;
+
+public:
+    EmbeddingView() : E( 0 ), tau( 0 ), NPartial( 0 ) {}
+
+    EmbeddingView( const DataFrame< double > &dataFrame,
+                   int                        E,
+                   int                        tau,
+                   std::vector<size_t>        columnIndex,
+                   std::vector<std::string>   columnNames );
+
+    double operator()( size_t row, size_t col ) const {
+        return source( row + NPartial - ( col % E ) * tau, col / E );
+    }
+
+    size_t NRows()    const { return E ? source.NRows() - NPartial : 0; }
+    size_t NColumns() const { return source.NColumns() * E; }
+
+    const std::vector<std::string> &ColumnNames() const { return columnNames; }
+    const DataFrame< double >      &Source()      const { return source; }
+
+    std::valarray< double > Row( size_t row ) const;
+
+    DataFrame< double > Materialize() const;
+};
 #endif
@@ -1,7 +1,337 @@
-#include "Common.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+#include "Eval.h"
+#include "Parameter.h"
+#include "AuxFunc.h"
+#include "ThreadPool.h"
+
+namespace {
+    //------------------------------------------------------------
+    // One combination of the grid and its shared work
+    //------------------------------------------------------------
+    struct EvalCombo {
+        Method method;
+        int    E;
+        int    Tp;
+        int    tau;
+        int    knn;
+        double theta;
+
+        std::unique_ptr< Parameters > param;  // null if invalid
+        size_t      embedding;    // index of the ( E, tau ) embedding
+        size_t      search;       // index of the neighbor search
+        VectorError error;
+        std::string errorMessage;
+    };
+
+    //------------------------------------------------------------
+    // Neighbor search shared by the combinations of one
+    // ( E, tau, Tp, method ) at the largest knn among them
+    //------------------------------------------------------------
+    struct EvalSearch {
+        size_t      combo;        // combination with the largest knn
+        Neighbors   neighbors;    // in FindNeighbors() order
+        std::string errorMessage;
+    };
+
+    //------------------------------------------------------------
+    // knn nearest neighbors of each row in their original column
+    // order: projections sum over the neighbors in the order of
+    // FindNeighbors(). Of equal distances the first column is nearer.
+    //------------------------------------------------------------
+    Neighbors NearestNeighbors( const Neighbors &neighbors, size_t knn ) {
+
+        size_t N_knn = neighbors.distances.NColumns();
+
+        Neighbors nearest;
+        nearest.neighbors = DataFrame< int    >( neighbors.neighbors.NRows(),
+                                                 knn );
+        nearest.distances = DataFrame< double >( neighbors.distances.NRows(),
+                                                 knn );
+
+        std::vector< size_t > order( N_knn );
+
+        for ( size_t row = 0; row < neighbors.neighbors.NRows(); row++ ) {
+            const double *rowDistances = &neighbors.distances( row, 0 );
+
+            std::iota( order.begin(), order.end(), 0 );
+            std::stable_sort( order.begin(), order.end(),
+                              [ rowDistances ]( size_t a, size_t b ) {
+                                  return rowDistances[ a ] < rowDistances[ b ];
+                              } );
+            std::sort( order.begin(), order.begin() + knn );
+
+            for ( size_t k = 0; k < knn; k++ ) {
+                nearest.neighbors( row, k ) =
+                    neighbors.neighbors( row, order[ k ] );
+                nearest.distances( row, k ) = rowDistances[ order[ k ] ];
+            }
+        }
+        return nearest;
+    }
+}
+
+//----------------------------------------------------------------
+// Evaluate the grid on the data in dio
+//----------------------------------------------------------------
+DataFrame< double > Eval( const DataIO   &dio,
+                          std::string     lib,
+                          std::string     pred,
+                          std::string     columns,
+                          std::string     target,
+                          bool            embedded,
+                          const EvalGrid &grid,
+                          size_t          nThreads,
+                          bool            verbose ) {
+
+    if ( grid.E.empty() or grid.Tp.empty() or grid.tau.empty() or
+         grid.knn.empty() or grid.theta.empty() or grid.methods.empty() ) {
+        std::string errMsg( "Eval(): grid E, Tp, tau, knn, theta and "
+                            "methods must each have at least one value.\n" );
+        throw std::runtime_error( errMsg );
+    }
+    if ( grid.exclusionRadius < 0 ) {
+        std::stringstream errMsg;
+        errMsg << "Eval(): exclusionRadius of " << grid.exclusionRadius
+               << " must be non-negative.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    for ( auto method : grid.methods ) {
+        if ( method != Method::Simplex and method != Method::SMap ) {
+            std::string errMsg( "Eval(): methods must be Simplex or SMap.\n" );
+            throw std::runtime_error( errMsg );
+        }
+    }
+
+    //------------------------------------------------------------
+    // Combinations, validated Parameters of each
+    //------------------------------------------------------------
+    std::vector< EvalCombo > combos;
+
+    for ( auto E : grid.E ) {
+     for ( auto Tp : grid.Tp ) {
+      for ( auto tau : grid.tau ) {
+       for ( auto knn : grid.knn ) {
+        for ( auto method : grid.methods ) {
+         for ( size_t theta_i = 0; theta_i < grid.theta.size(); theta_i++ ) {
+             if ( method == Method::Simplex and theta_i ) { break; }
+
+             EvalCombo combo;
+             combo.method = method;
+             combo.E      = E;
+             combo.Tp     = Tp;
+             combo.tau    = tau;
+             combo.knn    = knn;
+             combo.theta  = method == Method::SMap ? grid.theta[ theta_i ] : 0;
+
+             try {
+                 combo.param.reset(
+                     new Parameters( method, "", "", "", "", lib, pred,
+                                     E, Tp, knn, tau, combo.theta,
+                                     columns, target, embedded, false ) );
+                 combo.param->exclusionRadius   = grid.exclusionRadius;
+                 combo.param->neighborAlgorithm = grid.algorithm;
+                 combo.param->singlePrecision   = grid.singlePrecision;
+                 combo.knn = combo.param->knn;
+             }
+             catch ( const std::exception &e ) {
+                 combo.param.reset();
+                 combo.errorMessage = e.what();
+             }
+
+             combos.push_back( std::move( combo ) );
+         }
+        }
+       }
+      }
+     }
+    }
+
+    //------------------------------------------------------------
+    // Shared embeddings ( E, tau ) and neighbor searches
+    // ( E, tau, Tp, method ) of the valid combinations
+    //------------------------------------------------------------
+    std::map< std::pair< int, int >, size_t > embeddingOf;
+    std::map< std::vector< int >,    size_t > searchOf;
+    std::vector< size_t >     embeddingCombo; // combo that defines it
+    std::vector< EvalSearch > searches;
+
+    for ( size_t combo_i = 0; combo_i < combos.size(); combo_i++ ) {
+        EvalCombo &combo = combos[ combo_i ];
+        if ( not combo.param ) { continue; }
+
+        std::pair< int, int > embeddingKey( combo.E, combo.tau );
+        if ( not embeddingOf.count( embeddingKey ) ) {
+            embeddingOf[ embeddingKey ] = embeddingCombo.size();
+            embeddingCombo.push_back( combo_i );
+        }
+        combo.embedding = embeddingOf[ embeddingKey ];
+
+        std::vector< int > searchKey = { combo.E, combo.tau, combo.Tp,
+                                         (int) combo.method };
+        if ( not searchOf.count( searchKey ) ) {
+            searchOf[ searchKey ] = searches.size();
+            searches.push_back( EvalSearch() );
+            searches.back().combo = combo_i;
+        }
+        combo.search = searchOf[ searchKey ];
+
+        EvalSearch &search = searches[ combo.search ];
+        if ( combo.knn > combos[ search.combo ].knn ) {
+            search.combo = combo_i;
+        }
+    }
+
+    std::vector< std::unique_ptr< DataEmbedNN > >
+        embeddings( embeddingCombo.size() );
+    std::vector< std::string > embeddingErrors( embeddingCombo.size() );
+
+    {
+        TaskGroup group( nThreads );
+
+        // Embeddings
+        for ( size_t i = 0; i < embeddingCombo.size(); i++ ) {
+            group.Submit( [ &, i ]() {
+                try {
+                    const EvalCombo &combo = combos[ embeddingCombo[ i ] ];
+                    embeddings[ i ].reset( new DataEmbedNN(
+                        EmbedData( dio, *combo.param, columns ) ) );
+                }
+                catch ( const std::exception &e ) {
+                    embeddingErrors[ i ] = e.what();
+                }
+            } );
+        }
+        group.Wait();
+
+        // Neighbor searches at the largest knn
+        for ( size_t i = 0; i < searches.size(); i++ ) {
+            group.Submit( [ &, i ]() {
+                EvalSearch      &search = searches[ i ];
+                const EvalCombo &combo  = combos[ search.combo ];
+                if ( not embeddings[ combo.embedding ] ) { return; }
+                try {
+                    search.neighbors = FindBlockNeighbors(
+                        *embeddings[ combo.embedding ], *combo.param );
+                }
+                catch ( const std::exception &e ) {
+                    search.errorMessage = e.what();
+                }
+            } );
+        }
+        group.Wait();
+
+        // Projections
+        for ( size_t combo_i = 0; combo_i < combos.size(); combo_i++ ) {
+            if ( not combos[ combo_i ].param ) { continue; }
+
+            group.Submit( [ &, combo_i ]() {
+                EvalCombo        &combo  = combos[ combo_i ];
+                const EvalSearch &search = searches[ combo.search ];
+
+                if ( not embeddings[ combo.embedding ] ) {
+                    combo.errorMessage = embeddingErrors[ combo.embedding ];
+                    return;
+                }
+                if ( search.errorMessage.size() ) {
+                    combo.errorMessage = search.errorMessage;
+                    return;
+                }
+
+                try {
+                    const DataEmbedNN &data = *embeddings[ combo.embedding ];
+
+                    Neighbors nearest;
+                    bool sliced = (size_t) combo.knn <
+                                  search.neighbors.neighbors.NColumns();
+                    if ( sliced ) {
+                        nearest = NearestNeighbors( search.neighbors,
+                                                    combo.knn );
+                    }
+                    const Neighbors &neighbors = sliced ? nearest :
+                                                          search.neighbors;
+
+                    DataFrame< double > output;
+                    if ( combo.method == Method::SMap ) {
+                        output = SMapProjection( *combo.param, data,
+                                                 neighbors ).predictions;
+                    }
+                    else {
+                        output = SimplexProjection( *combo.param, data,
+                                                    neighbors );
+                    }
+
+                    // Observations and Predictions of the first target
+                    combo.error = ComputeError( output.Column( 1 ),
+                                                output.Column( 2 ) );
+                }
+                catch ( const std::exception &e ) {
+                    combo.errorMessage = e.what();
+                }
+            } );
+        }
+        group.Wait();
+    }
+
+    //------------------------------------------------------------
+    // Result DataFrame
+    //------------------------------------------------------------
+    DataFrame< double > result( combos.size(), 12 );
+    result.ColumnNames() = { "E", "Tp", "tau", "knn", "theta", "method",
+                             "rho", "RMSE", "MAE", "bias", "R2", "N" };
+    result.BuildColumnNameIndex();
+
+    for ( size_t combo_i = 0; combo_i < combos.size(); combo_i++ ) {
+        EvalCombo &combo = combos[ combo_i ];
+
+        if ( combo.errorMessage.size() ) {
+            combo.error = ErrorAccumulator().Error(); // NAN, N = 0
+            if ( verbose ) {
+                std::stringstream msg;
+                msg << "Eval(): E=" << combo.E << " Tp=" << combo.Tp
+                    << " tau=" << combo.tau << " knn=" << combo.knn
+                    << " theta=" << combo.theta << " : "
+                    << combo.errorMessage << std::endl;
+                Message( msg.str() );
+            }
+        }
+
+        result( combo_i, 0  ) = combo.E;
+        result( combo_i, 1  ) = combo.Tp;
+        result( combo_i, 2  ) = combo.tau;
+        result( combo_i, 3  ) = combo.knn;
+        result( combo_i, 4  ) = combo.theta;
+        result( combo_i, 5  ) = combo.method == Method::SMap ? 1 : 0;
+        result( combo_i, 6  ) = combo.error.rho;
+        result( combo_i, 7  ) = combo.error.RMSE;
+        result( combo_i, 8  ) = combo.error.MAE;
+        result( combo_i, 9  ) = combo.error.bias;
+        result( combo_i, 10 ) = combo.error.R2;
+        result( combo_i, 11 ) = combo.error.N;
+    }
+
+    return result;
+}
 
 //----------------------------------------------------------------
-// 
+// Evaluate the grid on pathIn/dataFile
 //----------------------------------------------------------------
-void Eval() {
+DataFrame< double > Eval( std::string     pathIn,
+                          std::string     dataFile,
+                          std::string     lib,
+                          std::string     pred,
+                          std::string     columns,
+                          std::string     target,
+                          bool            embedded,
+                          const EvalGrid &grid,
+                          size_t          nThreads,
+                          bool            verbose ) {
+
+    DataIO dio = DataIO( pathIn, dataFile );
+
+    return Eval( dio, lib, pred, columns, target, embedded, grid,
+                 nThreads, verbose );
 }
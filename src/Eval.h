@@ -0,0 +1,68 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "Common.h"
+#include "DataIO.h"
+
+//---------------------------------------------------------
+// Parameter grid evaluation of Simplex and S-Map skill.
+//
+// Every combination of E, Tp, tau, knn, theta and method is
+// evaluated on the same library and prediction rows. The data is
+// loaded once, embedded once per ( E, tau ), and one neighbor search
+// per ( E, tau, Tp, method ) is made at the largest knn of the grid:
+// smaller knn use the nearest neighbors of it in their original
+// order, theta reuses it unchanged.
+// Embeddings, neighbor searches and projections each run as a
+// TaskGroup on the shared pool.
+//
+// theta only applies to S-Map: Simplex is evaluated once per
+// ( E, Tp, tau, knn ) with theta = 0. knn = 0 is the default of the
+// method: E + 1 for Simplex, the number of prediction rows - Tp
+// for S-Map.
+//---------------------------------------------------------
+struct EvalGrid {
+    std::vector< int >    E;
+    std::vector< int >    Tp;
+    std::vector< int >    tau;
+    std::vector< int >    knn;
+    std::vector< double > theta;
+    std::vector< Method > methods;
+
+    // Settings common to all combinations
+    int               exclusionRadius;
+    NeighborAlgorithm algorithm;
+    bool              singlePrecision; // neighbors of a float embedding
+
+    EvalGrid() : Tp( 1, 1 ), tau( 1, 1 ), knn( 1, 0 ), theta( 1, 0 ),
+                 methods( 1, Method::Simplex ), exclusionRadius( 0 ),
+                 algorithm( NeighborAlgorithm::BruteForce ),
+                 singlePrecision( false ) {}
+};
+
+// Result: one row per combination, columns
+//   E Tp tau knn theta method rho RMSE MAE bias R2 N
+// method is 0 for Simplex, 1 for S-Map. knn is the knn used.
+// A combination that fails (invalid parameters, library too small)
+// has nan errors and N = 0, the message is printed if verbose.
+DataFrame< double > Eval( const DataIO   &dio,
+                          std::string     lib,
+                          std::string     pred,
+                          std::string     columns,
+                          std::string     target,
+                          bool            embedded,
+                          const EvalGrid &grid,
+                          size_t          nThreads = 0,
+                          bool            verbose  = false );
+
+DataFrame< double > Eval( std::string     pathIn,
+                          std::string     dataFile,
+                          std::string     lib,
+                          std::string     pred,
+                          std::string     columns,
+                          std::string     target,
+                          bool            embedded,
+                          const EvalGrid &grid,
+                          size_t          nThreads = 0,
+                          bool            verbose  = false );
+#endif
@@ -0,0 +1,268 @@
+
+#include <random>
+
+#include "Generators.h"
+#include "ThreadPool.h"
+
+namespace {
+    const size_t burnIn = 1000; // steps before the first row
+
+    typedef std::mt19937_64 Random;
+
+    //------------------------------------------------------------
+    // Fourth order Runge-Kutta step of dx/dt = f( x ) with the
+    // scratch vectors of the system
+    //------------------------------------------------------------
+    struct RK4 {
+        std::vector< double > k1, k2, k3, k4, x;
+
+        template< class F >
+        void Step( std::vector< double > &state, double dt, F f ) {
+            size_t D = state.size();
+            k1.resize( D ); k2.resize( D ); k3.resize( D ); k4.resize( D );
+            x.resize( D );
+
+            f( state, k1 );
+            for ( size_t i = 0; i < D; i++ ) { x[i] = state[i] + dt/2*k1[i]; }
+            f( x, k2 );
+            for ( size_t i = 0; i < D; i++ ) { x[i] = state[i] + dt/2*k2[i]; }
+            f( x, k3 );
+            for ( size_t i = 0; i < D; i++ ) { x[i] = state[i] + dt * k3[i]; }
+            f( x, k4 );
+            for ( size_t i = 0; i < D; i++ ) {
+                state[i] += dt / 6 * ( k1[i] + 2*k2[i] + 2*k3[i] + k4[i] );
+            }
+        }
+    };
+
+    //------------------------------------------------------------
+    // Systems: Initial() state from the random generator, Step()
+    // advances the state one row. Each segment uses its own copy.
+    //------------------------------------------------------------
+    struct Lorenz63System {
+        double dt, sigma, rho, beta;
+        RK4    rk4;
+
+        std::vector< double > Initial( Random &random ) {
+            std::uniform_real_distribution< double > u( -1, 1 );
+            return { 1 + u( random ), 1 + u( random ), 1 + u( random ) };
+        }
+        void Step( std::vector< double > &v ) {
+            rk4.Step( v, dt, [ this ]( const std::vector< double > &x,
+                                       std::vector< double > &dx ) {
+                dx[0] = sigma * ( x[1] - x[0] );
+                dx[1] = x[0] * ( rho - x[2] ) - x[1];
+                dx[2] = x[0] * x[1] - beta * x[2];
+            } );
+        }
+    };
+
+    struct Lorenz96System {
+        size_t D;
+        double F, dt;
+        RK4    rk4;
+
+        std::vector< double > Initial( Random &random ) {
+            std::uniform_real_distribution< double > u( -0.5, 0.5 );
+            std::vector< double > v( D );
+            for ( auto &x : v ) { x = F + u( random ); }
+            return v;
+        }
+        void Step( std::vector< double > &v ) {
+            rk4.Step( v, dt, [ this ]( const std::vector< double > &x,
+                                       std::vector< double > &dx ) {
+                for ( size_t i = 0; i < D; i++ ) {
+                    dx[i] = ( x[ ( i + 1 ) % D ] - x[ ( i + D - 2 ) % D ] ) *
+                              x[ ( i + D - 1 ) % D ] - x[i] + F;
+                }
+            } );
+        }
+    };
+
+    struct CoupledLogisticSystem {
+        double rx, ry, Bxy, Byx;
+
+        std::vector< double > Initial( Random &random ) {
+            std::uniform_real_distribution< double > u( 0.1, 0.9 );
+            return { u( random ), u( random ) };
+        }
+        void Step( std::vector< double > &v ) {
+            double x = v[0];
+            double y = v[1];
+            v[0] = x * ( rx - rx * x - Bxy * y );
+            v[1] = y * ( ry - ry * y - Byx * x );
+        }
+    };
+
+    struct TentSystem {
+        double mu;
+
+        std::vector< double > Initial( Random &random ) {
+            std::uniform_real_distribution< double > u( 0, 1 );
+            return { u( random ) };
+        }
+        void Step( std::vector< double > &v ) {
+            v[0] = mu * std::min( v[0], 1 - v[0] );
+        }
+    };
+
+    //------------------------------------------------------------
+    // Fill the variable columns (1, 2, ...) of data by segments
+    //------------------------------------------------------------
+    template< class System >
+    void Generate( DataFrame< double > &data,
+                   const System        &system,
+                   unsigned             seed,
+                   size_t               segmentRows,
+                   unsigned             nThreads ) {
+
+        size_t N = data.NRows();
+        size_t D = data.NColumns() - 1;
+
+        if ( segmentRows == 0 or segmentRows > N ) { segmentRows = N; }
+        size_t nSegments = N ? ( N + segmentRows - 1 ) / segmentRows : 0;
+
+        auto Segment = [ &data, &system, seed, segmentRows, N, D ](
+            size_t segment ) {
+
+            System        local( system );
+            std::seed_seq seeds{ seed, (unsigned) segment };
+            Random        random( seeds );
+
+            std::vector< double > state = local.Initial( random );
+            for ( size_t i = 0; i < burnIn; i++ ) { local.Step( state ); }
+
+            size_t stop = std::min( ( segment + 1 ) * segmentRows, N );
+            for ( size_t row = segment * segmentRows; row < stop; row++ ) {
+                for ( size_t i = 0; i < D; i++ ) {
+                    data( row, i + 1 ) = state[ i ];
+                }
+                local.Step( state );
+            }
+        };
+
+        if ( nSegments < 2 ) {
+            if ( nSegments ) { Segment( 0 ); }
+            return;
+        }
+
+        TaskGroup group( nThreads );
+        for ( size_t segment = 0; segment < nSegments; segment++ ) {
+            group.Submit( [ &Segment, segment ]() { Segment( segment ); } );
+        }
+        group.Wait();
+    }
+
+    //------------------------------------------------------------
+    // DataFrame of N rows: Time = row * dt + t0, and names.
+    // The variable columns are left for Generate() to fill.
+    //------------------------------------------------------------
+    DataFrame< double > SeriesFrame( size_t N, size_t D,
+                                     const std::string &names,
+                                     double dt, double t0 ) {
+        DataFrame< double > data( N, D + 1, names, Uninitialized() );
+        for ( size_t row = 0; row < N; row++ ) {
+            data( row, 0 ) = row * dt + t0;
+        }
+        return data;
+    }
+}
+
+//----------------------------------------------------------------
+// Lorenz '63
+//----------------------------------------------------------------
+DataFrame< double > Lorenz63( size_t   N,
+                              unsigned seed,
+                              double   dt,
+                              double   sigma,
+                              double   rho,
+                              double   beta,
+                              size_t   segmentRows,
+                              unsigned nThreads ) {
+
+    DataFrame< double > data = SeriesFrame( N, 3, "Time V1 V2 V3", dt, 0 );
+
+    Lorenz63System system;
+    system.dt    = dt;
+    system.sigma = sigma;
+    system.rho   = rho;
+    system.beta  = beta;
+
+    Generate( data, system, seed, segmentRows, nThreads );
+    return data;
+}
+
+//----------------------------------------------------------------
+// Lorenz '96
+//----------------------------------------------------------------
+DataFrame< double > Lorenz96( size_t   N,
+                              size_t   nVariables,
+                              unsigned seed,
+                              double   F,
+                              double   dt,
+                              size_t   segmentRows,
+                              unsigned nThreads ) {
+
+    if ( nVariables < 4 ) {
+        std::stringstream errMsg;
+        errMsg << "Lorenz96(): nVariables (" << nVariables
+               << ") must be at least 4.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    std::stringstream names;
+    names << "Time";
+    for ( size_t i = 1; i <= nVariables; i++ ) { names << " V" << i; }
+
+    DataFrame< double > data = SeriesFrame( N, nVariables, names.str(),
+                                            dt, 0 );
+    Lorenz96System system;
+    system.D  = nVariables;
+    system.F  = F;
+    system.dt = dt;
+
+    Generate( data, system, seed, segmentRows, nThreads );
+    return data;
+}
+
+//----------------------------------------------------------------
+// Coupled logistic maps
+//----------------------------------------------------------------
+DataFrame< double > CoupledLogistic( size_t   N,
+                                     unsigned seed,
+                                     double   rx,
+                                     double   ry,
+                                     double   Bxy,
+                                     double   Byx,
+                                     size_t   segmentRows,
+                                     unsigned nThreads ) {
+
+    DataFrame< double > data = SeriesFrame( N, 2, "Time x y", 1, 1 );
+
+    CoupledLogisticSystem system;
+    system.rx  = rx;
+    system.ry  = ry;
+    system.Bxy = Bxy;
+    system.Byx = Byx;
+
+    Generate( data, system, seed, segmentRows, nThreads );
+    return data;
+}
+
+//----------------------------------------------------------------
+// Tent map
+//----------------------------------------------------------------
+DataFrame< double > TentMap( size_t   N,
+                             unsigned seed,
+                             double   mu,
+                             size_t   segmentRows,
+                             unsigned nThreads ) {
+
+    DataFrame< double > data = SeriesFrame( N, 1, "Time x", 1, 1 );
+
+    TentSystem system;
+    system.mu = mu;
+
+    Generate( data, system, seed, segmentRows, nThreads );
+    return data;
+}
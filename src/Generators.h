@@ -0,0 +1,60 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// Synthetic time series generators
+// Series are written to a DataFrame with a Time column followed by
+// the system variables. Each trajectory starts from a random initial
+// condition drawn from seed and is iterated 1000 steps onto the
+// attractor before the first row.
+//
+// segmentRows = 0 : one continuous trajectory of N rows, generated
+// sequentially. segmentRows > 0 : the rows are split into segments
+// of segmentRows, each an independent trajectory seeded by seed and
+// its segment index, and generated in parallel on nThreads of the
+// shared pool (0 : all). Output depends on N, seed and segmentRows
+// only, not on nThreads.
+//---------------------------------------------------------
+
+// Lorenz '63: Time V1 V2 V3, RK4 with step dt
+DataFrame< double > Lorenz63( size_t   N,
+                              unsigned seed        = 1,
+                              double   dt          = 0.01,
+                              double   sigma       = 10,
+                              double   rho         = 28,
+                              double   beta        = 8. / 3.,
+                              size_t   segmentRows = 0,
+                              unsigned nThreads    = 0 );
+
+// Lorenz '96 with nVariables >= 4: Time V1 ... VnVariables
+//   dV_i/dt = ( V_i+1 - V_i-2 ) V_i-1 - V_i + F, RK4 with step dt
+DataFrame< double > Lorenz96( size_t   N,
+                              size_t   nVariables  = 5,
+                              unsigned seed        = 1,
+                              double   F           = 8,
+                              double   dt          = 0.05,
+                              size_t   segmentRows = 0,
+                              unsigned nThreads    = 0 );
+
+// Coupled logistic maps: Time x y, Bxy is the forcing of x by y
+//   x' = x ( rx - rx x - Bxy y )
+//   y' = y ( ry - ry y - Byx x )
+DataFrame< double > CoupledLogistic( size_t   N,
+                                     unsigned seed        = 1,
+                                     double   rx          = 3.8,
+                                     double   ry          = 3.5,
+                                     double   Bxy         = 0.02,
+                                     double   Byx         = 0.1,
+                                     size_t   segmentRows = 0,
+                                     unsigned nThreads    = 0 );
+
+// Tent map: Time x,  x' = mu min( x, 1 - x )
+DataFrame< double > TentMap( size_t   N,
+                             unsigned seed        = 1,
+                             double   mu          = 1.99,
+                             size_t   segmentRows = 0,
+                             unsigned nThreads    = 0 );
+
+#endif
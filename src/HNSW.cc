@@ -0,0 +1,352 @@
+
+#include <algorithm>
+#include <queue>
+
+#include "HNSW.h"
+#include "Neighbors.h"
+
+namespace {
+    // Visited marks of the calling thread: node i has been visited
+    // in the current search if visitedMark[ i ] == visitedEpoch
+    thread_local std::vector< unsigned > visitedMark;
+    thread_local unsigned                visitedEpoch = 0;
+
+    //------------------------------------------------------------
+    // Start a new search over N nodes
+    //------------------------------------------------------------
+    void NewVisitedEpoch( size_t N ) {
+        if ( visitedMark.size() < N ) {
+            visitedMark.resize( N, 0 );
+        }
+        if ( ++visitedEpoch == 0 ) {
+            std::fill( visitedMark.begin(), visitedMark.end(), 0 );
+            visitedEpoch = 1;
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// Constructor
+//----------------------------------------------------------------
+template< class T >
+HNSW< T >::HNSW( size_t         dim,
+                 DistanceMetric metric,
+                 size_t         M,
+                 size_t         efConstruction,
+                 unsigned       seed ) :
+    dim( dim ), metric( metric ), M( M ), M0( 2 * M ),
+    efConstruction( std::max( efConstruction, M ) ),
+    generator( seed ), entryPoint( -1 ), maxLevel( -1 )
+{
+    if ( M < 2 ) {
+        std::stringstream errMsg;
+        errMsg << "HNSW::HNSW(): M of " << M << " must be at least 2.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    levelScale = 1 / std::log( (double) M );
+}
+
+//----------------------------------------------------------------
+// Replace the graph with points (N x dim, row-major) and ids
+//----------------------------------------------------------------
+template< class T >
+void HNSW< T >::Build( const std::vector<T>      &points,
+                       const std::vector<size_t> &pointIds ) {
+
+    if ( dim == 0 or points.size() != pointIds.size() * dim ) {
+        std::stringstream errMsg;
+        errMsg << "HNSW::Build(): " << points.size() << " coordinates "
+               << "do not match " << pointIds.size() << " ids of dimension "
+               << dim << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    Clear();
+
+    coords.reserve( points.size() );
+    ids.reserve   ( pointIds.size() );
+    links.reserve ( pointIds.size() );
+
+    for ( size_t i = 0; i < pointIds.size(); i++ ) {
+        Insert( pointIds[ i ], &points[ i * dim ] );
+    }
+}
+
+//----------------------------------------------------------------
+// Insert point with id: link it on each of its levels to the
+// neighbors found by a search of width efConstruction
+//----------------------------------------------------------------
+template< class T >
+void HNSW< T >::Insert( size_t id, const T *point ) {
+
+    if ( dim == 0 ) {
+        throw std::runtime_error( "HNSW::Insert(): dimension is 0.\n" );
+    }
+    if ( idToNode.count( id ) ) {
+        std::stringstream errMsg;
+        errMsg << "HNSW::Insert(): id " << id << " already present.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    int node  = ids.size();
+    int level = RandomLevel();
+
+    coords.insert( coords.end(), point, point + dim );
+    ids.push_back( id );
+    links.push_back( std::vector< std::vector<int> >( level + 1 ) );
+    idToNode[ id ] = node;
+
+    if ( entryPoint < 0 ) {
+        entryPoint = node;
+        maxLevel   = level;
+        return;
+    }
+
+    // Greedy descent through the levels above the new node
+    int entry = entryPoint;
+    for ( int l = maxLevel; l > level; l-- ) {
+        entry = GreedyClosest( point, entry, l );
+    }
+
+    for ( int l = std::min( level, maxLevel ); l >= 0; l-- ) {
+        std::vector< DistNode > found =
+            SearchLevel( point, entry, efConstruction, l, nullptr );
+
+        size_t maxLinks = l ? M : M0;
+
+        links[ node ][ l ] = SelectNeighbors( found, M );
+
+        // Reverse links, pruned back to maxLinks
+        for ( int neighbor : links[ node ][ l ] ) {
+            std::vector<int> &neighborLinks = links[ neighbor ][ l ];
+            neighborLinks.push_back( node );
+
+            if ( neighborLinks.size() > maxLinks ) {
+                const T      *neighborX = &coords[ neighbor * dim ];
+                std::vector< DistNode > candidates;
+                candidates.reserve( neighborLinks.size() );
+                for ( int n : neighborLinks ) {
+                    candidates.push_back(
+                        DistNode( NodeDistance( neighborX, n ), n ) );
+                }
+                std::sort( candidates.begin(), candidates.end() );
+                neighborLinks = SelectNeighbors( candidates, maxLinks );
+            }
+        }
+
+        entry = found.front().second;
+    }
+
+    if ( level > maxLevel ) {
+        maxLevel   = level;
+        entryPoint = node;
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+void HNSW< T >::Clear() {
+    coords.clear();
+    ids.clear();
+    links.clear();
+    idToNode.clear();
+    entryPoint = -1;
+    maxLevel   = -1;
+}
+
+//----------------------------------------------------------------
+// Approximate k nearest neighbors of point
+//----------------------------------------------------------------
+template< class T >
+void HNSW< T >::Query(
+    const T                               *point,
+    size_t                                 knn,
+    size_t                                 ef,
+    const std::function< bool( size_t ) > &accept,
+    std::vector< size_t >                 &neighborIds,
+    std::vector< double >                 &neighborDistances )
+    const {
+
+    neighborIds.clear();
+    neighborDistances.clear();
+
+    if ( entryPoint < 0 or knn == 0 ) { return; }
+
+    int entry = entryPoint;
+    for ( int l = maxLevel; l > 0; l-- ) {
+        entry = GreedyClosest( point, entry, l );
+    }
+
+    std::vector< DistNode > found =
+        SearchLevel( point, entry, std::max( ef, knn ), 0, &accept );
+
+    size_t N = std::min( knn, found.size() );
+    neighborIds.resize      ( N );
+    neighborDistances.resize( N );
+    for ( size_t i = 0; i < N; i++ ) {
+        neighborDistances[ i ] = found[ i ].first;
+        neighborIds      [ i ] = ids[ found[ i ].second ];
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+double HNSW< T >::NodeDistance( const T *point, int node ) const {
+    return Distance( point, &coords[ node * dim ], dim, metric );
+}
+
+//----------------------------------------------------------------
+// Level drawn from floor( -ln( U ) / ln( M ) )
+//----------------------------------------------------------------
+template< class T >
+int HNSW< T >::RandomLevel() {
+    std::uniform_real_distribution< double > uniform( 0, 1 );
+    return (int) std::floor( -std::log( 1 - uniform( generator ) ) *
+                             levelScale );
+}
+
+//----------------------------------------------------------------
+// Move to the closest linked node on level until no link is closer
+//----------------------------------------------------------------
+template< class T >
+int HNSW< T >::GreedyClosest( const T *point, int entry, int level ) const {
+
+    int    closest  = entry;
+    double distance = NodeDistance( point, entry );
+    bool   changed  = true;
+
+    while ( changed ) {
+        changed = false;
+        for ( int n : links[ closest ][ level ] ) {
+            double d = NodeDistance( point, n );
+            if ( d < distance ) {
+                distance = d;
+                closest  = n;
+                changed  = true;
+            }
+        }
+    }
+    return closest;
+}
+
+//----------------------------------------------------------------
+// Best first search of width ef on level from entry.
+// If accept is given, nodes it rejects are traversed but not
+// returned. Returns ( distance, node ) sorted by distance.
+//----------------------------------------------------------------
+template< class T >
+std::vector< typename HNSW< T >::DistNode > HNSW< T >::SearchLevel(
+    const T                               *point,
+    int                                    entry,
+    size_t                                 ef,
+    int                                    level,
+    const std::function< bool( size_t ) > *accept ) const {
+
+    NewVisitedEpoch( ids.size() );
+
+    // candidates: min-heap to expand, results: max-heap of the ef best
+    std::priority_queue< DistNode, std::vector< DistNode >,
+                         std::greater< DistNode > > candidates;
+    std::priority_queue< DistNode > results;
+
+    double d = NodeDistance( point, entry );
+    visitedMark[ entry ] = visitedEpoch;
+    candidates.push( DistNode( d, entry ) );
+    if ( not accept or (*accept)( ids[ entry ] ) ) {
+        results.push( DistNode( d, entry ) );
+    }
+
+    while ( candidates.size() ) {
+        DistNode candidate = candidates.top();
+        if ( results.size() >= ef and candidate.first > results.top().first ) {
+            break;
+        }
+        candidates.pop();
+
+        for ( int n : links[ candidate.second ][ level ] ) {
+            if ( visitedMark[ n ] == visitedEpoch ) { continue; }
+            visitedMark[ n ] = visitedEpoch;
+
+            double dn = NodeDistance( point, n );
+            if ( results.size() < ef or dn < results.top().first ) {
+                candidates.push( DistNode( dn, n ) );
+
+                if ( not accept or (*accept)( ids[ n ] ) ) {
+                    results.push( DistNode( dn, n ) );
+                    if ( results.size() > ef ) { results.pop(); }
+                }
+            }
+        }
+    }
+
+    std::vector< DistNode > found( results.size() );
+    for ( size_t i = found.size(); i > 0; i-- ) {
+        found[ i - 1 ] = results.top();
+        results.pop();
+    }
+    return found;
+}
+
+//----------------------------------------------------------------
+// Neighbor selection heuristic: from candidates sorted by distance
+// keep those closer to the base point than to any kept neighbor,
+// which spreads links in different directions. Remaining slots
+// are filled with the closest of the pruned candidates.
+//----------------------------------------------------------------
+template< class T >
+std::vector< int > HNSW< T >::SelectNeighbors(
+    std::vector< DistNode > candidates,
+    size_t maxLinks ) const {
+
+    std::vector< int > selected;
+    std::vector< int > pruned;
+    selected.reserve( maxLinks );
+
+    for ( const DistNode &candidate : candidates ) {
+        if ( selected.size() >= maxLinks ) { break; }
+
+        const T      *candidateX = &coords[ candidate.second * dim ];
+        bool keep = true;
+        for ( int s : selected ) {
+            if ( NodeDistance( candidateX, s ) < candidate.first ) {
+                keep = false;
+                break;
+            }
+        }
+        if ( keep ) { selected.push_back( candidate.second ); }
+        else        { pruned.push_back  ( candidate.second ); }
+    }
+
+    for ( size_t i = 0; i < pruned.size() and selected.size() < maxLinks; i++ ) {
+        selected.push_back( pruned[ i ] );
+    }
+    return selected;
+}
+
+//----------------------------------------------------------------
+// Coordinates of point id
+//----------------------------------------------------------------
+template< class T >
+const T *HNSW< T >::Point( size_t id ) const {
+    auto ni = idToNode.find( id );
+    if ( ni == idToNode.end() ) {
+        std::stringstream errMsg;
+        errMsg << "HNSW::Point(): id " << id << " not found.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    return &coords[ ni->second * dim ];
+}
+
+//----------------------------------------------------------------
+template< class T >
+bool HNSW< T >::Contains( size_t id ) const {
+    return idToNode.count( id ) > 0;
+}
+
+// Coordinate types of the neighbor indices
+template class HNSW< double >;
+template class HNSW< float  >;
@@ -0,0 +1,93 @@
+#ifndef HNSW_H
+#define HNSW_H
+
+#include <functional>
+#include <random>
+#include <unordered_map>
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// HNSW class
+// Hierarchical navigable small world graph for approximate
+// k nearest neighbors (Malkov & Yashunin 2018).
+//
+// Each point is assigned a random level with exponentially
+// decaying probability and is linked to at most M neighbors on each
+// level it occupies (2M on level 0). A query descends greedily from
+// the top level entry point, then runs a best-first search of
+// width ef on level 0. Larger ef gives higher recall at higher cost,
+// ef = knn is the fastest, least accurate setting.
+//
+// Points are inserted, not removed. Point coordinates of type T
+// (double or float) are held in a single contiguous vector, each
+// point tagged with a caller supplied id (typically a data row
+// index). Distances are returned as double.
+//---------------------------------------------------------
+template< class T >
+class HNSW {
+
+    size_t              dim;
+    DistanceMetric      metric;
+    size_t              M;              // max links per node, level > 0
+    size_t              M0;             // max links per node, level 0
+    size_t              efConstruction; // search width for Insert()
+    double              levelScale;     // 1 / ln( M )
+    std::mt19937        generator;
+
+    std::vector<T>      coords;         // node i point at coords[ i * dim ]
+    std::vector<size_t> ids;            // caller id of node i
+    std::vector< std::vector< std::vector<int> > > links; // [node][level]
+
+    int                 entryPoint;     // node on the top level, -1 if empty
+    int                 maxLevel;
+
+    std::unordered_map< size_t, int > idToNode;
+
+    typedef std::pair< double, int > DistNode;
+
+    double NodeDistance( const T *point, int node ) const;
+    int    RandomLevel();
+
+    int    GreedyClosest( const T *point, int entry, int level ) const;
+
+    std::vector< DistNode > SearchLevel(
+        const T *point, int entry, size_t ef, int level,
+        const std::function< bool( size_t ) > *accept ) const;
+
+    std::vector< int > SelectNeighbors( std::vector< DistNode > candidates,
+                                        size_t maxLinks ) const;
+
+public:
+    HNSW( size_t         dim            = 0,
+          DistanceMetric metric         = DistanceMetric::Euclidean,
+          size_t         M              = 16,
+          size_t         efConstruction = 100,
+          unsigned       seed           = 0 );
+
+    // Replace the graph with points (row-major, N x dim) tagged by ids
+    void Build( const std::vector<T>      &points,
+                const std::vector<size_t> &ids );
+
+    void Insert( size_t id, const T *point );
+    void Clear ();
+
+    // Approximate k nearest neighbors of point among ids for which
+    // accept(id) is true, with search width ef (at least knn).
+    // Results are sorted by increasing distance.
+    void Query( const T                             *point,
+                size_t                               knn,
+                size_t                               ef,
+                const std::function< bool( size_t ) > &accept,
+                std::vector< size_t >               &neighborIds,
+                std::vector< double >               &neighborDistances ) const;
+
+    // Accessors
+    const T       *Point( size_t id ) const;
+    bool           Contains( size_t id ) const;
+    size_t         Size()      const { return ids.size(); }
+    size_t         Dimension() const { return dim;    }
+    DistanceMetric Metric()    const { return metric; }
+};
+
+#endif
@@ -1,7 +1,377 @@
-#include "Common.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include "Interface.h"
+#include "Parameter.h"
+#include "AuxFunc.h"
+#include "Batch.h"
+#include "Server.h"
+#include "ThreadPool.h"
+
+namespace {
+    //------------------------------------------------------------
+    //
+    //------------------------------------------------------------
+    void Usage() {
+        std::cout <<
+            "Usage: edm [-J jobFile] [-n threads] [--profile file.json]"
+            " [arguments]\n"
+            "       edm --server [--socket path] [--cacheSize N] [arguments]\n"
+            "  -m   --method          simplex | smap\n"
+            "  -pa  --path            input data path\n"
+            "  -i   --inputFile       input data .csv file\n"
+            "  -po  --pathOut         output path\n"
+            "  -o   --outputFile      prediction output .csv file\n"
+            "  -os  --outputSmapFile  S-Map coefficient output .csv file\n"
+            "  -l   --library         \"start end [start end ...]\"\n"
+            "  -p   --prediction      \"start end [start end ...]\"\n"
+            "  -E   --E               embedding dimension\n"
+            "  -T   --Tp              prediction interval\n"
+            "  -k   --knn             number of neighbors\n"
+            "  -t   --tau             embedding delay\n"
+            "  -th  --theta           S-Map localization\n"
+            "  -c   --columns         \"column names or indices\"\n"
+            "  -r   --target          target column name or index\n"
+            "  -e   --embedded        data is an embedding\n"
+            "  -x   --exclusionRadius exclude |lib - pred| <= x\n"
+            "  -a   --algorithm       bruteforce | kdtree | vptree | hnsw\n"
+            "  -d   --metric          euclidean | manhattan | chebyshev\n"
+            "  -nc  --neighborCache   neighbor cache directory\n"
+            "  -sp  --singlePrecision float embedding and distances\n"
+            "  -v   --verbose\n"
+            "  --profile file.json    stage times and counters, requires\n"
+            "                         a build with -DEDM_PROFILE\n"
+            "See Parameters::Load() for all arguments.\n";
+    }
+
+    //------------------------------------------------------------
+    // Run one job on data loaded in dio
+    //------------------------------------------------------------
+    VectorError RunJob( const DataIO &dio, Parameters param ) {
+
+        DataEmbedNN dataEmbedNN = EmbedNN( dio, param, param.columns_str );
+
+        DataFrame< double > predictions;
+        if ( param.method == Method::SMap ) {
+            SMapValues values = SMapProjection( param, dataEmbedNN );
+            predictions = values.predictions;
+
+            if ( param.SmapOutputFile.size() ) {
+                DataIO dout( values.coefficients );
+                dout.WriteData( param.pathOut, param.SmapOutputFile );
+            }
+        }
+        else if ( param.method == Method::Simplex ) {
+            predictions = SimplexProjection( param, dataEmbedNN );
+        }
+        else {
+            std::string errMsg( "Interface(): method must be simplex or "
+                                "smap.\n" );
+            throw std::runtime_error( errMsg );
+        }
+
+        if ( param.predictOutputFile.size() ) {
+            DataIO dout( predictions );
+            dout.WriteData( param.pathOut, param.predictOutputFile );
+        }
+
+        // Observations and Predictions of the first target
+        return ComputeError( predictions.Column( 1 ),
+                             predictions.Column( 2 ) );
+    }
+
+    //------------------------------------------------------------
+    //
+    //------------------------------------------------------------
+    std::string MethodName( Method method ) {
+        switch ( method ) {
+        case Method::Simplex : return "Simplex";
+        case Method::SMap    : return "SMap";
+        case Method::Embed   : return "Embed";
+        default              : return "None";
+        }
+    }
+}
 
 //----------------------------------------------------------------
-// 
+// Split on white space, "double quoted" values keep their spaces
 //----------------------------------------------------------------
-void Interface() {
+std::vector< std::string > SplitArguments( const std::string &line ) {
+
+    std::vector< std::string > args;
+    std::string arg;
+    bool        inArg   = false;
+    bool        inQuote = false;
+
+    for ( auto c : line ) {
+        if ( c == '"' ) {
+            inQuote = not inQuote;
+            inArg   = true;
+        }
+        else if ( not inQuote and std::isspace( c ) ) {
+            if ( inArg ) {
+                args.push_back( arg );
+                arg.clear();
+                inArg = false;
+            }
+        }
+        else {
+            arg  += c;
+            inArg = true;
+        }
+    }
+
+    if ( inQuote ) {
+        std::stringstream errMsg;
+        errMsg << "SplitArguments(): unterminated quote in: " << line << "\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    if ( inArg ) {
+        args.push_back( arg );
+    }
+
+    return args;
+}
+
+//----------------------------------------------------------------
+// edm command line driver
+//----------------------------------------------------------------
+int Interface( int argc, char *argv[] ) {
+
+    //------------------------------------------------------------
+    // Command line: job file and threads, the rest are job defaults
+    //------------------------------------------------------------
+    std::string                jobFile;
+    size_t                     nThreads  = 1;
+    bool                       server    = false;
+    std::string                socketPath;
+    size_t                     cacheSize = 16;
+    std::string                profileFile;
+    std::vector< std::string > defaultArgs;
+
+    for ( int i = 1; i < argc; i++ ) {
+        std::string arg( argv[ i ] );
+
+        if ( arg == "-h" or arg == "--help" ) {
+            Usage();
+            return 0;
+        }
+        else if ( ( arg == "-J" or arg == "--jobFile" ) and i + 1 < argc ) {
+            jobFile = argv[ ++i ];
+        }
+        else if ( ( arg == "-n" or arg == "--threads" or
+                    arg == "--cacheSize" ) and i + 1 < argc ) {
+            std::string number( argv[ ++i ] );
+            if ( number.empty() or not OnlyDigits( number ) ) {
+                std::cerr << "Interface(): invalid " << arg << " " << number
+                          << std::endl;
+                return 1;
+            }
+            ( arg == "--cacheSize" ? cacheSize : nThreads ) =
+                std::stoul( number );
+        }
+        else if ( arg == "--server" ) {
+            server = true;
+        }
+        else if ( arg == "--socket" and i + 1 < argc ) {
+            socketPath = argv[ ++i ];
+        }
+        else if ( arg == "--profile" and i + 1 < argc ) {
+#ifndef EDM_PROFILE
+            std::cerr << "Interface(): --profile requires a build with "
+                      << "-DEDM_PROFILE" << std::endl;
+            return 1;
+#endif
+            profileFile = argv[ ++i ];
+        }
+        else {
+            defaultArgs.push_back( arg );
+        }
+    }
+
+    //------------------------------------------------------------
+    // Server mode: requests over stdin/stdout or a socket
+    //------------------------------------------------------------
+    if ( server ) {
+        Server edmServer( defaultArgs, cacheSize );
+        try {
+            if ( socketPath.size() ) {
+                edmServer.ServeSocket( socketPath );
+            }
+            else {
+                edmServer.Serve( std::cin, std::cout );
+            }
+        }
+        catch ( const std::exception &e ) {
+            std::cerr << e.what();
+            return 1;
+        }
+        return 0;
+    }
+
+    if ( jobFile.empty() and defaultArgs.empty() ) {
+        Usage();
+        return 1;
+    }
+
+    //------------------------------------------------------------
+    // Job arguments: command line defaults + each job file line
+    //------------------------------------------------------------
+    std::vector< std::vector< std::string > > jobArgs;
+
+    if ( jobFile.size() ) {
+        std::ifstream jobStrm( jobFile );
+        if ( not jobStrm.is_open() ) {
+            std::cerr << "Interface(): job file " << jobFile
+                      << " is not open for reading." << std::endl;
+            return 1;
+        }
+
+        std::string line;
+        while ( std::getline( jobStrm, line ) ) {
+            size_t first = line.find_first_not_of( " \t\r" );
+            if ( first == std::string::npos or line[ first ] == '#' ) {
+                continue;
+            }
+            std::vector< std::string > args( defaultArgs );
+            try {
+                std::vector< std::string > lineArgs = SplitArguments( line );
+                args.insert( args.end(), lineArgs.begin(), lineArgs.end() );
+            }
+            catch ( const std::exception &e ) {
+                std::cerr << e.what();
+                return 1;
+            }
+            jobArgs.push_back( args );
+        }
+    }
+    else {
+        jobArgs.push_back( defaultArgs );
+    }
+
+    //------------------------------------------------------------
+    // Parameters of each job and the data they use, each data
+    // file is loaded once
+    //------------------------------------------------------------
+    std::vector< std::unique_ptr< Parameters > >    params( jobArgs.size() );
+    std::vector< BatchResult >                      results( jobArgs.size() );
+    std::map< std::string, std::shared_ptr< DataIO > > dataCache;
+    std::map< std::string, std::string >            dataErrors;
+    std::vector< std::shared_ptr< DataIO > >        jobData( jobArgs.size() );
+
+    for ( size_t job = 0; job < jobArgs.size(); job++ ) {
+        BatchResult &result = results[ job ];
+        result.job    = job;
+        result.N_pred = 0;
+        result.error  = ErrorAccumulator().Error(); // NAN, N = 0
+
+        try {
+            params[ job ].reset(
+                new Parameters( Parameters::FromArgs( jobArgs[ job ] ) ) );
+        }
+        catch ( const std::exception &e ) {
+            result.errorMessage = e.what();
+            params[ job ].reset();
+            continue;
+        }
+
+        std::string dataKey = params[ job ]->pathIn + params[ job ]->dataFile;
+
+        if ( not dataCache.count( dataKey ) and
+             not dataErrors.count( dataKey ) ) {
+            try {
+                dataCache[ dataKey ] = std::make_shared< DataIO >(
+                    params[ job ]->pathIn, params[ job ]->dataFile );
+            }
+            catch ( const std::exception &e ) {
+                dataErrors[ dataKey ] = e.what();
+            }
+        }
+
+        if ( dataErrors.count( dataKey ) ) {
+            result.errorMessage = dataErrors[ dataKey ];
+        }
+        else {
+            jobData[ job ] = dataCache[ dataKey ];
+        }
+    }
+
+    //------------------------------------------------------------
+    // Run the jobs: -n sets the threads of the shared pool if it is
+    // not yet running, the group runs on at most nThreads
+    //------------------------------------------------------------
+    {
+        SetSharedThreads( nThreads );
+        TaskGroup group( nThreads );
+
+        for ( size_t job = 0; job < jobArgs.size(); job++ ) {
+            if ( not jobData[ job ] ) { continue; }
+
+            group.Submit( [ &, job ]() {
+                try {
+                    results[ job ].error  = RunJob( *jobData[ job ],
+                                                    *params[ job ] );
+                    results[ job ].N_pred = params[ job ]->prediction.size();
+                }
+                catch ( const std::exception &e ) {
+                    results[ job ].errorMessage = e.what();
+                }
+            } );
+        }
+
+        group.Wait();
+    }
+
+    //------------------------------------------------------------
+    // One csv line per job
+    //------------------------------------------------------------
+    int status = 0;
+
+    std::cout << "job,method,dataFile,E,Tp,knn,tau,theta,"
+                 "rho,RMSE,MAE,bias,R2,N,error" << std::endl;
+
+    for ( size_t job = 0; job < jobArgs.size(); job++ ) {
+        const BatchResult &result = results[ job ];
+
+        std::string errorMessage = result.errorMessage;
+        errorMessage.erase( std::remove( errorMessage.begin(),
+                                         errorMessage.end(), '\n' ),
+                            errorMessage.end() );
+        std::replace( errorMessage.begin(), errorMessage.end(), ',', ';' );
+
+        if ( errorMessage.size() ) { status = 1; }
+
+        std::stringstream line;
+        line << job + 1 << ",";
+        if ( params[ job ] ) {
+            const Parameters &param = *params[ job ];
+            line << MethodName( param.method ) << "," << param.dataFile << ","
+                 << param.E   << "," << param.Tp  << "," << param.knn << ","
+                 << param.tau << "," << param.theta << ",";
+        }
+        else {
+            line << ",,,,,,,";
+        }
+        line << result.error.rho  << "," << result.error.RMSE << ","
+             << result.error.MAE  << "," << result.error.bias << ","
+             << result.error.R2   << ","
+             << ( errorMessage.size() ? 0 : result.error.N ) << ","
+             << errorMessage;
+
+        std::cout << line.str() << std::endl;
+    }
+
+    if ( profileFile.size() ) {
+        try {
+            WriteProfileJSON( profileFile );
+        }
+        catch ( const std::exception &e ) {
+            std::cerr << e.what();
+            status = 1;
+        }
+    }
+
+    return status;
 }
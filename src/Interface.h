@@ -0,0 +1,37 @@
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// Command line interface of the edm executable.
+//
+//   edm [arguments]                one job from the arguments
+//   edm -J jobFile [arguments]     one job per line of jobFile
+//
+// Arguments are those of Parameters::Load(), e.g.
+//   -m simplex -pa ../data/ -i LorenzData1000.csv -l "1 500"
+//   -p "501 800" -E 3 -c V1 -r V1 -o out.csv
+// With a job file the command line arguments are defaults that each
+// job line adds to or overrides. Job lines are split on white space,
+// double quotes group a value with spaces. Blank lines and lines
+// starting with # are ignored.
+//
+// Each data file is loaded once for all jobs that use it. Jobs run on
+// the shared pool (ThreadPool.h) of -n threads (0 : EDM_THREADS, else
+// all cores, default 1). One csv line of prediction error per job is
+// written to stdout.
+//
+//   edm --server [--socket path] [--cacheSize N] [arguments]
+//
+// runs a Server (Server.h) on stdin/stdout, or on a Unix domain socket
+// at path, with the arguments as defaults of each request.
+//
+// Returns 0 if all jobs succeed, 1 otherwise.
+//---------------------------------------------------------
+int Interface( int argc, char *argv[] );
+
+// Split a job line into arguments
+std::vector< std::string > SplitArguments( const std::string &line );
+
+#endif
@@ -0,0 +1,143 @@
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "IntervalSet.h"
+
+//----------------------------------------------------------------
+// Constructors
+//----------------------------------------------------------------
+IntervalSet::IntervalSet( size_t first, size_t last ) : N( 0 ) {
+    Add( first, last );
+}
+
+IntervalSet::IntervalSet( const std::vector< size_t > &indices ) : N( 0 ) {
+    for ( auto index : indices ) {
+        intervals.push_back( Interval( index, index ) );
+    }
+    Normalize();
+}
+
+//----------------------------------------------------------------
+// Add indices [first, last], merged with existing intervals
+//----------------------------------------------------------------
+void IntervalSet::Add( size_t first, size_t last ) {
+
+    if ( first > last ) {
+        std::stringstream errMsg;
+        errMsg << "IntervalSet::Add(): first " << first
+               << " exceeds last " << last << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    intervals.push_back( Interval( first, last ) );
+    Normalize();
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+void IntervalSet::Clear() {
+    intervals.clear();
+    offsets.clear();
+    N = 0;
+}
+
+//----------------------------------------------------------------
+// Sort intervals, merge overlapping and adjacent ones
+//----------------------------------------------------------------
+void IntervalSet::Normalize() {
+
+    std::sort( intervals.begin(), intervals.end() );
+
+    std::vector< Interval > merged;
+    for ( auto &interval : intervals ) {
+        if ( merged.size() and interval.first <= merged.back().second + 1 ) {
+            merged.back().second = std::max( merged.back().second,
+                                             interval.second );
+        }
+        else {
+            merged.push_back( interval );
+        }
+    }
+    intervals.swap( merged );
+
+    offsets.resize( intervals.size() );
+    N = 0;
+    for ( size_t i = 0; i < intervals.size(); i++ ) {
+        offsets[ i ] = N;
+        N += intervals[ i ].second - intervals[ i ].first + 1;
+    }
+}
+
+//----------------------------------------------------------------
+// i-th smallest index of the set
+//----------------------------------------------------------------
+size_t IntervalSet::operator[]( size_t i ) const {
+
+    if ( intervals.size() == 1 ) {
+        return intervals[ 0 ].first + i;
+    }
+
+    // Last interval with offset <= i
+    size_t interval_i = std::upper_bound( offsets.begin(), offsets.end(), i ) -
+                        offsets.begin() - 1;
+    return intervals[ interval_i ].first + ( i - offsets[ interval_i ] );
+}
+
+//----------------------------------------------------------------
+// Membership: binary search of the interval starts
+//----------------------------------------------------------------
+bool IntervalSet::Contains( size_t index ) const {
+
+    if ( intervals.size() == 1 ) {
+        return index >= intervals[ 0 ].first and
+               index <= intervals[ 0 ].second;
+    }
+
+    auto next = std::upper_bound( intervals.begin(), intervals.end(),
+                                  Interval( index, (size_t) -1 ) );
+    if ( next == intervals.begin() ) {
+        return false;
+    }
+    return index <= ( next - 1 )->second;
+}
+
+//----------------------------------------------------------------
+// Intersection by a merge of the two sorted interval lists
+//----------------------------------------------------------------
+IntervalSet IntervalSet::Intersection( const IntervalSet &other ) const {
+
+    IntervalSet result;
+
+    size_t i = 0;
+    size_t j = 0;
+    while ( i < intervals.size() and j < other.intervals.size() ) {
+        size_t first = std::max( intervals[ i ].first,
+                                 other.intervals[ j ].first );
+        size_t last  = std::min( intervals[ i ].second,
+                                 other.intervals[ j ].second );
+        if ( first <= last ) {
+            result.intervals.push_back( Interval( first, last ) );
+        }
+        if ( intervals[ i ].second < other.intervals[ j ].second ) { i++; }
+        else                                                       { j++; }
+    }
+    result.Normalize();
+
+    return result;
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+std::ostream& operator<<( std::ostream &os, const IntervalSet &set ) {
+    os << "[";
+    for ( size_t i = 0; i < set.intervals.size(); i++ ) {
+        os << ( i ? " " : "" ) << set.intervals[ i ].first << ":"
+           << set.intervals[ i ].second;
+    }
+    os << "]";
+    return os;
+}
@@ -0,0 +1,111 @@
+#ifndef INTERVALSET_H
+#define INTERVALSET_H
+
+#include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+//---------------------------------------------------------
+// IntervalSet class
+// Set of row indices stored as sorted, disjoint, non-adjacent
+// closed intervals [first, last]. Used for library and prediction
+// rows: a single range is one interval regardless of its length.
+//
+// Behaves as a sorted std::vector<size_t> of the indices for
+// reading: size(), operator[], front(), back() and forward iteration.
+// Contains() is O(1) for a single interval, O(log K) for K intervals.
+// operator[] is likewise O(1) / O(log K).
+//---------------------------------------------------------
+class IntervalSet {
+
+public:
+    typedef std::pair< size_t, size_t > Interval; // [first, last]
+
+    //-----------------------------------------------------
+    // Forward iterator over the indices of the set
+    //-----------------------------------------------------
+    class const_iterator {
+        const IntervalSet *set;
+        size_t             interval_i;
+        size_t             index;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef size_t                    value_type;
+        typedef std::ptrdiff_t            difference_type;
+        typedef const size_t*             pointer;
+        typedef const size_t&             reference;
+
+        const_iterator( const IntervalSet *set, size_t interval_i ) :
+            set( set ), interval_i( interval_i ),
+            index( interval_i < set->intervals.size() ?
+                   set->intervals[ interval_i ].first : 0 ) {}
+
+        const size_t &operator*() const { return index; }
+
+        const_iterator &operator++() {
+            if ( index < set->intervals[ interval_i ].second ) {
+                index++;
+            }
+            else {
+                interval_i++;
+                index = interval_i < set->intervals.size() ?
+                        set->intervals[ interval_i ].first : 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++( int ) {
+            const_iterator previous( *this );
+            ++(*this);
+            return previous;
+        }
+
+        bool operator==( const const_iterator &other ) const {
+            return interval_i == other.interval_i and index == other.index;
+        }
+        bool operator!=( const const_iterator &other ) const {
+            return not ( *this == other );
+        }
+    };
+
+private:
+    std::vector< Interval > intervals;
+    std::vector< size_t >   offsets; // number of indices before intervals[i]
+    size_t                  N;       // number of indices
+
+    void Normalize(); // sort, merge, recompute offsets and N
+
+public:
+    IntervalSet() : N( 0 ) {}
+    IntervalSet( size_t first, size_t last );
+    explicit IntervalSet( const std::vector< size_t > &indices );
+
+    void Add( size_t first, size_t last ); // add [first, last]
+    void Clear();
+
+    size_t size()  const { return N;      }
+    bool   empty() const { return N == 0; }
+
+    size_t operator[]( size_t i ) const; // i-th smallest index
+    size_t front() const { return intervals.front().first; }
+    size_t back()  const { return intervals.back().second; }
+
+    bool   Contains( size_t index ) const;
+
+    // Indices in both sets, computed on the intervals
+    IntervalSet Intersection( const IntervalSet &other ) const;
+
+    const std::vector< Interval > &Intervals() const { return intervals; }
+
+    const_iterator begin() const { return const_iterator( this, 0 ); }
+    const_iterator end()   const {
+        return const_iterator( this, intervals.size() );
+    }
+
+    // Intervals as first:last ranges, e.g. [0:99 200:299]
+    friend std::ostream& operator<<( std::ostream &os, const IntervalSet &set );
+};
+
+#endif
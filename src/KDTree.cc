@@ -0,0 +1,304 @@
+
+#include <algorithm>
+
+#include "KDTree.h"
+#include "Neighbors.h"
+
+//----------------------------------------------------------------
+// Constructor
+//----------------------------------------------------------------
+template< class T >
+KDTree< T >::KDTree( size_t dim, DistanceMetric metric ) :
+    dim( dim ), metric( metric ), root( -1 ),
+    nLive( 0 ), nBuilt( 0 ), nModified( 0 ) {}
+
+//----------------------------------------------------------------
+// Build a balanced tree from points (N x dim, row-major) and ids
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Build( const std::vector<T>      &points,
+                         const std::vector<size_t> &ids ) {
+
+    if ( dim == 0 or points.size() != ids.size() * dim ) {
+        std::stringstream errMsg;
+        errMsg << "KDTree::Build(): " << points.size() << " coordinates "
+               << "do not match " << ids.size() << " ids of dimension "
+               << dim << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    Clear();
+
+    nodes.resize( ids.size() );
+    coords = points;
+    for ( size_t i = 0; i < ids.size(); i++ ) {
+        nodes[ i ] = Node{ ids[ i ], 0, -1, -1, false };
+    }
+    nLive = ids.size();
+
+    Rebuild();
+}
+
+//----------------------------------------------------------------
+// Rebuild a balanced tree from the nodes not removed
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Rebuild() {
+
+    std::vector<int> order;
+    order.reserve( nLive );
+    for ( size_t i = 0; i < nodes.size(); i++ ) {
+        if ( not nodes[ i ].removed ) { order.push_back( i ); }
+    }
+
+    std::vector<Node>   newNodes;
+    std::vector<T>      newCoords;
+    newNodes.reserve ( order.size() );
+    newCoords.reserve( order.size() * dim );
+
+    root = BuildRange( order, 0, order.size(), newNodes, newCoords );
+
+    nodes.swap ( newNodes );
+    coords.swap( newCoords );
+
+    idToNode.clear();
+    for ( size_t i = 0; i < nodes.size(); i++ ) {
+        idToNode[ nodes[ i ].id ] = i;
+    }
+
+    nLive     = nodes.size();
+    nBuilt    = nodes.size();
+    nModified = 0;
+}
+
+//----------------------------------------------------------------
+// Recursive median split of order[begin, end) on the axis of
+// largest spread. Returns the index of the subtree root in newNodes.
+//----------------------------------------------------------------
+template< class T >
+int KDTree< T >::BuildRange( std::vector<int>    &order,
+                             size_t               begin,
+                             size_t               end,
+                             std::vector<Node>   &newNodes,
+                             std::vector<T>      &newCoords ) {
+
+    if ( begin >= end ) { return -1; }
+
+    // Axis of largest spread
+    int    axis   = 0;
+    double spread = -1;
+    for ( size_t d = 0; d < dim; d++ ) {
+        double lo =  1E300;
+        double hi = -1E300;
+        for ( size_t i = begin; i < end; i++ ) {
+            double x = coords[ order[ i ] * dim + d ];
+            lo = std::min( lo, x );
+            hi = std::max( hi, x );
+        }
+        if ( hi - lo > spread ) { spread = hi - lo; axis = d; }
+    }
+
+    size_t mid = begin + ( end - begin ) / 2;
+    std::nth_element( order.begin() + begin, order.begin() + mid,
+                      order.begin() + end,
+                      [this, axis]( int a, int b ) {
+                          return coords[ a * dim + axis ] <
+                                 coords[ b * dim + axis ]; } );
+
+    int node_i = newNodes.size();
+    newNodes.push_back( Node{ nodes[ order[ mid ] ].id, axis, -1, -1, false } );
+    newCoords.insert( newCoords.end(),
+                      coords.begin() + order[ mid ] * dim,
+                      coords.begin() + order[ mid ] * dim + dim );
+
+    int left  = BuildRange( order, begin,   mid, newNodes, newCoords );
+    int right = BuildRange( order, mid + 1, end, newNodes, newCoords );
+
+    newNodes[ node_i ].left  = left;
+    newNodes[ node_i ].right = right;
+
+    return node_i;
+}
+
+//----------------------------------------------------------------
+// Insert point with id as a new leaf
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Insert( size_t id, const T *point ) {
+
+    if ( dim == 0 ) {
+        throw std::runtime_error( "KDTree::Insert(): dimension is 0.\n" );
+    }
+    if ( idToNode.count( id ) ) {
+        std::stringstream errMsg;
+        errMsg << "KDTree::Insert(): id " << id << " already present.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    int node_i = nodes.size();
+    coords.insert( coords.end(), point, point + dim );
+
+    if ( root < 0 ) {
+        nodes.push_back( Node{ id, 0, -1, -1, false } );
+        root = node_i;
+    }
+    else {
+        int parent = root;
+        while ( true ) {
+            Node &p    = nodes[ parent ];
+            bool  left = point[ p.axis ] < coords[ parent * dim + p.axis ];
+            int   next = left ? p.left : p.right;
+            if ( next < 0 ) {
+                int axis = ( p.axis + 1 ) % dim;
+                if ( left ) { p.left  = node_i; }
+                else        { p.right = node_i; }
+                nodes.push_back( Node{ id, axis, -1, -1, false } );
+                break;
+            }
+            parent = next;
+        }
+    }
+
+    idToNode[ id ] = node_i;
+    nLive++;
+    nModified++;
+
+    if ( nModified > std::max( nBuilt, (size_t) 32 ) / 2 ) {
+        Rebuild();
+    }
+}
+
+//----------------------------------------------------------------
+// Mark point id as removed
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Remove( size_t id ) {
+
+    auto ni = idToNode.find( id );
+    if ( ni == idToNode.end() ) {
+        std::stringstream errMsg;
+        errMsg << "KDTree::Remove(): id " << id << " not found.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    nodes[ ni->second ].removed = true;
+    idToNode.erase( ni );
+    nLive--;
+    nModified++;
+
+    if ( nModified > std::max( nBuilt, (size_t) 32 ) / 2 ) {
+        Rebuild();
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Clear() {
+    nodes.clear();
+    coords.clear();
+    idToNode.clear();
+    root      = -1;
+    nLive     = 0;
+    nBuilt    = 0;
+    nModified = 0;
+}
+
+//----------------------------------------------------------------
+// k nearest neighbors of point
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Query(
+    const T                               *point,
+    size_t                                 knn,
+    const std::function< bool( size_t ) > &accept,
+    std::vector< size_t >                 &neighborIds,
+    std::vector< double >                 &neighborDistances )
+    const {
+
+    // max-heap of ( distance, id ) : top is the current k-th neighbor
+    std::vector< std::pair< double, size_t > > heap;
+    heap.reserve( knn + 1 );
+
+    if ( knn > 0 ) {
+        Search( root, point, knn, accept, heap );
+    }
+
+    std::sort_heap( heap.begin(), heap.end() );
+
+    neighborIds.resize      ( heap.size() );
+    neighborDistances.resize( heap.size() );
+    for ( size_t i = 0; i < heap.size(); i++ ) {
+        neighborDistances[ i ] = heap[ i ].first;
+        neighborIds      [ i ] = heap[ i ].second;
+    }
+}
+
+//----------------------------------------------------------------
+// Depth first search, near side first. The distance to the split
+// plane is a lower bound of the distance for any Lp metric.
+//----------------------------------------------------------------
+template< class T >
+void KDTree< T >::Search(
+    int                                    node_i,
+    const T                               *point,
+    size_t                                 knn,
+    const std::function< bool( size_t ) > &accept,
+    std::vector< std::pair< double, size_t > > &heap ) const {
+
+    if ( node_i < 0 ) { return; }
+
+    const Node   &node  = nodes[ node_i ];
+    const T      *nodeX = &coords[ node_i * dim ];
+
+    if ( not node.removed and accept( node.id ) ) {
+        double d = Distance( point, nodeX, dim, metric );
+        if ( heap.size() < knn ) {
+            heap.push_back( std::make_pair( d, node.id ) );
+            std::push_heap( heap.begin(), heap.end() );
+        }
+        else if ( d < heap.front().first ) {
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = std::make_pair( d, node.id );
+            std::push_heap( heap.begin(), heap.end() );
+        }
+    }
+
+    double diff = point[ node.axis ] - nodeX[ node.axis ];
+    int    near = diff < 0 ? node.left  : node.right;
+    int    far  = diff < 0 ? node.right : node.left;
+
+    Search( near, point, knn, accept, heap );
+
+    if ( heap.size() < knn or std::abs( diff ) < heap.front().first ) {
+        Search( far, point, knn, accept, heap );
+    }
+    else if ( far >= 0 ) {
+        EDM_PROFILE_COUNT( CandidatesPruned, 1 );
+    }
+}
+
+//----------------------------------------------------------------
+// Coordinates of point id
+//----------------------------------------------------------------
+template< class T >
+const T *KDTree< T >::Point( size_t id ) const {
+    auto ni = idToNode.find( id );
+    if ( ni == idToNode.end() ) {
+        std::stringstream errMsg;
+        errMsg << "KDTree::Point(): id " << id << " not found.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    return &coords[ ni->second * dim ];
+}
+
+//----------------------------------------------------------------
+template< class T >
+bool KDTree< T >::Contains( size_t id ) const {
+    return idToNode.count( id ) > 0;
+}
+
+// Coordinate types of the neighbor indices
+template class KDTree< double >;
+template class KDTree< float  >;
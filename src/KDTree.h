@@ -0,0 +1,80 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <functional>
+#include <unordered_map>
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// KDTree class
+// k-d tree of points with dimension dim, each point tagged with
+// a caller supplied id (typically a data row index).
+// Point coordinates of type T (double or float) are held in a single
+// contiguous vector. Distances are returned as double.
+//
+// The tree is dynamic: Insert() appends a leaf, Remove() marks a
+// node as deleted. The tree is rebuilt (median split) when the
+// number of inserts or removals since the last build exceeds half
+// the tree size, so the amortized cost of Insert/Remove is O(log N).
+//---------------------------------------------------------
+template< class T >
+class KDTree {
+
+    struct Node {
+        size_t id;      // caller id of the point
+        int    axis;    // split axis
+        int    left;    // node index, -1 if none
+        int    right;   // node index, -1 if none
+        bool   removed; // lazily deleted
+    };
+
+    size_t              dim;
+    DistanceMetric      metric;
+    std::vector<Node>   nodes;
+    std::vector<T>      coords;   // nodes[i] point at coords[ i * dim ]
+    int                 root;
+
+    std::unordered_map< size_t, int > idToNode;
+
+    size_t nLive;          // number of points not removed
+    size_t nBuilt;         // number of points at last Build()
+    size_t nModified;      // Insert() + Remove() since last Build()
+
+    int  BuildRange( std::vector<int> &order, size_t begin, size_t end,
+                     std::vector<Node> &newNodes,
+                     std::vector<T>    &newCoords );
+    void Rebuild();
+
+    void Search( int node, const T *point, size_t knn,
+                 const std::function< bool( size_t ) > &accept,
+                 std::vector< std::pair< double, size_t > > &heap ) const;
+
+public:
+    KDTree( size_t dim = 0, DistanceMetric metric = DistanceMetric::Euclidean );
+
+    // Replace the tree with points (row-major, N x dim) tagged by ids
+    void Build( const std::vector<T>      &points,
+                const std::vector<size_t> &ids );
+
+    void Insert( size_t id, const T *point );
+    void Remove( size_t id );
+    void Clear ();
+
+    // k nearest neighbors of point among ids for which accept(id)
+    // is true. Results are sorted by increasing distance.
+    void Query( const T                             *point,
+                size_t                               knn,
+                const std::function< bool( size_t ) > &accept,
+                std::vector< size_t >               &neighborIds,
+                std::vector< double >               &neighborDistances ) const;
+
+    // Accessors
+    const T       *Point( size_t id ) const;
+    bool           Contains( size_t id ) const;
+    size_t         Size()      const { return nLive; }
+    size_t         Dimension() const { return dim;   }
+    DistanceMetric Metric()    const { return metric; }
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <list>
+#include <map>
+#include <utility>
+
+//---------------------------------------------------------
+// LRUCache class
+// At most capacity Key : Value entries, Put() of a new key into a
+// full cache evicts the least recently used entry. Get() and Put()
+// mark the entry as most recently used. Not thread safe: callers
+// serialize access.
+//---------------------------------------------------------
+template< class Key, class Value >
+class LRUCache {
+
+    typedef std::list< std::pair< Key, Value > > EntryList;
+
+    EntryList                                        entries; // MRU first
+    std::map< Key, typename EntryList::iterator >    index;
+    size_t                                           capacity;
+    size_t                                           hits;
+    size_t                                           misses;
+
+public:
+    explicit LRUCache( size_t capacity = 16 ) :
+        capacity( capacity ), hits( 0 ), misses( 0 ) {}
+
+    // true and value of key if present
+    bool Get( const Key &key, Value &value ) {
+        auto found = index.find( key );
+        if ( found == index.end() ) {
+            misses++;
+            return false;
+        }
+        hits++;
+        entries.splice( entries.begin(), entries, found->second );
+        value = found->second->second;
+        return true;
+    }
+
+    void Put( const Key &key, const Value &value ) {
+        auto found = index.find( key );
+        if ( found != index.end() ) {
+            found->second->second = value;
+            entries.splice( entries.begin(), entries, found->second );
+            return;
+        }
+        if ( not capacity ) {
+            return;
+        }
+        if ( entries.size() >= capacity ) {
+            index.erase( entries.back().first );
+            entries.pop_back();
+        }
+        entries.push_front( std::make_pair( key, value ) );
+        index[ key ] = entries.begin();
+    }
+
+    void Erase( const Key &key ) {
+        auto found = index.find( key );
+        if ( found != index.end() ) {
+            entries.erase( found->second );
+            index.erase( found );
+        }
+    }
+
+    void Clear() {
+        entries.clear();
+        index.clear();
+    }
+
+    size_t Size()     const { return entries.size(); }
+    size_t Capacity() const { return capacity; }
+    size_t Hits()     const { return hits;   }
+    size_t Misses()   const { return misses; }
+};
+
+#endif
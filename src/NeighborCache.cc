@@ -0,0 +1,230 @@
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "NeighborCache.h"
+
+namespace {
+    //------------------------------------------------------------
+    // 64 bit FNV-1a hash
+    //------------------------------------------------------------
+    class Hash64 {
+        uint64_t hash;
+    public:
+        Hash64() : hash( 14695981039346656037ULL ) {}
+
+        void Add( const void *data, size_t N ) {
+            const unsigned char *bytes = (const unsigned char *) data;
+            for ( size_t i = 0; i < N; i++ ) {
+                hash ^= bytes[ i ];
+                hash *= 1099511628211ULL;
+            }
+        }
+        template< class T > void Add( T value ) { Add( &value, sizeof( T ) ); }
+
+        uint64_t Value() const { return hash; }
+    };
+
+    // Cache file layout: header, int32 neighbors, double distances
+    const char     CacheMagic[ 8 ] = { 'c','p','p','E','D','M','N','N' };
+    const uint32_t CacheVersion    = 1;
+
+    struct CacheHeader {
+        char     magic[ 8 ];
+        uint32_t version;
+        uint32_t knn;
+        uint64_t key;
+        uint64_t rows;
+    };
+}
+
+namespace {
+//----------------------------------------------------------------
+// Key of the data block and the neighbor Parameters
+//----------------------------------------------------------------
+template< class T >
+uint64_t BlockKey( const DataFrame< T > &dataBlock,
+                   const Parameters     &param ) {
+    Hash64 hash;
+
+    hash.Add( (uint64_t) dataBlock.NRows()    );
+    hash.Add( (uint64_t) dataBlock.NColumns() );
+    for ( size_t row = 0; row < dataBlock.NRows(); row++ ) {
+        for ( size_t col = 0; col < dataBlock.NColumns(); col++ ) {
+            hash.Add( dataBlock( row, col ) );
+        }
+    }
+
+    hash.Add( (int32_t) param.E   );
+    hash.Add( (int32_t) param.tau );
+    hash.Add( (int32_t) param.knn );
+    hash.Add( (int32_t) param.Tp  );
+    hash.Add( (uint8_t) param.embedded        );
+    hash.Add( (uint8_t) param.noNeighborLimit );
+    hash.Add( (int32_t) param.exclusionRadius );
+    hash.Add( (uint8_t) param.neighborAlgorithm );
+    hash.Add( (uint8_t) param.metric );
+    hash.Add( (uint8_t) param.singlePrecision );
+    if ( param.neighborAlgorithm == NeighborAlgorithm::HNSW ) {
+        hash.Add( (int32_t) param.hnswM  );
+        hash.Add( (int32_t) param.hnswEf );
+    }
+
+    hash.Add( (uint64_t) param.library.Intervals().size() );
+    for ( auto &interval : param.library.Intervals() ) {
+        hash.Add( (uint64_t) interval.first  );
+        hash.Add( (uint64_t) interval.second );
+    }
+    hash.Add( (uint64_t) param.prediction.Intervals().size() );
+    for ( auto &interval : param.prediction.Intervals() ) {
+        hash.Add( (uint64_t) interval.first  );
+        hash.Add( (uint64_t) interval.second );
+    }
+
+    return hash.Value();
+}
+} // namespace
+
+uint64_t NeighborCacheKey( const DataFrame< double > &dataBlock,
+                           const Parameters          &param ) {
+    return BlockKey( dataBlock, param );
+}
+
+uint64_t NeighborCacheKey( const DataFrame< float >  &dataBlock,
+                           const Parameters          &param ) {
+    return BlockKey( dataBlock, param );
+}
+
+//----------------------------------------------------------------
+// cachePath/EDM_NN_<key>.bin, cachePath is a directory with or
+// without a trailing /
+//----------------------------------------------------------------
+std::string NeighborCacheFile( const std::string &cachePath, uint64_t key ) {
+    std::stringstream fileName;
+    fileName << cachePath;
+    if ( cachePath.size() and cachePath.back() != '/' ) {
+        fileName << '/';
+    }
+    fileName << "EDM_NN_" << std::hex << std::setw( 16 )
+             << std::setfill( '0' ) << key << ".bin";
+    return fileName.str();
+}
+
+//----------------------------------------------------------------
+// Map the cache file for key into neighbors
+//----------------------------------------------------------------
+bool LoadNeighborCache( const std::string &cachePath,
+                        uint64_t           key,
+                        Neighbors         &neighbors ) {
+
+    std::string fileName = NeighborCacheFile( cachePath, key );
+
+    int fd = open( fileName.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if ( fstat( fd, &fileStat ) != 0 or
+         fileStat.st_size < (off_t) sizeof( CacheHeader ) ) {
+        close( fd );
+        return false;
+    }
+
+    size_t fileSize = fileStat.st_size;
+    void  *map      = mmap( NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( map == MAP_FAILED ) {
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy( &header, map, sizeof( CacheHeader ) );
+
+    size_t N = header.rows * header.knn;
+
+    bool valid = memcmp( header.magic, CacheMagic, sizeof(CacheMagic) ) == 0
+        and header.version == CacheVersion
+        and header.key     == key
+        and fileSize == sizeof( CacheHeader ) +
+                        N * ( sizeof( int32_t ) + sizeof( double ) );
+
+    if ( valid ) {
+        const char *data = (const char *) map + sizeof( CacheHeader );
+
+        neighbors.neighbors = DataFrame< int    >( header.rows, header.knn,
+                                                   Uninitialized() );
+        neighbors.distances = DataFrame< double >( header.rows, header.knn,
+                                                   Uninitialized() );
+
+        const int32_t *index    = (const int32_t *) data;
+        const double  *distance = (const double  *)( data +
+                                                     N * sizeof( int32_t ) );
+        std::copy( index,    index    + N, neighbors.neighbors.Data() );
+        std::copy( distance, distance + N, neighbors.distances.Data() );
+    }
+
+    munmap( map, fileSize );
+
+    return valid;
+}
+
+//----------------------------------------------------------------
+// Write neighbors to the cache file for key.
+// Written to a temporary file then renamed so that a concurrent
+// LoadNeighborCache() never maps a partial file.
+//----------------------------------------------------------------
+void SaveNeighborCache( const std::string &cachePath,
+                        uint64_t           key,
+                        const Neighbors   &neighbors ) {
+
+    std::string fileName = NeighborCacheFile( cachePath, key );
+    std::stringstream tmpName;
+    tmpName << fileName << "." << getpid() << ".tmp";
+
+    CacheHeader header;
+    memcpy( header.magic, CacheMagic, sizeof( CacheMagic ) );
+    header.version = CacheVersion;
+    header.knn     = neighbors.neighbors.NColumns();
+    header.key     = key;
+    header.rows    = neighbors.neighbors.NRows();
+
+    size_t N = header.rows * header.knn;
+
+    std::vector< int32_t > index( N );
+    for ( size_t i = 0; i < N; i++ ) {
+        index[ i ] = neighbors.neighbors( i / header.knn, i % header.knn );
+    }
+    std::vector< double > distance( N );
+    for ( size_t i = 0; i < N; i++ ) {
+        distance[ i ] = neighbors.distances( i / header.knn, i % header.knn );
+    }
+
+    std::ofstream cacheStrm( tmpName.str(), std::ios::binary );
+    if ( not cacheStrm.is_open() ) {
+        std::stringstream errMsg;
+        errMsg << "SaveNeighborCache(): file " << tmpName.str()
+               << " is not open for writing.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    cacheStrm.write( (const char *) &header,      sizeof( CacheHeader ) );
+    cacheStrm.write( (const char *) index.data(),    N * sizeof( int32_t ) );
+    cacheStrm.write( (const char *) distance.data(), N * sizeof( double ) );
+    cacheStrm.close();
+
+    if ( not cacheStrm or
+         std::rename( tmpName.str().c_str(), fileName.c_str() ) != 0 ) {
+        std::remove( tmpName.str().c_str() );
+        std::stringstream errMsg;
+        errMsg << "SaveNeighborCache(): failed to write " << fileName << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef NEIGHBORCACHE_H
+#define NEIGHBORCACHE_H
+
+#include <cstdint>
+
+#include "Common.h"
+#include "Parameter.h"
+#include "Neighbors.h"
+
+//---------------------------------------------------------
+// On-disk cache of FindNeighbors() results.
+//
+// A cache file holds the neighbor indices and distances of one
+// FindNeighbors() call. The file is named by a 64 bit key: a hash
+// of the data block and of the Parameters that determine the
+// neighbors (E, tau, knn, Tp, library, prediction, exclusion
+// rules). Parameters that do not affect the neighbors, such as
+// target or theta, are not in the key so that runs that differ only
+// in those reuse the cache.
+//
+// Cache files are read with mmap().
+//---------------------------------------------------------
+uint64_t NeighborCacheKey( const DataFrame< double > &dataBlock,
+                           const Parameters          &param );
+uint64_t NeighborCacheKey( const DataFrame< float >  &dataBlock,
+                           const Parameters          &param );
+
+std::string NeighborCacheFile( const std::string &cachePath, uint64_t key );
+
+// Returns false if there is no valid cache file for key
+bool LoadNeighborCache( const std::string &cachePath,
+                        uint64_t           key,
+                        Neighbors         &neighbors );
+
+void SaveNeighborCache( const std::string &cachePath,
+                        uint64_t           key,
+                        const Neighbors   &neighbors );
+
+#endif
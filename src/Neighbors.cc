@@ -1,23 +1,219 @@
 
+#include <type_traits>
+
 #include "Neighbors.h"
+#include "Embed.h"
+#include "Async.h"
 
 //----------------------------------------------------------------
 Neighbors:: Neighbors() {}
 Neighbors::~Neighbors() {}
 
+namespace {
+    //------------------------------------------------------------
+    // Element type of the rows of a data block
+    //------------------------------------------------------------
+    template< class Block > struct BlockValue { typedef double type; };
+    template<> struct BlockValue< DataFrame<float> > { typedef float type; };
+
+    //------------------------------------------------------------
+    // Pointer to row of a data block, buffer holds NColumns values.
+    // DataFrame rows are contiguous, EmbeddingView rows are gathered
+    // into buffer.
+    //------------------------------------------------------------
+    inline const double *RowPointer( const DataFrame<double> &dataFrame,
+                                     size_t                   row,
+                                     std::vector<double>     & /* buffer */ ) {
+        return &dataFrame( row, 0 );
+    }
+
+    inline const float *RowPointer( const DataFrame<float> &dataFrame,
+                                    size_t                  row,
+                                    std::vector<float>     & /* buffer */ ) {
+        return &dataFrame( row, 0 );
+    }
+
+    inline const double *RowPointer( const EmbeddingView &view,
+                                     size_t               row,
+                                     std::vector<double> &buffer ) {
+        for ( size_t col = 0; col < buffer.size(); col++ ) {
+            buffer[ col ] = view( row, col );
+        }
+        return buffer.data();
+    }
+
+    //------------------------------------------------------------
+    // rows (library or prediction) must be rows of the block.
+    // The embedding has tau * (E-1) fewer rows than the data.
+    //------------------------------------------------------------
+    template< class Block >
+    void CheckRows( const Block       &block,
+                    const IntervalSet &rows,
+                    const std::string &name ) {
+        if ( rows.size() and rows.back() >= block.NRows() ) {
+            std::stringstream errMsg;
+            errMsg << "FindNeighbors(): " << name << " row "
+                   << rows.back() + 1 << " exceeds the " << block.NRows()
+                   << " rows of the embedding.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+    }
+
+    //------------------------------------------------------------
+    // LibraryTiles: the library rows of a brute force search with
+    // lib_row + Tp in the library (all if noNeighborLimit) packed
+    // column major in tiles of TileRows rows. Column c of row r of
+    // tile t is values[ ( t * N_columns + c ) * TileRows + r ].
+    // The distances from a point to the rows of a tile are summed
+    // column by column over the TileRows rows: a fixed length loop
+    // that is vectorized, twice the rows per instruction for float.
+    //------------------------------------------------------------
+    const size_t TileRows = 16;
+
+    template< class T >
+    struct LibraryTiles {
+        size_t           N_columns;
+        ArenaVector<T>   values;   // rows of the last tile past ids are 0
+        ArenaVector<int> ids;      // library row of each packed row
+
+        template< class Block >
+        LibraryTiles( const Block &block, const Parameters &parameters );
+
+        size_t NTiles() const {
+            return ( ids.size() + TileRows - 1 ) / TileRows;
+        }
+
+        void Distances( size_t         tile,
+                        const T       *point,
+                        DistanceMetric metric,
+                        T             *distances ) const;
+    };
+
+    template< class T >
+    template< class Block >
+    LibraryTiles< T >::LibraryTiles( const Block      &block,
+                                     const Parameters &parameters ) :
+        N_columns( block.NColumns() )
+    {
+        for ( auto lib_row : parameters.library ) {
+            if ( parameters.noNeighborLimit or
+                 parameters.library.Contains( lib_row + parameters.Tp ) ) {
+                ids.push_back( lib_row );
+            }
+        }
+
+        values.assign( NTiles() * N_columns * TileRows, 0 );
+
+        std::vector<T> row_buffer( N_columns );
+        for ( size_t i = 0; i < ids.size(); i++ ) {
+            const T *row = RowPointer( block, ids[ i ], row_buffer );
+            T *tile = &values[ ( i / TileRows ) * N_columns * TileRows ];
+            for ( size_t col = 0; col < N_columns; col++ ) {
+                tile[ col * TileRows + i % TileRows ] = row[ col ];
+            }
+        }
+    }
+
+    //------------------------------------------------------------
+    // distances[ r ] from point to row r of tile: the Euclidean
+    // distance is returned squared. The sums over the columns are in
+    // the order of Distance(), for double the distances are equal.
+    //------------------------------------------------------------
+    template< class T >
+    void LibraryTiles< T >::Distances( size_t         tile,
+                                       const T       *point,
+                                       DistanceMetric metric,
+                                       T             *distances ) const {
+
+        const T *x = &values[ tile * N_columns * TileRows ];
+
+        for ( size_t r = 0; r < TileRows; r++ ) { distances[ r ] = 0; }
+
+        for ( size_t col = 0; col < N_columns; col++ ) {
+            const T *xc = x + col * TileRows;
+            T        pc = point[ col ];
+
+            if ( metric == DistanceMetric::Euclidean ) {
+                for ( size_t r = 0; r < TileRows; r++ ) {
+                    T d = pc - xc[ r ];
+                    distances[ r ] += d * d;
+                }
+            }
+            else if ( metric == DistanceMetric::Manhattan ) {
+                for ( size_t r = 0; r < TileRows; r++ ) {
+                    distances[ r ] += std::abs( pc - xc[ r ] );
+                }
+            }
+            else {
+                for ( size_t r = 0; r < TileRows; r++ ) {
+                    distances[ r ] = std::max( distances[ r ],
+                                               std::abs( pc - xc[ r ] ) );
+                }
+            }
+        }
+    }
+
+    template< class Block >
+    Neighbors FindNeighborsBlock( const Block      &dataFrame,
+                                  const Parameters &parameters );
+
+    template< class Block >
+    void FindNeighborsIndex( const Block      &dataFrame,
+                             const Parameters &parameters,
+                             Neighbors        &neighbors );
+
+    template< class Block >
+    void QueryNeighborIndex( const NeighborIndex &index,
+                             const Block         &dataFrame,
+                             const Parameters    &parameters,
+                             Neighbors           &neighbors );
+}
+
 //----------------------------------------------------------------
 // It is assumed that the data frame has only columns of data for
 // which knn will be computed.  The (time) column is not present.
 //----------------------------------------------------------------
 struct Neighbors FindNeighbors(
-    DataFrame<double> dataFrame,
-    Parameters        parameters )
+    const DataFrame<double> &dataFrame,
+    const Parameters        &parameters )
 {
 
 #ifdef DEBUG_ALL
     PrintDataFrameIn( dataFrame, parameters );
 #endif
 
+    return FindNeighborsBlock( dataFrame, parameters );
+}
+
+//----------------------------------------------------------------
+// FindNeighbors of the lagged embedding view: the embedding
+// is not materialized.
+//----------------------------------------------------------------
+struct Neighbors FindNeighbors(
+    const EmbeddingView &embedding,
+    const Parameters    &parameters )
+{
+    return FindNeighborsBlock( embedding, parameters );
+}
+
+//----------------------------------------------------------------
+// FindNeighbors of a single precision block: distances of float
+// rows are computed in float.
+//----------------------------------------------------------------
+struct Neighbors FindNeighbors(
+    const DataFrame<float> &dataFrame,
+    const Parameters       &parameters )
+{
+    return FindNeighborsBlock( dataFrame, parameters );
+}
+
+namespace {
+template< class Block >
+Neighbors FindNeighborsBlock( const Block      &dataFrame,
+                              const Parameters &parameters )
+{
+    EDM_PROFILE_SCOPE( FindNeighbors );
+
     if ( not parameters.validated ) {
         std::string errMsg("FindNeighbors(): Parameters not validated." );
         throw( std::runtime_error( errMsg ) );
@@ -31,7 +227,9 @@ struct Neighbors FindNeighbors(
         throw std::runtime_error( errMsg.str() );
     }
 
-    int N_library_rows    = parameters.library.size();
+    CheckRows( dataFrame, parameters.library,    "library"    );
+    CheckRows( dataFrame, parameters.prediction, "prediction" );
+
     int N_prediction_rows = parameters.prediction.size();
     int N_columns         = dataFrame.NColumns();
     
@@ -40,22 +238,19 @@ struct Neighbors FindNeighbors(
     size_t maxCol_i = N_columns - 1;
 
     // Identify degenerate library : prediction points by
-    // set_intersection() of lib & pred indices, needs a result vector
-    std::vector< double > result( N_library_rows + N_prediction_rows, 0 );
-    std::vector< double >::iterator ii = set_intersection (
-        parameters.prediction.begin(), parameters.prediction.end(),
-        parameters.library.begin(),    parameters.library.end(), 
-        result.begin() );
-    
-    if ( ii != result.begin() ) {
-        // Overlapping indices exist
-        std::stringstream msg;
-        msg << "WARNING: FindNeighbors(): Degenerate library and prediction "
-            << "data found. Overlap indices: ";
-        for ( auto ri = result.begin(); ri != ii; ++ri ) {
-            msg << *ri << " ";
-        } msg << std::endl;
-        std::cout << msg.str();
+    // the intersection of the lib & pred intervals
+    if ( parameters.verbose ) {
+        IntervalSet overlap =
+            parameters.prediction.Intersection( parameters.library );
+
+        if ( overlap.size() ) {
+            // Overlapping indices exist
+            std::stringstream msg;
+            msg << "WARNING: FindNeighbors(): Degenerate library and "
+                << "prediction data found. Overlap indices: "
+                << overlap << std::endl;
+            Message( msg.str() );
+        }
     }
 
     // Neighbors: struct on local stack to be returned by copy
@@ -63,22 +258,48 @@ struct Neighbors FindNeighbors(
     neighbors.neighbors = DataFrame<int>   ( N_prediction_rows, parameters.knn );
     neighbors.distances = DataFrame<double>( N_prediction_rows, parameters.knn );
 
-    // Vectors to hold the indices and values from each comparison
-    std::valarray<int>    k_NN_neighbors( parameters.knn );
-    std::valarray<double> k_NN_distances( parameters.knn );
+    // Vectors to hold the indices and values from each comparison,
+    // call scoped on the thread arena
+    ArenaScope          scope;
+    ArenaVector<int>    k_NN_neighbors( parameters.knn );
+    ArenaVector<double> k_NN_distances( parameters.knn );
+    ArenaVector<int>    k_NN_neighborCopy;
+
+    // Search an index of the library instead of all library rows
+    if ( parameters.neighborAlgorithm != NeighborAlgorithm::BruteForce ) {
+        FindNeighborsIndex( dataFrame, parameters, neighbors );
+        return neighbors;
+    }
+
+    // Library rows in tiles, prediction row buffer for blocks
+    // without contiguous rows
+    typedef typename BlockValue< Block >::type Value;
+    LibraryTiles< Value > tiles( dataFrame, parameters );
+    std::vector< Value >  pred_buffer( N_columns );
+    Value                 tileDistances[ TileRows ];
+
+    // Tile distances not below the bound of the largest k_NN_distance
+    // (squared if Euclidean) are not nearer
+    bool euclidean = parameters.metric == DistanceMetric::Euclidean;
+    auto Bound = [ euclidean ]( double maxDistance ) {
+        return euclidean ? maxDistance * maxDistance * ( 1 + 1E-12 ) :
+                           maxDistance;
+    };
 
     //-------------------------------------------------------------------
     // For each prediction vector (row in prediction DataFrame) find the list
     // of library indices that are within k_NN points
     //-------------------------------------------------------------------
     for ( size_t row_i = 0; row_i < parameters.prediction.size(); row_i++ ) {
+        ReportProgress( "FindNeighbors", row_i, N_prediction_rows );
+
         // Get the prediction vector for this pred_row index
         int pred_row = parameters.prediction[ row_i ];
-        std::valarray<double> pred_vec = dataFrame.Row( pred_row );
+        const Value *pred_vec = RowPointer( dataFrame, pred_row, pred_buffer );
         
 #ifdef JP_REMOVE //----------------------------------------
         std::cout << "Predict row " << pred_row << " : " ;
-        for ( size_t i = 0; i < pred_vec.size(); i++ ) {
+        for ( size_t i = 0; i < N_columns; i++ ) {
             std::cout << pred_vec[i] << " ";
         } std::cout << std::endl;
 #endif // JP REMOVE ----------------------------------------
@@ -90,90 +311,102 @@ struct Neighbors FindNeighbors(
             k_NN_distances[ i ] = 1E300;
         }
 
+        // The library point degenerate with the prediction is ignored
+        if ( parameters.verbose and parameters.exclusionRadius >= 0 and
+             parameters.library.Contains( pred_row ) ) {
+            std::stringstream msg;
+            msg << "FindNeighbors(): Ignoring degenerate lib_row "
+                << pred_row << " and pred_row " << pred_row << std::endl;
+            Message( msg.str() );
+        }
+
+        auto   max_it   = std::max_element( begin( k_NN_distances ),
+                                            end  ( k_NN_distances ) );
+        double maxBound = Bound( *max_it );
+
         //--------------------------------------------------------------
         // Library Rows
         //--------------------------------------------------------------
-        for ( size_t row_j = 0; row_j < parameters.library.size(); row_j++ ) {
-            // Get the library vector for this lib_row index
-            int lib_row = parameters.library[ row_j ];
-            std::valarray<double> lib_vec = dataFrame.Row( lib_row );
+        for ( size_t tile = 0; tile < tiles.NTiles(); tile++ ) {
+            size_t row0   = tile * TileRows;
+            size_t N_tile = std::min( TileRows, tiles.ids.size() - row0 );
 
-#ifdef JP_REMOVE //----------------------------------------
-            std::cout << "Library row " << lib_row << " : " ;
-            for ( size_t k = 0; k < lib_vec.size(); k++ ) {
-                std::cout << lib_vec[k] << " ";
-            }
-#endif // JP REMOVE ----------------------------------------
-            
-            // If the library point is degenerate with the prediction,
-            // ignore it.
-            if ( lib_row == pred_row ) {
-                if ( parameters.verbose ) {
-                    std::stringstream msg;
-                    msg << "FindNeighbors(): Ignoring degenerate lib_row "
-                        << lib_row << " and pred_row " << pred_row << std::endl;
-                    std::cout << msg.str();
-                }
-                continue;
-            }
+            tiles.Distances( tile, pred_vec, parameters.metric,
+                             tileDistances );
+            EDM_PROFILE_COUNT( DistanceEvaluations, N_tile );
+
+            for ( size_t r = 0; r < N_tile; r++ ) {
+                if ( not ( tileDistances[ r ] < maxBound ) ) { continue; }
 
-            // If this lib_row + args.Tp >= library_N_row, then this neighbor
-            // would be outside the library, keep looking if noNeighborLimit
-            if ( lib_row + parameters.Tp >= N_library_rows ) {
-                if ( not parameters.noNeighborLimit ) {
+                // If the library point is degenerate with the prediction,
+                // or within exclusionRadius of it, ignore it.
+                int lib_row = tiles.ids[ row0 + r ];
+                if ( std::abs( lib_row - pred_row ) <=
+                     parameters.exclusionRadius ) {
                     continue;
                 }
-            }
-            
-            // Find distance between the prediction vector
-            // and each of the library vectors
-            // The 1st column (j=0) of Time has been excluded above
-            double d_i = Distance( lib_vec, pred_vec,
-                                   DistanceMetric::Euclidean );
+
+                double d_i = tileDistances[ r ];
+                if ( euclidean ) { d_i = std::sqrt( d_i ); }
 
 #ifdef JP_REMOVE //----------------------------------------
-            std::cout << "  D=" << d_i << std::endl;
+                std::cout << "  D=" << d_i << std::endl;
 #endif //JP REMOVE ----------------------------------------
 
-            // If d_i is less than values in k_NN_distances, add to list
-            auto max_it = std::max_element( begin( k_NN_distances ),
-                                            end( k_NN_distances ) );
-            if ( d_i < *max_it ) {
-                size_t max_i = std::distance( begin(k_NN_distances), max_it );
-                k_NN_neighbors[ max_i ] = lib_row;  // Save the index
-                k_NN_distances[ max_i ] = d_i;      // Save the value
+                // If d_i is less than values in k_NN_distances, add to list
+                if ( d_i < *max_it ) {
+                    size_t max_i = std::distance( begin( k_NN_distances ),
+                                                  max_it );
+                    k_NN_neighbors[ max_i ] = lib_row;  // Save the index
+                    k_NN_distances[ max_i ] = d_i;      // Save the value
+
+                    max_it   = std::max_element( begin( k_NN_distances ),
+                                                 end  ( k_NN_distances ) );
+                    maxBound = Bound( *max_it );
+                }
             }
-        } // for ( row_j = 0; row_j < library.size(); row_j++ )
+        } // for ( tile : tiles )
         
         if ( *std::max_element( begin( k_NN_distances ),
                                 end  ( k_NN_distances ) ) > 1E299 ) {
             std::stringstream errMsg;
             errMsg << "FindNeighbors(): Library is too small to resolve "
-                   << parameters.knn << " knn neighbors." << std::endl;
+                   << parameters.knn << " knn neighbors";
+            if ( parameters.exclusionRadius ) {
+                errMsg << " with exclusionRadius "
+                       << parameters.exclusionRadius;
+            }
+            errMsg << "." << std::endl;
             throw std::runtime_error( errMsg.str() );
         }
 
         // Check for ties.  JP: Need to address this, not just warning
-        // First sort a copy of k_NN_neighbors so unique() will work
-        std::valarray<int> k_NN_neighborCopy( k_NN_neighbors );
-        std::sort( begin( k_NN_neighborCopy ), end( k_NN_neighborCopy ) );
+        if ( parameters.verbose ) {
+            // First sort a copy of k_NN_neighbors so unique() will work
+            k_NN_neighborCopy.assign( k_NN_neighbors.begin(),
+                                      k_NN_neighbors.end() );
+            std::sort( begin( k_NN_neighborCopy ), end( k_NN_neighborCopy ) );
         
-        // ui is iterator to first non unique element
-        auto ui = std::unique( begin(k_NN_neighborCopy),
-                               end  (k_NN_neighborCopy) );
+            // ui is iterator to first non unique element
+            auto ui = std::unique( begin(k_NN_neighborCopy),
+                                   end  (k_NN_neighborCopy) );
         
-        if ( std::distance( begin( k_NN_neighborCopy ), ui ) !=
-             k_NN_neighborCopy.size() ) {
-            std::cout << "WARNING: FindNeighbors(): Degenerate neighbors."
-                      << std::endl;
+            if ( std::distance( begin( k_NN_neighborCopy ), ui ) !=
+                 k_NN_neighborCopy.size() ) {
+                Message( "WARNING: FindNeighbors(): Degenerate neighbors.\n" );
+            }
         }
 
         // Write the neighbor indices and distance values
-        neighbors.neighbors.WriteRow( row_i, k_NN_neighbors );
-        neighbors.distances.WriteRow( row_i, k_NN_distances );
+        for ( size_t k = 0; k < parameters.knn; k++ ) {
+            neighbors.neighbors( row_i, k ) = k_NN_neighbors[ k ];
+            neighbors.distances( row_i, k ) = k_NN_distances[ k ];
+        }
         
     } // for ( row_i = 0; row_i < predictionRows->size(); row_i++ )
 
+    ReportProgress( "FindNeighbors", N_prediction_rows, N_prediction_rows );
+
 #ifdef DEBUG_ALL
     const Neighbors &neigh = neighbors;
     PrintNeighborsOut( neigh );
@@ -182,6 +415,282 @@ struct Neighbors FindNeighbors(
     return neighbors;
 }
 
+//----------------------------------------------------------------
+// FindNeighbors with a NeighborIndex of the library rows: KDTree or
+// VPTree (exact) or HNSW graph (approximate). Library rows within
+// exclusionRadius of pred_row (pred_row itself if 0) are rejected
+// by the query accept filter during the index traversal.
+//----------------------------------------------------------------
+template< class Block >
+void FindNeighborsIndex( const Block      &dataFrame,
+                         const Parameters &parameters,
+                         Neighbors        &neighbors )
+{
+    NeighborIndex index;
+    index.Build( dataFrame, parameters );
+
+    QueryNeighborIndex( index, dataFrame, parameters, neighbors );
+}
+
+//----------------------------------------------------------------
+// Neighbors of the prediction rows from a built NeighborIndex
+//----------------------------------------------------------------
+template< class Block >
+void QueryNeighborIndex( const NeighborIndex &index,
+                         const Block         &dataFrame,
+                         const Parameters    &parameters,
+                         Neighbors           &neighbors )
+{
+    CheckRows( dataFrame, parameters.prediction, "prediction" );
+
+    typedef typename BlockValue< Block >::type Value;
+    std::vector<Value> row_buffer( dataFrame.NColumns() );
+
+    size_t pred_row = 0;
+    size_t radius   = std::max( parameters.exclusionRadius, 0 );
+    std::function< bool( size_t ) > accept =
+        [ &pred_row, radius ]( size_t lib_row ) {
+            return lib_row + radius < pred_row or lib_row > pred_row + radius;
+        };
+
+    std::vector<size_t> neighborIds;
+    std::vector<double> neighborDistances;
+
+    size_t N_rows = parameters.prediction.size();
+
+    for ( size_t row_i = 0; row_i < N_rows; row_i++ ) {
+        ReportProgress( "FindNeighbors", row_i, N_rows );
+
+        pred_row = parameters.prediction[ row_i ];
+        const Value *pred_vec = RowPointer( dataFrame, pred_row, row_buffer );
+
+        index.Query( pred_vec, parameters.knn, accept,
+                     neighborIds, neighborDistances );
+
+        if ( neighborIds.size() < (size_t) parameters.knn ) {
+            std::stringstream errMsg;
+            errMsg << "FindNeighbors(): Library is too small to resolve "
+                   << parameters.knn << " knn neighbors";
+            if ( parameters.exclusionRadius ) {
+                errMsg << " with exclusionRadius "
+                       << parameters.exclusionRadius;
+            }
+            errMsg << "." << std::endl;
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        for ( size_t k = 0; k < neighborIds.size(); k++ ) {
+            neighbors.neighbors( row_i, k ) = neighborIds[ k ];
+            neighbors.distances( row_i, k ) = neighborDistances[ k ];
+        }
+    }
+
+    ReportProgress( "FindNeighbors", N_rows, N_rows );
+}
+} // namespace
+
+//----------------------------------------------------------------
+// FindNeighbors of the prediction rows with an index of the library
+// rows built on the same block: the index is reused across calls.
+//----------------------------------------------------------------
+struct Neighbors FindNeighbors( const NeighborIndex     &index,
+                                const DataFrame<double> &dataFrame,
+                                const Parameters        &parameters )
+{
+    EDM_PROFILE_SCOPE( FindNeighbors );
+
+    Neighbors neighbors = Neighbors();
+    neighbors.neighbors = DataFrame<int>   ( parameters.prediction.size(),
+                                             parameters.knn );
+    neighbors.distances = DataFrame<double>( parameters.prediction.size(),
+                                             parameters.knn );
+    QueryNeighborIndex( index, dataFrame, parameters, neighbors );
+    return neighbors;
+}
+
+struct Neighbors FindNeighbors( const NeighborIndex &index,
+                                const EmbeddingView &embedding,
+                                const Parameters    &parameters )
+{
+    EDM_PROFILE_SCOPE( FindNeighbors );
+
+    Neighbors neighbors = Neighbors();
+    neighbors.neighbors = DataFrame<int>   ( parameters.prediction.size(),
+                                             parameters.knn );
+    neighbors.distances = DataFrame<double>( parameters.prediction.size(),
+                                             parameters.knn );
+    QueryNeighborIndex( index, embedding, parameters, neighbors );
+    return neighbors;
+}
+
+struct Neighbors FindNeighbors( const NeighborIndex    &index,
+                                const DataFrame<float> &dataFrame,
+                                const Parameters       &parameters )
+{
+    EDM_PROFILE_SCOPE( FindNeighbors );
+
+    Neighbors neighbors = Neighbors();
+    neighbors.neighbors = DataFrame<int>   ( parameters.prediction.size(),
+                                             parameters.knn );
+    neighbors.distances = DataFrame<double>( parameters.prediction.size(),
+                                             parameters.knn );
+    QueryNeighborIndex( index, dataFrame, parameters, neighbors );
+    return neighbors;
+}
+
+//----------------------------------------------------------------
+// NeighborIndex
+//----------------------------------------------------------------
+NeighborIndex::NeighborIndex() :
+    algorithm( NeighborAlgorithm::KDTree ), ef( 0 ), N_columns( 0 ),
+    singlePrecision( false ) {}
+
+void NeighborIndex::Build( const DataFrame<double> &dataFrame,
+                           const Parameters        &parameters ) {
+    BuildBlock( dataFrame, parameters );
+}
+
+void NeighborIndex::Build( const EmbeddingView &embedding,
+                           const Parameters    &parameters ) {
+    BuildBlock( embedding, parameters );
+}
+
+void NeighborIndex::Build( const DataFrame<float> &dataFrame,
+                           const Parameters       &parameters ) {
+    BuildBlock( dataFrame, parameters );
+}
+
+//----------------------------------------------------------------
+// Gather the library rows to index, in the value type of the block
+//----------------------------------------------------------------
+template< class Block >
+void NeighborIndex::BuildBlock( const Block      &block,
+                                const Parameters &parameters ) {
+
+    CheckRows( block, parameters.library, "library" );
+
+    typedef typename BlockValue< Block >::type Value;
+
+    size_t N_library_rows = parameters.library.size();
+
+    N_columns       = block.NColumns();
+    singlePrecision = std::is_same< Value, float >::value;
+
+    std::vector<Value>  row_buffer( N_columns );
+    std::vector<Value>  points;
+    std::vector<size_t> ids;
+    points.reserve( N_library_rows * N_columns );
+    ids.reserve   ( N_library_rows );
+
+    for ( auto lib_row : parameters.library ) {
+        if ( not parameters.library.Contains( lib_row + parameters.Tp ) and
+             not parameters.noNeighborLimit ) {
+            continue;
+        }
+        const Value *lib_vec = RowPointer( block, lib_row, row_buffer );
+        points.insert( points.end(), lib_vec, lib_vec + N_columns );
+        ids.push_back( lib_row );
+    }
+
+    trees      = Trees< double >();
+    floatTrees = Trees< float  >();
+
+    Build( points, ids, parameters, TreesOf( Value() ) );
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+void NeighborIndex::Build( const std::vector<T>      &points,
+                           const std::vector<size_t> &ids,
+                           const Parameters          &parameters,
+                           Trees< T >                &index ) {
+
+    algorithm = parameters.neighborAlgorithm;
+    ef        = parameters.hnswEf;
+
+    if ( algorithm == NeighborAlgorithm::VPTree ) {
+        index.vpTree = VPTree< T >( N_columns, parameters.metric );
+        index.vpTree.Build( points, ids );
+    }
+    else if ( algorithm == NeighborAlgorithm::HNSW ) {
+        index.hnsw = HNSW< T >( N_columns, parameters.metric,
+                                std::max( parameters.hnswM, 2 ) );
+        index.hnsw.Build( points, ids );
+    }
+    else {
+        algorithm    = NeighborAlgorithm::KDTree;
+        index.kdTree = KDTree< T >( N_columns, parameters.metric );
+        index.kdTree.Build( points, ids );
+    }
+}
+
+//----------------------------------------------------------------
+// Query the index built, point converted to its value type
+//----------------------------------------------------------------
+void NeighborIndex::Query( const double                          *point,
+                           size_t                                 knn,
+                           const std::function< bool( size_t ) > &accept,
+                           std::vector< size_t >                 &neighborIds,
+                           std::vector< double >         &neighborDistances )
+    const {
+
+    if ( singlePrecision ) {
+        std::vector< float > floatPoint( point, point + N_columns );
+        QueryTrees( floatTrees, floatPoint.data(), knn, accept,
+                    neighborIds, neighborDistances );
+    }
+    else {
+        QueryTrees( trees, point, knn, accept,
+                    neighborIds, neighborDistances );
+    }
+}
+
+void NeighborIndex::Query( const float                           *point,
+                           size_t                                 knn,
+                           const std::function< bool( size_t ) > &accept,
+                           std::vector< size_t >                 &neighborIds,
+                           std::vector< double >         &neighborDistances )
+    const {
+
+    if ( singlePrecision ) {
+        QueryTrees( floatTrees, point, knn, accept,
+                    neighborIds, neighborDistances );
+    }
+    else {
+        std::vector< double > doublePoint( point, point + N_columns );
+        QueryTrees( trees, doublePoint.data(), knn, accept,
+                    neighborIds, neighborDistances );
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+void NeighborIndex::QueryTrees( const Trees< T >                      &index,
+                                const T                               *point,
+                                size_t                                 knn,
+                                const std::function< bool( size_t ) > &accept,
+                                std::vector< size_t >          &neighborIds,
+                                std::vector< double >    &neighborDistances )
+    const {
+
+    if ( algorithm == NeighborAlgorithm::VPTree ) {
+        index.vpTree.Query( point, knn, accept,
+                            neighborIds, neighborDistances );
+    }
+    else if ( algorithm == NeighborAlgorithm::HNSW ) {
+        index.hnsw.Query( point, knn, ef, accept,
+                          neighborIds, neighborDistances );
+    }
+    else {
+        index.kdTree.Query( point, knn, accept,
+                            neighborIds, neighborDistances );
+    }
+}
+
 //----------------------------------------------------------------
 // 
 //----------------------------------------------------------------
@@ -189,24 +698,47 @@ double Distance( const std::valarray<double> &v1,
                  const std::valarray<double> &v2,
                  DistanceMetric metric )
 {
-    double distance = 0;
-
     // For efficiency sake, we forego the usual validation of v1 & v2.
+    return Distance( &v1[0], &v2[0], v1.size(), metric );
+}
+
+namespace {
+//----------------------------------------------------------------
+// Distance between N element vectors at v1 and v2, accumulated
+// in the element type
+//----------------------------------------------------------------
+template< class T >
+double MetricDistance( const T       *v1,
+                       const T       *v2,
+                       size_t         N,
+                       DistanceMetric metric )
+{
+    EDM_PROFILE_COUNT( DistanceEvaluations, 1 );
+
+    double distance = 0;
 
     if ( metric == DistanceMetric::Euclidean ) {
-        double sum = 0;
-        for ( size_t i = 0; i < v1.size(); i++ ) {
-            sum += pow( v2[i] - v1[i], 2 );
+        T sum = 0;
+        for ( size_t i = 0; i < N; i++ ) {
+            T d = v2[i] - v1[i];
+            sum += d * d;
         }
-        distance = sqrt( sum );
+        distance = sqrt( (double) sum );
     }
     else if ( metric == DistanceMetric::Manhattan ) {
-        double sum = 0;
-        for ( size_t i = 0; i < v1.size(); i++ ) {
-            sum += abs( v2[i] - v1[i] );
+        T sum = 0;
+        for ( size_t i = 0; i < N; i++ ) {
+            sum += std::abs( v2[i] - v1[i] );
         }
         distance = sum;
     }
+    else if ( metric == DistanceMetric::Chebyshev ) {
+        T maxDiff = 0;
+        for ( size_t i = 0; i < N; i++ ) {
+            maxDiff = std::max( maxDiff, std::abs( v2[i] - v1[i] ) );
+        }
+        distance = maxDiff;
+    }
     else {
         std::stringstream errMsg;
         errMsg << "Distance() Invalid DistanceMetric: "
@@ -216,6 +748,23 @@ double Distance( const std::valarray<double> &v1,
 
     return distance;
 }
+} // namespace
+
+double Distance( const double *v1,
+                 const double *v2,
+                 size_t        N,
+                 DistanceMetric metric )
+{
+    return MetricDistance( v1, v2, N, metric );
+}
+
+double Distance( const float  *v1,
+                 const float  *v2,
+                 size_t        N,
+                 DistanceMetric metric )
+{
+    return MetricDistance( v1, v2, N, metric );
+}
 
 //----------------------------------------------------------------
 // 
@@ -224,16 +773,14 @@ void PrintDataFrameIn( const DataFrame<double> &dataFrame,
                        const Parameters        &parameters )
 {
     std::cout << "FindNeighbors(): library:" << std::endl;
-    for ( size_t row = 0; row < parameters.library.size(); row++ ) {
-        int row_i = parameters.library[row];
+    for ( size_t row_i : parameters.library ) {
         std::cout << "row " << row_i << " : ";
         for ( size_t col = 0; col < dataFrame.NColumns(); col++ ) {
             std::cout << dataFrame(row_i,col) << " "; 
         } std::cout << std::endl;
     }
     std::cout << "FindNeighbors(): prediction:" << std::endl;
-    for ( size_t row = 0; row < parameters.prediction.size(); row++ ) {
-        int row_i = parameters.prediction[row];
+    for ( size_t row_i : parameters.prediction ) {
         std::cout << "row " << row_i << " : ";
         for ( size_t col = 0; col < dataFrame.NColumns(); col++ ) {
             std::cout << dataFrame(row_i,col) << " "; 
@@ -6,12 +6,23 @@
 
 #include "Common.h"
 #include "Parameter.h"
+#include "KDTree.h"
+#include "VPTree.h"
+#include "HNSW.h"
 
-struct Neighbors; // forward declaration
+struct Neighbors;     // forward declaration
+class  EmbeddingView; // Embed.h
 
 // Prototypes
-struct Neighbors FindNeighbors( DataFrame<double> dataFrame,
-                                Parameters        parameters );
+struct Neighbors FindNeighbors( const DataFrame<double> &dataFrame,
+                                const Parameters        &parameters );
+
+struct Neighbors FindNeighbors( const EmbeddingView &embedding,
+                                const Parameters    &parameters );
+
+// Single precision block, distances computed in float
+struct Neighbors FindNeighbors( const DataFrame<float> &dataFrame,
+                                const Parameters       &parameters );
 
 void PrintDataFrameIn( const DataFrame<double> &dataFrame,
                        const Parameters        &parameters );
@@ -22,6 +33,16 @@ double Distance( const std::valarray<double> &v1,
                  const std::valarray<double> &v2,
                  DistanceMetric metric );
 
+double Distance( const double *v1,
+                 const double *v2,
+                 size_t        N,
+                 DistanceMetric metric );
+
+double Distance( const float  *v1,
+                 const float  *v2,
+                 size_t        N,
+                 DistanceMetric metric );
+
 // Return structure of FindNeighbors()
 struct Neighbors {
     DataFrame<int>    neighbors;
@@ -30,4 +51,92 @@ struct Neighbors {
     ~Neighbors();
 };
 
+//---------------------------------------------------------
+// NeighborIndex class
+// KDTree, VPTree or HNSW index (parameters.neighborAlgorithm,
+// BruteForce uses a KDTree) of the library rows of a data block
+// for any number of queries. Library rows with lib_row + Tp
+// outside the library are not indexed (unless noNeighborLimit).
+// Rows of a DataFrame<float> are indexed as float: query points
+// of the other type are converted.
+// Query() is const and may be called from concurrent threads.
+//---------------------------------------------------------
+class NeighborIndex {
+
+    // Indices of rows with coordinates of type T
+    template< class T >
+    struct Trees {
+        KDTree< T > kdTree;
+        VPTree< T > vpTree;
+        HNSW< T >   hnsw;
+    };
+
+    NeighborAlgorithm algorithm;
+    int               ef;
+    size_t            N_columns;
+    bool              singlePrecision;  // floatTrees are built
+    Trees< double >   trees;
+    Trees< float  >   floatTrees;
+
+    Trees< double > &TreesOf( double ) { return trees;      }
+    Trees< float  > &TreesOf( float  ) { return floatTrees; }
+
+    template< class T >
+    void Build( const std::vector<T>      &points,
+                const std::vector<size_t> &ids,
+                const Parameters          &parameters,
+                Trees< T >                &index );
+
+    template< class Block >
+    void BuildBlock( const Block &block, const Parameters &parameters );
+
+    template< class T >
+    void QueryTrees( const Trees< T >                      &index,
+                     const T                               *point,
+                     size_t                                 knn,
+                     const std::function< bool( size_t ) > &accept,
+                     std::vector< size_t >                 &neighborIds,
+                     std::vector< double >             &neighborDistances )
+        const;
+
+public:
+    NeighborIndex();
+
+    void Build( const DataFrame<double> &dataFrame,
+                const Parameters        &parameters );
+    void Build( const EmbeddingView     &embedding,
+                const Parameters        &parameters );
+    void Build( const DataFrame<float>  &dataFrame,
+                const Parameters        &parameters );
+
+    // knn nearest indexed rows of point for which accept(lib_row)
+    // is true, sorted by increasing distance
+    void Query( const double                          *point,
+                size_t                                 knn,
+                const std::function< bool( size_t ) > &accept,
+                std::vector< size_t >                 &neighborIds,
+                std::vector< double >                 &neighborDistances )
+        const;
+    void Query( const float                           *point,
+                size_t                                 knn,
+                const std::function< bool( size_t ) > &accept,
+                std::vector< size_t >                 &neighborIds,
+                std::vector< double >                 &neighborDistances )
+        const;
+};
+
+// FindNeighbors of parameters.prediction rows with an index built
+// by NeighborIndex::Build() on the same block and library
+struct Neighbors FindNeighbors( const NeighborIndex     &index,
+                                const DataFrame<double> &dataFrame,
+                                const Parameters        &parameters );
+
+struct Neighbors FindNeighbors( const NeighborIndex &index,
+                                const EmbeddingView &embedding,
+                                const Parameters    &parameters );
+
+struct Neighbors FindNeighbors( const NeighborIndex    &index,
+                                const DataFrame<float> &dataFrame,
+                                const Parameters       &parameters );
+
 #endif
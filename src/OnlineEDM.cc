@@ -0,0 +1,274 @@
+
+#include "OnlineEDM.h"
+
+// forward declaration : SMap.cc
+void SVD( const double *A, size_t rows, size_t columns,
+          const double *B, double *C );
+
+namespace {
+    // All library rows are valid neighbors of an online query: the
+    // query row's future is unknown so it is never in the library.
+    bool AcceptAll( size_t ) { return true; }
+}
+
+//----------------------------------------------------------------
+// Constructor
+//----------------------------------------------------------------
+OnlineEDM::OnlineEDM( int    E,
+                      int    Tp,
+                      int    knn,
+                      int    tau,
+                      size_t windowSize,
+                      size_t targetIndex,
+                      bool   verbose ) :
+    E( E ), Tp( Tp ), knn( knn ), tau( tau ), windowSize( windowSize ),
+    targetIndex( targetIndex ), verbose( verbose ),
+    nColumns( 0 ), nObservations( 0 ), lastTime( NAN ), deltaTime( 1 ),
+    forecast( NAN ), forecastTime( NAN )
+{
+    if ( E < 1 or tau < 1 ) {
+        std::stringstream errMsg;
+        errMsg << "OnlineEDM(): E (" << E << ") and tau (" << tau
+               << ") must be positive.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    if ( Tp < 1 ) {
+        std::stringstream errMsg;
+        errMsg << "OnlineEDM(): Tp (" << Tp << ") must be positive.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    if ( knn < 0 ) {
+        std::stringstream errMsg;
+        errMsg << "OnlineEDM(): knn (" << knn << ") must not be negative.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+}
+
+//----------------------------------------------------------------
+// Destructor
+//----------------------------------------------------------------
+OnlineEDM::~OnlineEDM() {}
+
+//----------------------------------------------------------------
+// Append an observation and forecast Tp steps ahead
+//----------------------------------------------------------------
+double OnlineEDM::Append( double time, const std::valarray< double > &values ) {
+
+    if ( nObservations == 0 ) {
+        nColumns = values.size();
+        if ( targetIndex >= nColumns ) {
+            std::stringstream errMsg;
+            errMsg << "OnlineEDM::Append(): targetIndex " << targetIndex
+                   << " exceeds the " << nColumns << " values.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+        library = KDTree< double >( nColumns * E );
+    }
+    else {
+        if ( values.size() != nColumns ) {
+            std::stringstream errMsg;
+            errMsg << "OnlineEDM::Append(): " << values.size()
+                   << " values were provided, expected " << nColumns << ".\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+        deltaTime = time - lastTime;
+    }
+
+    lastTime = time;
+
+    size_t row = nObservations;
+    nObservations++;
+
+    history.push_back( values );
+    if ( history.size() > (size_t) ( E - 1 ) * tau + 1 ) {
+        history.pop_front();
+    }
+
+    //------------------------------------------------------------
+    // The embedding row Tp steps back now has its future target
+    //------------------------------------------------------------
+    double target = values[ targetIndex ];
+
+    while ( pending.size() and pending.front().first + Tp <= row ) {
+        if ( pending.front().first + Tp == row and not std::isnan( target ) ) {
+            size_t id = pending.front().first;
+
+            library.Insert( id, pending.front().second.data() );
+            libraryTarget[ id ] = target;
+            libraryOrder.push_back( id );
+
+            // Sliding window: evict the oldest library row
+            if ( windowSize and libraryOrder.size() > windowSize ) {
+                library.Remove( libraryOrder.front() );
+                libraryTarget.erase( libraryOrder.front() );
+                libraryOrder.pop_front();
+            }
+        }
+        pending.pop_front();
+    }
+
+    //------------------------------------------------------------
+    // Embedding row of this observation: X(t-0) X(t-1)... per column
+    //------------------------------------------------------------
+    forecast     = NAN;
+    forecastTime = time + Tp * deltaTime;
+
+    if ( history.size() < (size_t) ( E - 1 ) * tau + 1 ) {
+        return forecast;
+    }
+
+    std::vector< double > query( nColumns * E );
+    bool partial = false;
+    for ( size_t col = 0; col < nColumns; col++ ) {
+        for ( size_t e = 0; e < E; e++ ) {
+            double x = history[ history.size() - 1 - e * tau ][ col ];
+            query[ col * E + e ] = x;
+            if ( std::isnan( x ) ) { partial = true; }
+        }
+    }
+
+    if ( partial ) {
+        if ( verbose ) {
+            std::stringstream msg;
+            msg << "OnlineEDM::Append(): Ignoring nan in row " << row
+                << std::endl;
+            Message( msg.str() );
+        }
+        return forecast;
+    }
+
+    forecast = Project( query );
+
+    pending.push_back( std::make_pair( row, query ) );
+
+    return forecast;
+}
+
+//----------------------------------------------------------------
+// OnlineSimplex Constructor
+//----------------------------------------------------------------
+OnlineSimplex::OnlineSimplex( int    E,
+                              int    Tp,
+                              int    knn,
+                              int    tau,
+                              size_t windowSize,
+                              size_t targetIndex,
+                              bool   verbose ) :
+    OnlineEDM( E, Tp, knn, tau, windowSize, targetIndex, verbose )
+{
+    if ( this->knn < 1 ) {
+        this->knn = E + 1;
+    }
+}
+
+//----------------------------------------------------------------
+// Simplex projection of query from its knn library neighbors
+//----------------------------------------------------------------
+double OnlineSimplex::Project( const std::vector< double > &query ) {
+
+    if ( library.Size() < (size_t) knn ) {
+        return NAN;
+    }
+
+    library.Query( query.data(), knn, AcceptAll,
+                   neighborIds, neighborDistances );
+
+    // neighborDistances are sorted: the first is the distance scale
+    double minWeight   = 1.E-6;
+    double minDistance = neighborDistances[ 0 ];
+    double sumWeights  = 0;
+    double sumTargets  = 0;
+
+    for ( size_t k = 0; k < neighborIds.size(); k++ ) {
+        double weight;
+        if ( minDistance == 0 ) {
+            // Zero distance neighbors get full weight
+            weight = neighborDistances[ k ] > 0 ? minWeight : 1;
+        }
+        else {
+            weight = exp( -neighborDistances[ k ] / minDistance );
+        }
+        weight = std::max( weight, minWeight );
+
+        sumWeights += weight;
+        sumTargets += weight * libraryTarget[ neighborIds[ k ] ];
+    }
+
+    return sumTargets / sumWeights;
+}
+
+//----------------------------------------------------------------
+// OnlineSMap Constructor
+//----------------------------------------------------------------
+OnlineSMap::OnlineSMap( int    E,
+                        int    Tp,
+                        int    knn,
+                        int    tau,
+                        double theta,
+                        size_t windowSize,
+                        size_t targetIndex,
+                        bool   verbose ) :
+    OnlineEDM( E, Tp, knn, tau, windowSize, targetIndex, verbose ),
+    theta( theta )
+{
+    if ( knn > 0 and knn < E + 1 ) {
+        std::stringstream errMsg;
+        errMsg << "OnlineSMap(): knn must be at least E+1 = " << E + 1
+               << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+}
+
+//----------------------------------------------------------------
+// S-Map projection of query from its knn library neighbors
+//----------------------------------------------------------------
+double OnlineSMap::Project( const std::vector< double > &query ) {
+
+    size_t N_dim = query.size();
+    size_t N_nn  = knn > 0 ? knn : library.Size();
+
+    if ( library.Size() < N_nn or N_nn < N_dim + 1 ) {
+        return NAN;
+    }
+
+    library.Query( query.data(), N_nn, AcceptAll,
+                   neighborIds, neighborDistances );
+
+    double D_avg = 0;
+    for ( auto d : neighborDistances ) { D_avg += d; }
+    D_avg = D_avg / N_nn;
+
+    // A and B are call scoped on the thread arena, A 64 byte aligned
+    size_t     N_columns = N_dim + 1;
+    ArenaScope scope;
+    double    *A = static_cast< double * >(
+        scope.Get().Allocate( N_nn * N_columns * sizeof( double ), 64 ) );
+    ArenaVector< double > B( N_nn );
+
+    for ( size_t k = 0; k < N_nn; k++ ) {
+        double w = 1;
+        if ( theta > 0 and D_avg > 0 ) {
+            w = exp( ( -theta / D_avg ) * neighborDistances[ k ] );
+        }
+
+        const double *libRow = library.Point( neighborIds[ k ] );
+        double       *A_k    = A + k * N_columns;
+
+        A_k[ 0 ] = w;
+        for ( size_t j = 0; j < N_dim; j++ ) {
+            A_k[ j + 1 ] = w * libRow[ j ];
+        }
+        B[ k ] = w * libraryTarget[ neighborIds[ k ] ];
+    }
+
+    coefficients.resize( N_columns );
+    SVD( A, N_nn, N_columns, B.data(), &coefficients[ 0 ] );
+
+    // Prediction is local linear projection, C[ 0 ] is the bias term
+    double prediction = coefficients[ 0 ];
+    for ( size_t j = 0; j < N_dim; j++ ) {
+        prediction = prediction + coefficients[ j + 1 ] * query[ j ];
+    }
+
+    return prediction;
+}
@@ -0,0 +1,127 @@
+#ifndef ONLINEEDM_H
+#define ONLINEEDM_H
+
+#include <deque>
+#include <unordered_map>
+
+#include "Common.h"
+#include "KDTree.h"
+
+//---------------------------------------------------------
+// OnlineEDM class
+// Stateful forecaster for streaming data. Observations are
+// presented one at a time with Append(). Each observation extends
+// the time-delay embedding by one row. The embedding row Tp steps
+// in the past then has a known future and is inserted into a
+// dynamic KDTree library. The new embedding row is projected to
+// time + Tp from its knn library neighbors.
+//
+// If windowSize > 0 the library is a sliding window of at most
+// windowSize rows, the oldest rows are evicted.
+//
+// Derived classes implement the projection: OnlineSimplex, OnlineSMap.
+//---------------------------------------------------------
+class OnlineEDM {
+
+protected:
+    int    E;             // embedding dimension
+    int    Tp;            // prediction interval
+    int    knn;           // k nearest neighbors, 0 = all library rows
+    int    tau;           // embedding delay
+    size_t windowSize;    // maximum library rows, 0 = unbounded
+    size_t targetIndex;   // index of target in Append() values
+    bool   verbose;
+
+    size_t nColumns;      // number of values per observation
+    size_t nObservations; // number of Append() calls
+
+    // Last (E-1)*tau + 1 observations for the embedding
+    std::deque< std::valarray< double > > history;
+    double lastTime;
+    double deltaTime;
+
+    // Embedding rows awaiting their Tp-step future target
+    std::deque< std::pair< size_t, std::vector< double > > > pending;
+
+    // Library: embedding rows in KDTree, targets by row id
+    KDTree< double >                    library;
+    std::unordered_map< size_t, double > libraryTarget;
+    std::deque< size_t >                libraryOrder;
+
+    double forecast;      // Last forecast
+    double forecastTime;  // Time of last forecast
+
+    // Neighbor buffers reused between Append() calls
+    std::vector< size_t > neighborIds;
+    std::vector< double > neighborDistances;
+
+    virtual double Project( const std::vector< double > &query ) = 0;
+
+public:
+    OnlineEDM( int    E,
+               int    Tp          = 1,
+               int    knn         = 0,
+               int    tau         = 1,
+               size_t windowSize  = 0,
+               size_t targetIndex = 0,
+               bool   verbose     = false );
+
+    virtual ~OnlineEDM();
+
+    // Add observation values at time, return forecast at time + Tp.
+    // Returns NAN until the library holds at least knn rows.
+    double Append( double time, const std::valarray< double > &values );
+
+    // Accessors
+    double Forecast()      const { return forecast;      }
+    double ForecastTime()  const { return forecastTime;  }
+    size_t LibrarySize()   const { return library.Size(); }
+    size_t NObservations() const { return nObservations; }
+};
+
+//---------------------------------------------------------
+// Simplex projection: exponentially weighted average of the
+// knn library neighbor targets. knn = 0 defaults to E + 1.
+//---------------------------------------------------------
+class OnlineSimplex : public OnlineEDM {
+
+protected:
+    double Project( const std::vector< double > &query );
+
+public:
+    OnlineSimplex( int    E,
+                   int    Tp          = 1,
+                   int    knn         = 0,
+                   int    tau         = 1,
+                   size_t windowSize  = 0,
+                   size_t targetIndex = 0,
+                   bool   verbose     = false );
+};
+
+//---------------------------------------------------------
+// S-Map projection: locally weighted linear map fit by SVD over
+// the knn library neighbors. knn = 0 uses all library rows,
+// which is linear in the library size.
+//---------------------------------------------------------
+class OnlineSMap : public OnlineEDM {
+
+protected:
+    double                  theta;
+    std::valarray< double > coefficients; // last S-Map coefficients
+
+    double Project( const std::vector< double > &query );
+
+public:
+    OnlineSMap( int    E,
+                int    Tp          = 1,
+                int    knn         = 0,
+                int    tau         = 1,
+                double theta       = 0,
+                size_t windowSize  = 0,
+                size_t targetIndex = 0,
+                bool   verbose     = false );
+
+    std::valarray< double > Coefficients() const { return coefficients; }
+};
+
+#endif
@@ -39,7 +39,15 @@ Parameters::Parameters(
     bool        random,
     int         rseed,
     bool        noNeigh,
-    bool        fwdTau
+    bool        fwdTau,
+    std::string neighborCache,
+    bool        lagged,
+    NeighborAlgorithm algorithm,
+    int         ef,
+    int         M,
+    DistanceMetric distance,
+    int         exclusion,
+    bool        single
     ) :
     // default variable initialization from parameter arguments
     method           ( method ),
@@ -77,6 +85,14 @@ Parameters::Parameters(
     seed             ( rseed ),
     noNeighborLimit  ( noNeigh ),
     forwardTau       ( fwdTau ),
+    exclusionRadius  ( exclusion ),
+    neighborCachePath( neighborCache ),
+    laggedView       ( lagged ),
+    neighborAlgorithm( algorithm ),
+    metric           ( distance ),
+    hnswM            ( M ),
+    hnswEf           ( ef ),
+    singlePrecision  ( single ),
     validated        ( false )
 {
     if ( method != Method::None ) {
@@ -89,10 +105,226 @@ Parameters::Parameters(
 //----------------------------------------------------------------
 Parameters::~Parameters() {}
 
+namespace {
+    //------------------------------------------------------------
+    // Numeric argument values, the whole string must convert
+    //------------------------------------------------------------
+    void InvalidNumber( const std::string &value ) {
+        std::stringstream errMsg;
+        errMsg << "Parameters::Load(): invalid number " << value << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    int ToInt( const std::string &value ) {
+        size_t end    = 0;
+        int    number = 0;
+        try { number = std::stoi( value, &end ); }
+        catch ( const std::logic_error & ) { InvalidNumber( value ); }
+        if ( end != value.size() ) { InvalidNumber( value ); }
+        return number;
+    }
+
+    float ToFloat( const std::string &value ) {
+        size_t end    = 0;
+        float  number = 0;
+        try { number = std::stof( value, &end ); }
+        catch ( const std::logic_error & ) { InvalidNumber( value ); }
+        if ( end != value.size() ) { InvalidNumber( value ); }
+        return number;
+    }
+}
+
 //----------------------------------------------------------------
-// 
+// Populate the parameters from arguments: -flag value, or -flag
+// alone for the bool switches. Flags have a short and long form.
 //----------------------------------------------------------------
-void Parameters::Load() {}
+void Parameters::Load( const std::vector< std::string > &args ) {
+
+    for ( size_t i = 0; i < args.size(); i++ ) {
+        const std::string &flag = args[ i ];
+
+        // bool switches take no value
+        if      ( flag == "-e" or flag == "--embedded" ) {
+            embedded = true;   continue;
+        }
+        else if ( flag == "-v" or flag == "--verbose" ) {
+            verbose = true;    continue;
+        }
+        else if ( flag == "-nn" or flag == "--noNeighborLimit" ) {
+            noNeighborLimit = true; continue;
+        }
+        else if ( flag == "-fw" or flag == "--forwardTau" ) {
+            forwardTau = true; continue;
+        }
+        else if ( flag == "-lv" or flag == "--laggedView" ) {
+            laggedView = true; continue;
+        }
+        else if ( flag == "-sp" or flag == "--singlePrecision" ) {
+            singlePrecision = true; continue;
+        }
+
+        if ( i + 1 >= args.size() ) {
+            std::stringstream errMsg;
+            errMsg << "Parameters::Load(): " << flag << " requires a value.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+        const std::string &value = args[ ++i ];
+        std::string        lower = ToLower( value );
+
+        if ( flag == "-m" or flag == "--method" ) {
+            if      ( lower == "simplex" ) { method = Method::Simplex; }
+            else if ( lower == "smap"    ) { method = Method::SMap;    }
+            else if ( lower == "embed"   ) { method = Method::Embed;   }
+            else {
+                std::stringstream errMsg;
+                errMsg << "Parameters::Load(): invalid method " << value
+                       << ".\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+        }
+        else if ( flag == "-pa" or flag == "--path"      ) { pathIn   = value; }
+        else if ( flag == "-i"  or flag == "--inputFile" ) { dataFile = value; }
+        else if ( flag == "-po" or flag == "--pathOut"   ) { pathOut  = value; }
+        else if ( flag == "-o"  or flag == "--outputFile" ) {
+            predictOutputFile = value;
+        }
+        else if ( flag == "-os" or flag == "--outputSmapFile" ) {
+            SmapOutputFile = value;
+        }
+        else if ( flag == "-ob" or flag == "--outputBlockFile" ) {
+            blockOutputFile = value;
+        }
+        else if ( flag == "-l" or flag == "--library"    ) { lib_str  = value; }
+        else if ( flag == "-p" or flag == "--prediction" ) { pred_str = value; }
+        else if ( flag == "-c" or flag == "--columns"    ) {
+            columns_str = value;
+        }
+        else if ( flag == "-r" or flag == "--target"     ) {
+            target_str = value;
+        }
+        else if ( flag == "-j" or flag == "--jacobians"  ) {
+            jacobian_str = value;
+        }
+        else if ( flag == "-E" or flag == "--E"   ) { E   = ToInt( value ); }
+        else if ( flag == "-T" or flag == "--Tp"  ) { Tp  = ToInt( value ); }
+        else if ( flag == "-k" or flag == "--knn" ) { knn = ToInt( value ); }
+        else if ( flag == "-t" or flag == "--tau" ) { tau = ToInt( value ); }
+        else if ( flag == "-th" or flag == "--theta" ) {
+            theta = ToFloat( value );
+        }
+        else if ( flag == "-svd" or flag == "--SVDSignificance" ) {
+            SVDSignificance = ToFloat( value );
+        }
+        else if ( flag == "-tr" or flag == "--TikhonovAlpha" ) {
+            TikhonovAlpha = ToFloat( value );
+        }
+        else if ( flag == "-en" or flag == "--ElasticNetAlpha" ) {
+            ElasticNetAlpha = ToFloat( value );
+        }
+        else if ( flag == "-x" or flag == "--exclusionRadius" ) {
+            exclusionRadius = ToInt( value );
+        }
+        else if ( flag == "-nc" or flag == "--neighborCache" ) {
+            neighborCachePath = value;
+        }
+        else if ( flag == "-a" or flag == "--algorithm" ) {
+            if      ( lower == "bruteforce" ) {
+                neighborAlgorithm = NeighborAlgorithm::BruteForce;
+            }
+            else if ( lower == "kdtree" ) {
+                neighborAlgorithm = NeighborAlgorithm::KDTree;
+            }
+            else if ( lower == "vptree" ) {
+                neighborAlgorithm = NeighborAlgorithm::VPTree;
+            }
+            else if ( lower == "hnsw" ) {
+                neighborAlgorithm = NeighborAlgorithm::HNSW;
+            }
+            else {
+                std::stringstream errMsg;
+                errMsg << "Parameters::Load(): invalid algorithm " << value
+                       << ".\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+        }
+        else if ( flag == "-d" or flag == "--metric" ) {
+            if      ( lower == "euclidean" ) {
+                metric = DistanceMetric::Euclidean;
+            }
+            else if ( lower == "manhattan" ) {
+                metric = DistanceMetric::Manhattan;
+            }
+            else if ( lower == "chebyshev" ) {
+                metric = DistanceMetric::Chebyshev;
+            }
+            else {
+                std::stringstream errMsg;
+                errMsg << "Parameters::Load(): invalid metric " << value
+                       << ".\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+        }
+        else if ( flag == "-M"  or flag == "--hnswM"  ) {
+            hnswM  = ToInt( value );
+        }
+        else if ( flag == "-ef" or flag == "--hnswEf" ) {
+            hnswEf = ToInt( value );
+        }
+        else {
+            std::stringstream errMsg;
+            errMsg << "Parameters::Load(): unknown argument " << flag << ".\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// Validated parameters of arguments with the defaults of Simplex():
+// paths "./", Tp = 1. defaults are loaded first, then args.
+//----------------------------------------------------------------
+Parameters Parameters::FromArgs( const std::vector< std::string > &args,
+                                 const std::vector< std::string > &defaults ) {
+
+    Parameters param( Method::None, "./", "", "./", "", "", "", 0, 1 );
+    param.Load( defaults );
+    param.Load( args );
+    param.Validate();
+
+    return param;
+}
+
+//----------------------------------------------------------------
+// Ranges "start end [start end ...]" of 1-offset row numbers to
+// an IntervalSet of zero-offset row indices
+//----------------------------------------------------------------
+namespace {
+    IntervalSet ParseRanges( const std::string &ranges_str,
+                             const std::string &name ) {
+
+        std::vector<std::string> range_vec = SplitString( ranges_str, " \t," );
+
+        if ( range_vec.empty() or range_vec.size() % 2 ) {
+            std::stringstream errMsg;
+            errMsg << "Parameters(): " << name << " must be pairs of "
+                   << "integers: start end [start end ...].\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+
+        IntervalSet ranges;
+        for ( size_t i = 0; i < range_vec.size(); i += 2 ) {
+            int start = std::stoi( range_vec[ i ]     );
+            int end   = std::stoi( range_vec[ i + 1 ] );
+            if ( start < 1 or end < start ) {
+                std::stringstream errMsg;
+                errMsg << "Parameters(): " << name << " range " << start
+                       << " " << end << " is invalid.\n";
+                throw std::runtime_error( errMsg.str() );
+            }
+            ranges.Add( start - 1, end - 1 );
+        }
+        return ranges;
+    }
+}
 
 //----------------------------------------------------------------
 // Index offsets, generate library and prediction indices,
@@ -106,33 +338,14 @@ void Parameters::Validate() {
     // Generate library indices: Apply zero-offset
     //--------------------------------------------------------------
     if ( lib_str.size() ) {
-        std::vector<std::string> lib_vec = SplitString( lib_str, " \t," );
-        if ( lib_vec.size() != 2 ) {
-            std::string errMsg("Parameters(): library must be two integers.\n");
-            throw std::runtime_error( errMsg );
-        }
-        int lib_start = std::stoi( lib_vec[0] );
-        int lib_end   = std::stoi( lib_vec[1] );
-        
-        library = std::vector<size_t>( lib_end - lib_start + 1 );
-        std::iota ( library.begin(), library.end(), lib_start - 1 );
+        library = ParseRanges( lib_str, "library" );
     }
 
     //--------------------------------------------------------------
     // Generate prediction indices: Apply zero-offset
     //--------------------------------------------------------------
     if ( pred_str.size() ) {
-        std::vector<std::string> pred_vec = SplitString( pred_str, " \t," );
-        if ( pred_vec.size() != 2 ) {
-            std::string errMsg("Parameters(): prediction must be two "
-                               "integers.\n");
-            throw std::runtime_error( errMsg );
-        }
-        int pred_start = std::stoi( pred_vec[0] );
-        int pred_end   = std::stoi( pred_vec[1] );
-        
-        prediction = std::vector<size_t>( pred_end - pred_start + 1 );
-        std::iota ( prediction.begin(), prediction.end(), pred_start - 1 );
+        prediction = ParseRanges( pred_str, "prediction" );
     }
     
 #ifdef DEBUG_ALL
@@ -168,14 +381,28 @@ void Parameters::Validate() {
         }
     }
     
-    // target
+    // target : one or more column names or indices
+    // targetName or targetIndex is the first target
     if ( target_str.size() ) {
-        bool onlyDigits = OnlyDigits( target_str );
+        std::vector<std::string> target_vec = SplitString( target_str,
+                                                           " \t,\n" );
+        bool onlyDigits = true;
+        for ( auto ti = target_vec.begin(); ti != target_vec.end(); ++ti ) {
+            if ( not OnlyDigits( *ti ) ) { onlyDigits = false; }
+        }
+
+        targetNames.clear();
+        targetIndices.clear();
+        
         if ( onlyDigits ) {
-            targetIndex = std::stoi( target_str );
+            for ( auto ti = target_vec.begin(); ti != target_vec.end(); ++ti ) {
+                targetIndices.push_back( std::stoi( *ti ) );
+            }
+            targetIndex = targetIndices[ 0 ];
         }
         else {
-            targetName = target_str;
+            targetNames = target_vec;
+            targetName  = targetNames[ 0 ];
         }
     }
     
@@ -206,16 +433,43 @@ void Parameters::Validate() {
         }
     }
 
+    //--------------------------------------------------------------------
+    if ( exclusionRadius < 0 ) {
+        std::stringstream errMsg;
+        errMsg << "Parameters::Validate(): exclusionRadius of "
+               << exclusionRadius << " must be non-negative.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    //--------------------------------------------------------------------
+    // HNSW approximate neighbors
+    if ( neighborAlgorithm == NeighborAlgorithm::HNSW ) {
+        if ( hnswM < 2 ) {
+            std::stringstream errMsg;
+            errMsg << "Parameters::Validate(): HNSW M of " << hnswM
+                   << " must be at least 2.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+        if ( hnswEf < 1 ) {
+            std::stringstream errMsg;
+            errMsg << "Parameters::Validate(): HNSW ef of " << hnswEf
+                   << " must be at least 1.\n";
+            throw std::runtime_error( errMsg.str() );
+        }
+    }
+
     //--------------------------------------------------------------------
     // If Simplex and knn not specified, knn set to E+1
     // If S-Map require knn > E + 1, default is all neighbors.
     if ( method == Method::Simplex ) {
         if ( knn < 1 ) {
             knn = E + 1;
-            std::stringstream msg;
-            msg << "Parameters::Validate(): Set knn = " << knn
-                << " (E+1) for Simplex. " << std::endl;
-            std::cout << msg.str();
+            if ( verbose ) {
+                std::stringstream msg;
+                msg << "Parameters::Validate(): Set knn = " << knn
+                    << " (E+1) for Simplex. " << std::endl;
+                Message( msg.str() );
+            }
         }
         if ( knn < E + 1 ) {
             std::stringstream errMsg;
@@ -236,17 +490,19 @@ void Parameters::Validate() {
         else {
             // knn = 0
             knn = prediction.size() - Tp;
-            std::stringstream msg;
-            msg << "Parameters::Validate(): Set knn = " << knn
-                << " for SMap. " << std::endl;
-            std::cout << msg.str();
+            if ( verbose ) {
+                std::stringstream msg;
+                msg << "Parameters::Validate(): Set knn = " << knn
+                    << " for SMap. " << std::endl;
+                Message( msg.str() );
+            }
         }
-        if ( not embedded and columnNames.size() > 1 ) {
+        if ( verbose and not embedded and columnNames.size() > 1 ) {
             std::string msg( "Parameters::Validate() WARNING:  "
                              "Multivariable S-Map should use "
                              "-e (embedded) data input to ensure "
                              "data/dimension correspondance.\n" );
-            std::cout << msg;
+            Message( msg );
         }
 
         // S-Map coefficient columns for jacobians start at 1 since the 0th
@@ -276,13 +532,17 @@ void Parameters::Validate() {
 
         // Very small alphas don't make sense in elastic net
         if ( ElasticNetAlpha < 0.01 ) {
-            std::cout << "Parameters::Validate() ElasticNetAlpha too small."
-                         " Setting to 0.01.";
+            if ( verbose ) {
+                Message( "Parameters::Validate() ElasticNetAlpha too small."
+                         " Setting to 0.01." );
+            }
             ElasticNetAlpha = 0.01;
         }
         if ( ElasticNetAlpha > 1 ) {
-            std::cout << "Parameters::Validate() ElasticNetAlpha too large."
-                         " Setting to 1.";
+            if ( verbose ) {
+                Message( "Parameters::Validate() ElasticNetAlpha too large."
+                         " Setting to 1." );
+            }
             ElasticNetAlpha = 1;
         }
     }
@@ -310,6 +570,32 @@ std::ostream& operator<< ( std::ostream &os, Parameters &p ) {
        << " knn=" << p.knn << " tau=" << p.tau << " theta=" << p.theta
        << std::endl;
 
+    if ( p.neighborAlgorithm == NeighborAlgorithm::KDTree ) {
+        os << "Neighbors: KDTree" << std::endl;
+    }
+    else if ( p.neighborAlgorithm == NeighborAlgorithm::VPTree ) {
+        os << "Neighbors: VPTree" << std::endl;
+    }
+    else if ( p.neighborAlgorithm == NeighborAlgorithm::HNSW ) {
+        os << "Neighbors: HNSW M=" << p.hnswM << " ef=" << p.hnswEf
+           << std::endl;
+    }
+
+    if ( p.exclusionRadius ) {
+        os << "Exclusion radius: " << p.exclusionRadius << std::endl;
+    }
+
+    if ( p.singlePrecision ) {
+        os << "Neighbors: single precision" << std::endl;
+    }
+
+    if ( p.metric == DistanceMetric::Manhattan ) {
+        os << "Distance: Manhattan" << std::endl;
+    }
+    else if ( p.metric == DistanceMetric::Chebyshev ) {
+        os << "Distance: Chebyshev" << std::endl;
+    }
+
     if ( p.columnNames.size() ) {
         os << "Column Names : [ ";
         for ( auto ci = p.columnNames.begin();
@@ -318,15 +604,16 @@ std::ostream& operator<< ( std::ostream &os, Parameters &p ) {
         } os << "]" << std::endl;
     }
 
-    if ( p.targetName.size() ) {
-        os << "Target: " << p.targetName << std::endl;
+    if ( p.targetNames.size() ) {
+        os << "Target: [ ";
+        for ( auto ti = p.targetNames.begin();
+              ti != p.targetNames.end(); ++ti ) {
+            os << *ti << " ";
+        } os << "]" << std::endl;
     }
 
-    os << "Library: [" << p.library[0] << " : "
-       << p.library[ p.library.size() - 1 ] << "]  "
-       << "Prediction: [" << p.prediction[0] << " : "
-       << p.prediction[ p.prediction.size() - 1 ]
-       << "] " << std::endl;
+    os << "Library: " << p.library << "  "
+       << "Prediction: " << p.prediction << " " << std::endl;
 
     
     os << "-------------------------------------------------------\n";
@@ -338,8 +625,8 @@ std::ostream& operator<< ( std::ostream &os, Parameters &p ) {
 //------------------------------------------------------------------
 // 
 //------------------------------------------------------------------
-void Parameters::PrintIndices( std::vector<size_t> library,
-                               std::vector<size_t> prediction )
+void Parameters::PrintIndices( const IntervalSet &library,
+                               const IntervalSet &prediction )
 {
     std::cout << "Parameters(): library: ";
     for ( auto li = library.begin(); li != library.end(); ++li ) {
@@ -5,6 +5,7 @@
 #include <numeric>
 
 #include "Common.h"
+#include "IntervalSet.h"
 
 //------------------------------------------------------------
 //
@@ -13,8 +14,8 @@ class Parameters {
 
 public:  // JP Should be protected with accessors...
     Method      method;             // Simplex or SMap enum class
-    std::vector<size_t> library;    // library row indices
-    std::vector<size_t> prediction; // prediction row indices
+    IntervalSet library;            // library row indices
+    IntervalSet prediction;         // prediction row indices
     int         E;                  // dimension
     int         Tp;                 // prediction interval
     int         knn;                // k nearest neighbors
@@ -32,6 +33,9 @@ public:  // JP Should be protected with accessors...
     std::string targetName;       // target column name
     size_t      targetIndex;      // target column index
 
+    std::vector<std::string> targetNames;   // multiple target column names
+    std::vector<size_t>      targetIndices; // multiple target column indices
+
     bool        embedded;         // true if data is already embedded/block
     
     int         MultiviewEnsemble;// Number of ensembles in multiview
@@ -43,6 +47,23 @@ public:  // JP Should be protected with accessors...
     
     bool        noNeighborLimit;  // Strictly forbid neighbors outside library
     bool        forwardTau;       // Embed/block with t+tau instead t-tau
+    int         exclusionRadius;  // Theiler window: ignore |lib-pred| <= r
+
+    std::string neighborCachePath;// FindNeighbors() cache directory, "" off
+    bool        laggedView;       // Lazy embedding: EmbeddingView, no block
+
+    NeighborAlgorithm neighborAlgorithm; // FindNeighbors() search method
+    DistanceMetric    metric;            // FindNeighbors() distance
+    int         hnswM;            // HNSW graph links per node
+    int         hnswEf;           // HNSW search width: recall vs speed
+    // singlePrecision: the embedding is made as a float block and
+    // distances are computed in float. Brute force FindNeighbors() is
+    // 2-3x faster than double (Bench BruteForceFloat), index trees
+    // hold half the memory. Values round to float (~1E-7 relative),
+    // S-Map regresses on the float values. On the bundled data Simplex
+    // is unchanged, LorenzData1000 S-Map E=3 theta=3 rho 0.996420 ->
+    // 0.996428, MAE 0.300158 -> 0.300230.
+    bool        singlePrecision;  // FindNeighbors() on a float block
 
     bool        verbose;
     bool        validated;
@@ -98,15 +119,32 @@ public:  // JP Should be protected with accessors...
         bool        random       = true,
         int         seed         = -1,
         bool        noNeighbor   = false,
-        bool        forwardTau   = false
+        bool        forwardTau   = false,
+        std::string neighborCache= "",
+        bool        laggedView   = false,
+        NeighborAlgorithm algorithm = NeighborAlgorithm::BruteForce,
+        int         ef           = 64,
+        int         hnswM        = 16,
+        DistanceMetric metric    = DistanceMetric::Euclidean,
+        int         exclusion    = 0,
+        bool        single       = false
         );
     
     ~Parameters();
 
     void Validate(); // Parameter validation and index offsets
-    void Load();     // Populate the parameters from arguments
-    void PrintIndices( std::vector<size_t> library,
-                       std::vector<size_t> prediction );
+    // Populate the parameters from command line style arguments,
+    // e.g. { "-m", "simplex", "-l", "1 100", "-E", "3" }. Arguments
+    // not given keep their value: Load() can be applied in layers.
+    // Validate() is not called.
+    void Load( const std::vector< std::string > &args );
+    // Load() of defaults then args onto the defaults of Simplex(),
+    // and Validate()
+    static Parameters FromArgs(
+        const std::vector< std::string > &args,
+        const std::vector< std::string > &defaults = {} );
+    void PrintIndices( const IntervalSet &library,
+                       const IntervalSet &prediction );
 };
 
 #endif
@@ -0,0 +1,209 @@
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Profile.h"
+
+thread_local uint64_t ProfileThreadCounters[ N_ProfileCounters ] = {};
+
+namespace {
+    // Process totals, time in nanoseconds
+    std::atomic< uint64_t > stageNanoseconds[ N_ProfileStages ];
+    std::atomic< uint64_t > stageCalls      [ N_ProfileStages ];
+    std::atomic< uint64_t > counterTotals   [ N_ProfileCounters ];
+
+    // Recorder of the calling thread
+    thread_local ProfileSink *currentSink = nullptr;
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+const char *ProfileStageName( ProfileStage stage ) {
+    switch ( stage ) {
+    case ProfileStage::ReadData       : return "ReadData";
+    case ProfileStage::SetupDataFrame : return "SetupDataFrame";
+    case ProfileStage::MakeBlock      : return "MakeBlock";
+    case ProfileStage::FindNeighbors  : return "FindNeighbors";
+    case ProfileStage::Projection     : return "Projection";
+    case ProfileStage::SVD            : return "SVD";
+    case ProfileStage::WriteData      : return "WriteData";
+    default                           : return "Unknown";
+    }
+}
+
+const char *ProfileCounterName( ProfileCounter counter ) {
+    switch ( counter ) {
+    case ProfileCounter::DistanceEvaluations : return "DistanceEvaluations";
+    case ProfileCounter::DataFrameConstructions :
+        return "DataFrameConstructions";
+    case ProfileCounter::CandidatesPruned    : return "CandidatesPruned";
+    case ProfileCounter::SVDCalls            : return "SVDCalls";
+    case ProfileCounter::ArenaAllocations    : return "ArenaAllocations";
+    default                                  : return "Unknown";
+    }
+}
+
+//----------------------------------------------------------------
+// Instrumentation
+//----------------------------------------------------------------
+void ProfileAddTime( ProfileStage stage, double seconds ) {
+    size_t   i           = (size_t) stage;
+    uint64_t nanoseconds = (uint64_t) ( seconds * 1E9 );
+
+    stageNanoseconds[ i ].fetch_add( nanoseconds, std::memory_order_relaxed );
+    stageCalls[ i ].fetch_add( 1, std::memory_order_relaxed );
+
+    for ( ProfileSink *sink = currentSink; sink; sink = sink->parent ) {
+        sink->nanoseconds[ i ].fetch_add( nanoseconds,
+                                          std::memory_order_relaxed );
+        sink->calls[ i ].fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+void ProfileFlushCounters() {
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        uint64_t N = ProfileThreadCounters[ i ];
+        if ( N ) {
+            counterTotals[ i ].fetch_add( N, std::memory_order_relaxed );
+            for ( ProfileSink *sink = currentSink; sink; sink = sink->parent ) {
+                sink->counters[ i ].fetch_add( N, std::memory_order_relaxed );
+            }
+            ProfileThreadCounters[ i ] = 0;
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// Process totals
+//----------------------------------------------------------------
+ProfileStats ProfileSnapshot() {
+
+    ProfileFlushCounters();
+
+    ProfileStats stats;
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        stats.seconds[ i ] = stageNanoseconds[ i ].load() * 1E-9;
+        stats.calls  [ i ] = stageCalls[ i ].load();
+    }
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        stats.counters[ i ] = counterTotals[ i ].load();
+    }
+    return stats;
+}
+
+void ProfileReset() {
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        ProfileThreadCounters[ i ] = 0;
+        counterTotals[ i ]         = 0;
+    }
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        stageNanoseconds[ i ] = 0;
+        stageCalls[ i ]       = 0;
+    }
+}
+
+void WriteProfileJSON( const std::string &fileName ) {
+    std::ofstream jsonStrm( fileName );
+    if ( not jsonStrm.is_open() ) {
+        std::stringstream errMsg;
+        errMsg << "WriteProfileJSON(): file " << fileName
+               << " is not open for writing.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    jsonStrm << ProfileSnapshot().JSON() << std::endl;
+}
+
+//----------------------------------------------------------------
+// Recorders
+//----------------------------------------------------------------
+ProfileSink::ProfileSink( ProfileSink *parent ) : parent( parent ) {
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        nanoseconds[ i ] = 0;
+        calls      [ i ] = 0;
+    }
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        counters[ i ] = 0;
+    }
+}
+
+ProfileStats ProfileSink::Stats() const {
+    ProfileStats stats;
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        stats.seconds[ i ] = nanoseconds[ i ].load() * 1E-9;
+        stats.calls  [ i ] = calls[ i ].load();
+    }
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        stats.counters[ i ] = counters[ i ].load();
+    }
+    return stats;
+}
+
+ProfileSink *ProfileCurrentSink() { return currentSink; }
+
+// Counters of the thread so far belong to the previous sink
+ProfileSinkScope::ProfileSinkScope( ProfileSink *sink ) :
+    previous( currentSink ) {
+    ProfileFlushCounters();
+    currentSink = sink;
+}
+
+ProfileSinkScope::~ProfileSinkScope() {
+    ProfileFlushCounters();
+    currentSink = previous;
+}
+
+ProfileRecorder::ProfileRecorder() :
+    sink( currentSink ), scope( &sink ) {}
+
+// Only the counters of the calling thread are flushed: the tasks of
+// other threads flushed theirs when they ended
+ProfileStats ProfileRecorder::Stats() const {
+    ProfileFlushCounters();
+    return sink.Stats();
+}
+
+//----------------------------------------------------------------
+// ProfileStats
+//----------------------------------------------------------------
+ProfileStats::ProfileStats() {
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        seconds[ i ] = 0;
+        calls  [ i ] = 0;
+    }
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        counters[ i ] = 0;
+    }
+}
+
+ProfileStats ProfileStats::operator-( const ProfileStats &before ) const {
+    ProfileStats delta;
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        delta.seconds[ i ] = seconds[ i ] - before.seconds[ i ];
+        delta.calls  [ i ] = calls  [ i ] - before.calls  [ i ];
+    }
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        delta.counters[ i ] = counters[ i ] - before.counters[ i ];
+    }
+    return delta;
+}
+
+std::string ProfileStats::JSON() const {
+    std::stringstream json;
+    json << "{\"stages\":{";
+    for ( size_t i = 0; i < N_ProfileStages; i++ ) {
+        json << ( i ? "," : "" ) << "\""
+             << ProfileStageName( (ProfileStage) i ) << "\":{\"seconds\":"
+             << seconds[ i ] << ",\"calls\":" << calls[ i ] << "}";
+    }
+    json << "},\"counters\":{";
+    for ( size_t i = 0; i < N_ProfileCounters; i++ ) {
+        json << ( i ? "," : "" ) << "\""
+             << ProfileCounterName( (ProfileCounter) i ) << "\":"
+             << counters[ i ];
+    }
+    json << "}}";
+    return json.str();
+}
@@ -0,0 +1,153 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//---------------------------------------------------------
+// Pipeline profiler
+// Wall time and call count of the pipeline stages, and event
+// counters, accumulated over all threads of the process.
+//
+// Instrumentation is compiled in with -DEDM_PROFILE. Without it
+// EDM_PROFILE_SCOPE and EDM_PROFILE_COUNT expand to nothing and
+// ProfileSnapshot() returns zeros.
+//
+// Stages may nest (SVD within Projection). Counters are kept per
+// thread and published to the process totals when a timed stage
+// ends on that thread and by ProfileSnapshot() on the calling thread.
+//
+// The profile of one call, apart from other calls running at the
+// same time, is taken by a ProfileRecorder in the scope of the call.
+//---------------------------------------------------------
+enum class ProfileStage {
+    ReadData, SetupDataFrame, MakeBlock, FindNeighbors, Projection,
+    SVD, WriteData, N_Stages
+};
+
+enum class ProfileCounter {
+    DistanceEvaluations,    // Distance() calls
+    DataFrameConstructions, // DataFrames constructed with a size,
+                            // copies and moves are not counted
+    CandidatesPruned,       // KDTree / VPTree subtrees skipped by bounds
+    SVDCalls,
+    ArenaAllocations,       // Arena::Allocate() calls
+    N_Counters
+};
+
+const size_t N_ProfileStages   = (size_t) ProfileStage::N_Stages;
+const size_t N_ProfileCounters = (size_t) ProfileCounter::N_Counters;
+
+struct ProfileStats {
+    double   seconds [ N_ProfileStages ];   // wall time in each stage
+    uint64_t calls   [ N_ProfileStages ];
+    uint64_t counters[ N_ProfileCounters ];
+
+    ProfileStats();
+
+    // Difference of two snapshots: the profile of the work between
+    ProfileStats operator-( const ProfileStats &before ) const;
+
+    // {"stages":{"ReadData":{"seconds":s,"calls":n},...},
+    //  "counters":{"DistanceEvaluations":n,...}}
+    std::string JSON() const;
+};
+
+const char *ProfileStageName  ( ProfileStage   stage   );
+const char *ProfileCounterName( ProfileCounter counter );
+
+ProfileStats ProfileSnapshot();
+void         ProfileReset();
+void         WriteProfileJSON( const std::string &fileName );
+
+//---------------------------------------------------------
+// Totals of a ProfileRecorder. Stages and counters are added to the
+// sink of the thread and to its parents, the enclosing recorders.
+//---------------------------------------------------------
+struct ProfileSink {
+    std::atomic< uint64_t > nanoseconds[ N_ProfileStages ];
+    std::atomic< uint64_t > calls      [ N_ProfileStages ];
+    std::atomic< uint64_t > counters   [ N_ProfileCounters ];
+    ProfileSink            *parent;
+
+    explicit ProfileSink( ProfileSink *parent );
+    ProfileStats Stats() const;
+};
+
+// Sink of the calling thread, nullptr outside of recorders
+ProfileSink *ProfileCurrentSink();
+
+//---------------------------------------------------------
+// ProfileSinkScope class
+// sink is the sink of the calling thread for the scope: the hook
+// of TaskGroup tasks to profile into the recorder of the submitter.
+//---------------------------------------------------------
+class ProfileSinkScope {
+    ProfileSink *previous;
+public:
+    explicit ProfileSinkScope( ProfileSink *sink );
+    ~ProfileSinkScope();
+
+    ProfileSinkScope( const ProfileSinkScope & )            = delete;
+    ProfileSinkScope &operator=( const ProfileSinkScope & ) = delete;
+};
+
+//---------------------------------------------------------
+// ProfileRecorder class
+// Profile of the work done in the scope of the recorder: on the
+// calling thread and in the TaskGroup tasks submitted within it,
+// which finish before the scope ends. Work of other threads is not
+// included. Stats() is all zeros without -DEDM_PROFILE.
+//---------------------------------------------------------
+class ProfileRecorder {
+    ProfileSink      sink;
+    ProfileSinkScope scope;
+public:
+    ProfileRecorder();
+
+    ProfileStats Stats() const;
+};
+
+//---------------------------------------------------------
+// Instrumentation
+//---------------------------------------------------------
+void ProfileAddTime( ProfileStage stage, double seconds );
+void ProfileFlushCounters();
+
+extern thread_local uint64_t ProfileThreadCounters[ N_ProfileCounters ];
+
+inline void ProfileCount( ProfileCounter counter, uint64_t N = 1 ) {
+    ProfileThreadCounters[ (size_t) counter ] += N;
+}
+
+class ProfileScope {
+    ProfileStage                          stage;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit ProfileScope( ProfileStage stage ) :
+        stage( stage ), start( std::chrono::steady_clock::now() ) {}
+    ~ProfileScope() {
+        std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start;
+        ProfileAddTime( stage, elapsed.count() );
+        ProfileFlushCounters();
+    }
+};
+
+#define EDM_PROFILE_CONCAT_( a, b ) a##b
+#define EDM_PROFILE_CONCAT( a, b )  EDM_PROFILE_CONCAT_( a, b )
+
+#ifdef EDM_PROFILE
+#define EDM_PROFILE_SCOPE( stage ) \
+    ProfileScope EDM_PROFILE_CONCAT( profileScope, __LINE__ )( \
+        ProfileStage::stage )
+#define EDM_PROFILE_COUNT( counter, N ) \
+    ProfileCount( ProfileCounter::counter, N )
+#else
+#define EDM_PROFILE_SCOPE( stage )
+#define EDM_PROFILE_COUNT( counter, N )
+#endif
+
+#endif
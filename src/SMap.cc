@@ -7,9 +7,36 @@
 #include "Embed.h"
 #include "Neighbors.h"
 #include "AuxFunc.h"
+#include "Async.h"
 
 // forward declaration
-std::valarray< double > SVD( DataFrame< double > A, std::valarray< double > B );
+void SVD( const double *A, size_t rows, size_t columns,
+          const double *B, double *C );
+
+namespace {
+    //------------------------------------------------------------
+    // S-Map projection, predictions written to pathOut/predictFile
+    // and coefficients to pathOut/smapFile if given
+    //------------------------------------------------------------
+    SMapValues SMapOutput( const Parameters  &param,
+                           const DataEmbedNN &dataEmbedNN ) {
+
+        SMapValues values = SMapProjection( param, dataEmbedNN );
+
+        if ( param.predictOutputFile.size() ) {
+            // Write to disk, first embed in a DataIO object
+            DataIO dout( values.predictions );
+            dout.WriteData( param.pathOut, param.predictOutputFile );
+        }
+        if ( param.SmapOutputFile.size() ) {
+            // Write to disk, first embed in a DataIO object
+            DataIO dout2( values.coefficients );
+            dout2.WriteData( param.pathOut, param.SmapOutputFile );
+        }
+
+        return values;
+    }
+}
 
 //----------------------------------------------------------------
 // 
@@ -30,7 +57,8 @@ SMapValues SMap( std::string pathIn,
                  std::string smapFile,
                  std::string jacobians,
                  bool        embedded,
-                 bool        verbose )
+                 bool        verbose,
+                 std::string neighborCache )
 {
 
     Parameters param = Parameters( Method::SMap, pathIn, dataFile,
@@ -39,24 +67,104 @@ SMapValues SMap( std::string pathIn,
                                    columns, target, embedded, verbose,
                                    smapFile, "", jacobians );
 
+    param.neighborCachePath = neighborCache;
+
     //----------------------------------------------------------
     // Load data, Embed, compute Neighbors
     //----------------------------------------------------------
     DataEmbedNN dataEmbedNN = LoadDataEmbedNN( param, columns );
-    DataIO                dio        = dataEmbedNN.dio;
-    DataFrame<double>     dataBlock  = dataEmbedNN.dataFrame;
-    std::valarray<double> target_vec = dataEmbedNN.targetVec;
-    Neighbors             neighbors  = dataEmbedNN.neighbors;
-    
-    // target_vec spans the entire dataBlock, subset targetLibVector
-    // to library for row indexing used below:
-    std::slice lib_i = std::slice( param.library[0], param.library.size(), 1 );
-    std::valarray<double> targetLibVector = target_vec[ lib_i ];
 
-    //----------------------------------------------------------
-    // SMap projection
-    //----------------------------------------------------------
-    size_t library_N_row = param.library.size();
+    return SMapOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// SMap of data in memory
+//----------------------------------------------------------------
+SMapValues SMap( const DataFrame<double> &dataFrame,
+                 std::string lib,
+                 std::string pred,
+                 int         E,
+                 int         Tp,
+                 int         knn,
+                 int         tau,
+                 double      theta,
+                 std::string columns,
+                 std::string target,
+                 std::string jacobians,
+                 bool        embedded,
+                 bool        verbose,
+                 std::string pathOut,
+                 std::string predictFile,
+                 std::string smapFile,
+                 std::string neighborCache )
+{
+    Parameters param = Parameters( Method::SMap, "", "",
+                                   pathOut, predictFile,
+                                   lib, pred, E, Tp, knn, tau, theta,
+                                   columns, target, embedded, verbose,
+                                   smapFile, "", jacobians );
+
+    param.neighborCachePath = neighborCache;
+
+    DataEmbedNN dataEmbedNN = EmbedNN( DataIO( dataFrame ), param, columns );
+
+    return SMapOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// SMap of an embedding block and its target
+//----------------------------------------------------------------
+SMapValues SMap( const DataFrame<double>     &block,
+                 const std::valarray<double> &target,
+                 std::string lib,
+                 std::string pred,
+                 int         Tp,
+                 int         knn,
+                 double      theta,
+                 bool        verbose,
+                 std::string pathOut,
+                 std::string predictFile,
+                 std::string smapFile )
+{
+    Parameters param = Parameters( Method::SMap, "", "",
+                                   pathOut, predictFile,
+                                   lib, pred, block.NColumns(), Tp, knn,
+                                   1, theta, "", "", true, verbose,
+                                   smapFile );
+
+    DataEmbedNN dataEmbedNN = BlockNN( block, target, param );
+
+    return SMapOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// S-Map projection of the prediction rows of dataEmbedNN
+//----------------------------------------------------------------
+SMapValues SMapProjection( const Parameters  &param,
+                           const DataEmbedNN &dataEmbedNN ) {
+    return SMapProjection( param, dataEmbedNN, dataEmbedNN.neighbors );
+}
+
+//----------------------------------------------------------------
+// S-Map projection of the prediction rows with neighbors
+//----------------------------------------------------------------
+SMapValues SMapProjection( const Parameters  &param,
+                           const DataEmbedNN &dataEmbedNN,
+                           const Neighbors   &neighbors ) {
+
+    EDM_PROFILE_SCOPE( Projection );
+
+    const DataIO                &dio        = dataEmbedNN.dio;
+    const std::valarray<double> &target_vec = dataEmbedNN.targetVec;
+
+    if ( dataEmbedNN.targets.NColumns() > 1 ) {
+        std::string errMsg( "SMap(): Multiple targets are not supported, "
+                            "use one target.\n" );
+        throw std::runtime_error( errMsg );
+    }
+    
+    // target_vec spans the entire dataBlock and is indexed by the
+    // neighbor (library) row indices
     size_t predict_N_row = param.prediction.size();
     size_t N_row         = neighbors.neighbors.NRows();
 
@@ -83,24 +191,38 @@ SMapValues SMap( std::string pathIn,
     DataFrame< double > jacobian;
     DataFrame< double > tangents;
 
+    //------------------------------------------------------------
+    // Weights w, matrix A, vector B and coefficients C of a row are
+    // call scoped on the thread arena, A 64 byte aligned for the SVD
+    //------------------------------------------------------------
+    size_t N_columns = param.E + 1;
+
+    ArenaScope scope;
+    ArenaVector< double > w( param.knn );
+    ArenaVector< double > B( param.knn );
+    ArenaVector< double > C( N_columns );
+    double *A = static_cast< double * >(
+        scope.Get().Allocate( param.knn * N_columns * sizeof( double ), 64 ) );
+
     //------------------------------------------------------------
     // Process each prediction row
     //------------------------------------------------------------
     for ( size_t row = 0; row < N_row; row++ ) {
-        
-        double D_avg = neighbors.distances.Row( row ).sum() / param.knn;
+        ReportProgress( "SMap", row, N_row );
 
-        // Compute weight vector 
-        std::valarray< double > w = std::valarray< double >( param.knn );
-        if ( param.theta > 0 ) {
-            w = std::exp( (-param.theta/D_avg) * neighbors.distances.Row(row) );
-        }
-        else {
-            w = std::valarray< double >( 1, param.knn );
+        const double *distanceRow = &neighbors.distances( row, 0 );
+
+        double D_avg = 0;
+        for ( size_t k = 0; k < param.knn; k++ ) {
+            D_avg += distanceRow[ k ];
         }
+        D_avg = D_avg / param.knn;
 
-        DataFrame< double >     A = DataFrame< double >(param.knn, param.E + 1);
-        std::valarray< double > B = std::valarray< double >( param.knn );
+        // Compute weight vector 
+        for ( size_t k = 0; k < param.knn; k++ ) {
+            w[ k ] = param.theta > 0 ?
+                std::exp( (-param.theta/D_avg) * distanceRow[ k ] ) : 1;
+        }
 
         // Populate matrix A (exp weighted future prediction), and
         // vector B (target BC's) for this row (observation).
@@ -109,52 +231,59 @@ SMapValues SMap( std::string pathIn,
         for ( size_t k = 0; k < param.knn; k++ ) {
             lib_row = neighbors.neighbors( row, k ) + param.Tp;
             
-            if ( lib_row > library_N_row ) {
+            if ( not param.library.Contains( lib_row ) ) {
                 // The knn index + Tp is outside the library domain
                 // Can only happen if noNeighborLimit = true is used.
                 if ( param.verbose ) {
                     std::stringstream msg;
                     msg << "SMap() in row " << row << " libRow " << lib_row
                         << " exceeds library domain.\n";
-                    std::cout << msg.str();
+                    Message( msg.str() );
                 }
                 
                 // Use the neighbor at the 'base' of the trajectory
-                B[ k ] = targetLibVector[ lib_row - param.Tp ];
+                B[ k ] = target_vec[ lib_row - param.Tp ];
             }
             else {
-                B[ k ] = targetLibVector[ lib_row ];
+                B[ k ] = target_vec[ lib_row ];
             }
 
-            A( k, 0 ) = w[ k ];
-            for ( size_t j = 1; j < param.E + 1; j++ ) {
-                A( k, j ) = w[k] * dataBlock( param.prediction[ row ], j );
+            double *A_k = A + k * N_columns;
+            A_k[ 0 ] = w[ k ];
+            for ( size_t j = 1; j < N_columns; j++ ) {
+                A_k[ j ] = w[k] * dataEmbedNN.Block( param.prediction[row],
+                                                     j - 1 );
             }
-        }
 
-        B = w * B; // Weighted target vector
+            B[ k ] = w[ k ] * B[ k ]; // Weighted target vector
+        }
 
         // Estimate linear mapping of predictions A onto target B
-        std::valarray < double > C = SVD( A, B );
+        SVD( A, param.knn, N_columns, B.data(), C.data() );
 
         // Prediction is local linear projection
         double prediction = C[ 0 ]; // Note that C[ 0 ] is the bias term
 
         for ( size_t e = 1; e < param.E + 1; e++ ) {
             prediction = prediction + C[ e ] *
-                dataBlock( param.prediction[ row ], e );
+                dataEmbedNN.Block( param.prediction[ row ], e - 1 );
         }
 
         predictions[ row ] = prediction;
-        coefficients.WriteRow( row, C );
+        for ( size_t e = 0; e < N_columns; e++ ) {
+            coefficients( row, e ) = C[ e ];
+        }
 
     } // for ( row = 0; row < predict_N_row; row++ )
 
+    ReportProgress( "SMap", N_row, N_row );
+
     for ( size_t col = 0; col < coefficients.NColumns(); col++ ) {
         std::stringstream coefName;
         coefName << "C" << col;
         coefficients.ColumnNames().push_back( coefName.str() );
     }
+    coefficients.BuildColumnNameIndex();
 
     //-----------------------------------------------------
     // Jacobians
@@ -169,7 +298,10 @@ SMapValues SMap( std::string pathIn,
                                                 dio.DFrame(), target_vec );
     
     // Add time column to coefficients
-    std::slice pred_i = std::slice( param.prediction[0], N_row, 1 );
+    std::valarray<double> predTime( N_row );
+    for ( size_t row = 0; row < N_row; row++ ) {
+        predTime[ row ] = dio.DFrame()( param.prediction[ row ], 0 );
+    }
     
     DataFrame< double > coefOut = DataFrame< double >( N_row, param.E + 2 );
     std::vector<std::string> coefNames;
@@ -178,22 +310,12 @@ SMapValues SMap( std::string pathIn,
         coefNames.push_back( coefficients.ColumnNames()[ col ] );
     }
     coefOut.ColumnNames() = coefNames;
-    coefOut.WriteColumn( 0, dio.DFrame().Column( 0 )[ pred_i ] );
+    coefOut.BuildColumnNameIndex();
+    coefOut.WriteColumn( 0, predTime );
     for ( size_t col = 1; col < coefOut.NColumns(); col++ ) {
         coefOut.WriteColumn( col, coefficients.Column( col - 1 ) );
     }
 
-    if ( param.predictOutputFile.size() ) {
-        // Write to disk, first embed in a DataIO object
-        DataIO dout( dataFrame );
-        dout.WriteData( param.pathOut, param.predictOutputFile );
-    }
-    if ( param.SmapOutputFile.size() ) {
-        // Write to disk, first embed in a DataIO object
-        DataIO dout2( coefOut );
-        dout2.WriteData( param.pathOut, param.SmapOutputFile );
-    }
-    
     SMapValues values = SMapValues();
     values.predictions  = dataFrame;
     values.coefficients = coefOut;
@@ -202,29 +324,31 @@ SMapValues SMap( std::string pathIn,
 }
 
 //----------------------------------------------------------------
-// 
+// Least squares solution C of the rows x columns system A C = B,
+// A row major and 64 byte aligned
 //----------------------------------------------------------------
-std::valarray < double > SVD( DataFrame< double >     A_,
-                              std::valarray< double > B_ ) {
+void SVD( const double *A_, size_t rows, size_t columns,
+          const double *B_, double *C_ ) {
 
-    // Eigen::Map<> allows "raw" initialization from a pointer
-    // The Map (A) is then a mapping to the memory location pointer (a)
-    double *a = &(A_.Elements()[0]);
+    EDM_PROFILE_SCOPE( SVD );
+    EDM_PROFILE_COUNT( SVDCalls, 1 );
 
+    // Eigen::Map<> allows "raw" initialization from a pointer
+    // The Map (A) is then a mapping to the memory location pointer (A_)
     // Eigen defaults to storing in column-major: use RowMajor flag
-    Eigen::Map< Eigen::Matrix< double,
-                               Eigen::Dynamic,
-                               Eigen::Dynamic,
-                               Eigen::RowMajor> > A(a,A_.NRows(),A_.NColumns());
+    Eigen::Map< const Eigen::Matrix< double,
+                                     Eigen::Dynamic,
+                                     Eigen::Dynamic,
+                                     Eigen::RowMajor>,
+                Eigen::Aligned64 > A( A_, rows, columns );
 
-    double *b = &(B_[0]);
-    Eigen::VectorXd B = Eigen::Map< Eigen::VectorXd >( b, B_.size() );
+    Eigen::Map< const Eigen::VectorXd > B( B_, rows );
 
     Eigen::VectorXd C =
         A.jacobiSvd( Eigen::ComputeThinU | Eigen::ComputeThinV ).solve( B );
 
-    // Extract fit coefficients from Eigen::VectorXd to valarray<>
-    std::valarray < double > C_( C.data(), A_.NColumns() );
+    // Extract fit coefficients from Eigen::VectorXd
+    std::copy( C.data(), C.data() + columns, C_ );
 
 #ifdef DEBUG_ALL
     std::cout << "SVD------------------------\n";
@@ -233,6 +357,4 @@ std::valarray < double > SVD( DataFrame< double >     A_,
     std::cout << "Eigen B ----------\n";
     std::cout << B << std::endl;
 #endif
-    
-    return C_;
 }
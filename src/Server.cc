@@ -0,0 +1,392 @@
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.h"
+#include "Interface.h"
+
+namespace {
+    // Wake interval of blocking socket calls to check for shutdown
+    const int PollMilliseconds = 200;
+
+    //------------------------------------------------------------
+    // Message on one line for ERROR responses
+    //------------------------------------------------------------
+    std::string OneLine( std::string message ) {
+        while ( message.size() and ( message.back() == '\n' or
+                                     message.back() == '\r' ) ) {
+            message.pop_back();
+        }
+        std::replace( message.begin(), message.end(), '\n', ' ' );
+        return message;
+    }
+
+    //------------------------------------------------------------
+    // Write all of response to the socket fd
+    //------------------------------------------------------------
+    bool SendAll( int fd, const std::string &response ) {
+        size_t sent = 0;
+        while ( sent < response.size() ) {
+            ssize_t N = send( fd, response.data() + sent,
+                              response.size() - sent, MSG_NOSIGNAL );
+            if ( N < 0 ) {
+                if ( errno == EINTR ) { continue; }
+                return false;
+            }
+            sent += N;
+        }
+        return true;
+    }
+}
+
+//----------------------------------------------------------------
+// Constructor
+//----------------------------------------------------------------
+Server::Server( const std::vector< std::string > &defaultArgs,
+                size_t                            cacheSize ) :
+    defaultArgs ( defaultArgs ),
+    data        ( cacheSize ),
+    embeddings  ( cacheSize ),
+    indices     ( cacheSize ),
+    stopped     ( false ),
+    nConnections( 0 ) {}
+
+//----------------------------------------------------------------
+// Data of pathIn/dataFile, reloaded if the file has changed
+//----------------------------------------------------------------
+Server::DataPtr Server::Data( const Parameters &param,
+                              std::string      &dataKey ) {
+
+    std::string fileName = param.pathIn + param.dataFile;
+
+    struct stat fileStat;
+    if ( stat( fileName.c_str(), &fileStat ) != 0 ) {
+        std::stringstream errMsg;
+        errMsg << "Server::Data(): data file " << fileName
+               << " not found.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    // A rewrite within the same second changes the nanoseconds or
+    // the size of the file
+    std::stringstream version;
+    version << fileStat.st_mtim.tv_sec << "."
+            << std::setw( 9 ) << std::setfill( '0' )
+            << fileStat.st_mtim.tv_nsec << ":" << fileStat.st_size;
+
+    dataKey = fileName + "@" + version.str();
+
+    DataEntry entry;
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( data.Get( fileName, entry ) and
+             entry.version == version.str() ) {
+            return entry.dio;
+        }
+    }
+
+    entry.dio     = std::make_shared< DataIO >( param.pathIn,
+                                                param.dataFile );
+    entry.version = version.str();
+
+    std::lock_guard< std::mutex > lock( mutex );
+    data.Put( fileName, entry );
+
+    return entry.dio;
+}
+
+//----------------------------------------------------------------
+// Embedding and targets of the data
+//----------------------------------------------------------------
+Server::EmbeddingPtr Server::Embedding( const Parameters  &param,
+                                        const DataIO      &dio,
+                                        const std::string &dataKey,
+                                        std::string       &embedKey ) {
+
+    std::stringstream key;
+    key << dataKey << "|E=" << param.E << "|tau=" << param.tau
+        << "|embedded=" << param.embedded << "|lagged=" << param.laggedView
+        << "|forwardTau=" << param.forwardTau
+        << "|singlePrecision=" << param.singlePrecision
+        << "|columns=" << param.columns_str << "|target=" << param.target_str;
+    embedKey = key.str();
+
+    EmbeddingPtr embedding;
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( embeddings.Get( embedKey, embedding ) ) {
+            return embedding;
+        }
+    }
+
+    embedding = std::make_shared< DataEmbedNN >(
+        EmbedData( dio, param, param.columns_str ) );
+
+    std::lock_guard< std::mutex > lock( mutex );
+    embeddings.Put( embedKey, embedding );
+
+    return embedding;
+}
+
+//----------------------------------------------------------------
+// NeighborIndex of the library rows of the embedding
+//----------------------------------------------------------------
+Server::IndexPtr Server::Index( const Parameters  &param,
+                                const DataEmbedNN &embedding,
+                                const std::string &embedKey ) {
+
+    std::stringstream key;
+    key << embedKey << "|Tp=" << param.Tp
+        << "|noNeighborLimit=" << param.noNeighborLimit
+        << "|algorithm=" << (int) param.neighborAlgorithm
+        << "|metric=" << (int) param.metric
+        << "|M=" << param.hnswM << "|ef=" << param.hnswEf
+        << "|library=" << param.library;
+
+    IndexPtr index;
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( indices.Get( key.str(), index ) ) {
+            return index;
+        }
+    }
+
+    std::shared_ptr< NeighborIndex > newIndex =
+        std::make_shared< NeighborIndex >();
+    BuildBlockIndex( *newIndex, embedding, param );
+    index = newIndex;
+
+    std::lock_guard< std::mutex > lock( mutex );
+    indices.Put( key.str(), index );
+
+    return index;
+}
+
+//----------------------------------------------------------------
+// Simplex or S-Map forecast of one request
+//----------------------------------------------------------------
+std::string Server::Forecast( const std::vector< std::string > &args ) {
+
+    Parameters param = Parameters::FromArgs( args, defaultArgs );
+
+    if ( param.method != Method::Simplex and param.method != Method::SMap ) {
+        std::string errMsg( "Server: method must be simplex or smap.\n" );
+        throw std::runtime_error( errMsg );
+    }
+
+    std::string  dataKey;
+    std::string  embedKey;
+    DataPtr      dio       = Data( param, dataKey );
+    EmbeddingPtr embedding = Embedding( param, *dio, dataKey, embedKey );
+    EmbeddingRows( param, *embedding );
+    IndexPtr     index     = Index( param, *embedding, embedKey );
+
+    Neighbors neighbors = FindBlockNeighbors( *index, *embedding, param );
+
+    DataFrame< double > predictions;
+    if ( param.method == Method::SMap ) {
+        SMapValues values = SMapProjection( param, *embedding, neighbors );
+        predictions = values.predictions;
+
+        if ( param.SmapOutputFile.size() ) {
+            DataIO dout( values.coefficients );
+            dout.WriteData( param.pathOut, param.SmapOutputFile );
+        }
+    }
+    else {
+        predictions = SimplexProjection( param, *embedding, neighbors );
+    }
+
+    if ( param.predictOutputFile.size() ) {
+        DataIO dout( predictions );
+        dout.WriteData( param.pathOut, param.predictOutputFile );
+    }
+
+    VectorError error = ComputeError( predictions.Column( 1 ),
+                                      predictions.Column( 2 ) );
+
+    std::stringstream response;
+    response << "OK " << predictions.NRows() + 1 << " rho=" << error.rho
+             << " RMSE=" << error.RMSE << " MAE=" << error.MAE << "\n";
+    response << "Time,Observations,Predictions\n";
+    response.precision( 10 );
+    for ( size_t row = 0; row < predictions.NRows(); row++ ) {
+        response << predictions( row, 0 ) << "," << predictions( row, 1 )
+                 << "," << predictions( row, 2 ) << "\n";
+    }
+
+    return response.str();
+}
+
+//----------------------------------------------------------------
+// Response to one request line
+//----------------------------------------------------------------
+std::string Server::Request( const std::string &line ) {
+
+    std::vector< std::string > args;
+    try {
+        args = SplitArguments( line );
+    }
+    catch ( const std::exception &e ) {
+        return "ERROR " + OneLine( e.what() ) + "\n";
+    }
+
+    if ( args.empty() ) {
+        return "ERROR empty request\n";
+    }
+    if ( args.size() == 1 and args[ 0 ] == "quit" ) {
+        return "";
+    }
+    if ( args.size() == 1 and args[ 0 ] == "shutdown" ) {
+        stopped = true;
+        return "OK 0\n";
+    }
+    if ( args.size() == 1 and args[ 0 ] == "clear" ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        data.Clear();
+        embeddings.Clear();
+        indices.Clear();
+        return "OK 0\n";
+    }
+    if ( args.size() == 1 and args[ 0 ] == "stats" ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        std::stringstream response;
+        response << "OK 4\n" << "cache,size,capacity,hits,misses\n"
+                 << "data,"       << data.Size()       << ","
+                 << data.Capacity()       << "," << data.Hits()       << ","
+                 << data.Misses()       << "\n"
+                 << "embeddings," << embeddings.Size() << ","
+                 << embeddings.Capacity() << "," << embeddings.Hits() << ","
+                 << embeddings.Misses() << "\n"
+                 << "indices,"    << indices.Size()    << ","
+                 << indices.Capacity()    << "," << indices.Hits()    << ","
+                 << indices.Misses()    << "\n";
+        return response.str();
+    }
+
+    try {
+        return Forecast( args );
+    }
+    catch ( const std::exception &e ) {
+        return "ERROR " + OneLine( e.what() ) + "\n";
+    }
+}
+
+//----------------------------------------------------------------
+// Line protocol on streams
+//----------------------------------------------------------------
+void Server::Serve( std::istream &in, std::ostream &out ) {
+
+    std::string line;
+    while ( not stopped and std::getline( in, line ) ) {
+        std::string response = Request( line );
+        if ( response.empty() ) {
+            break;
+        }
+        out << response << std::flush;
+    }
+}
+
+//----------------------------------------------------------------
+// Line protocol on one socket connection
+//----------------------------------------------------------------
+void Server::ServeConnection( int fd ) {
+
+    std::string buffer;
+    char        chunk[ 4096 ];
+    bool        open = true;
+
+    while ( open and not stopped ) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll( &pfd, 1, PollMilliseconds );
+        if ( ready < 0 and errno != EINTR ) { break; }
+        if ( ready <= 0 ) { continue; }
+
+        ssize_t N = recv( fd, chunk, sizeof( chunk ), 0 );
+        if ( N <= 0 ) {
+            if ( N < 0 and errno == EINTR ) { continue; }
+            break;
+        }
+        buffer.append( chunk, N );
+
+        size_t newline;
+        while ( open and
+                ( newline = buffer.find( '\n' ) ) != std::string::npos ) {
+            std::string line = buffer.substr( 0, newline );
+            buffer.erase( 0, newline + 1 );
+
+            std::string response = Request( line );
+            open = response.size() and SendAll( fd, response );
+        }
+    }
+
+    close( fd );
+    nConnections--;
+}
+
+//----------------------------------------------------------------
+// Line protocol on a Unix domain socket, one thread per connection
+//----------------------------------------------------------------
+void Server::ServeSocket( const std::string &socketPath ) {
+
+    struct sockaddr_un address;
+    if ( socketPath.size() >= sizeof( address.sun_path ) ) {
+        std::stringstream errMsg;
+        errMsg << "Server::ServeSocket(): socket path " << socketPath
+               << " is too long.\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, socketPath.c_str(),
+             sizeof( address.sun_path ) - 1 );
+
+    int listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( listenFd < 0 ) {
+        std::stringstream errMsg;
+        errMsg << "Server::ServeSocket(): socket: " << strerror( errno )
+               << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    unlink( socketPath.c_str() );
+    if ( bind( listenFd, (struct sockaddr *) &address,
+               sizeof( address ) ) != 0 or listen( listenFd, 64 ) != 0 ) {
+        std::stringstream errMsg;
+        errMsg << "Server::ServeSocket(): " << socketPath << ": "
+               << strerror( errno ) << ".\n";
+        close( listenFd );
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    while ( not stopped ) {
+        struct pollfd pfd = { listenFd, POLLIN, 0 };
+        int ready = poll( &pfd, 1, PollMilliseconds );
+        if ( ready <= 0 ) { continue; }
+
+        int fd = accept( listenFd, NULL, NULL );
+        if ( fd < 0 ) { continue; }
+
+        nConnections++;
+        std::thread( &Server::ServeConnection, this, fd ).detach();
+    }
+
+    close( listenFd );
+    unlink( socketPath.c_str() );
+
+    // Connections see stopped within PollMilliseconds
+    while ( nConnections ) {
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds( PollMilliseconds / 4 ) );
+    }
+}
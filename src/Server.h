@@ -0,0 +1,91 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <mutex>
+
+#include "Common.h"
+#include "Parameter.h"
+#include "AuxFunc.h"
+#include "LRUCache.h"
+
+//---------------------------------------------------------
+// Server class
+// Long running edm process that answers forecast requests over a
+// line protocol on stdin/stdout or a Unix domain socket. Loaded data,
+// embeddings and neighbor indices stay resident in LRU caches, so
+// repeated requests on the same data skip the csv parse, embedding
+// and index build.
+//
+// Request: one line of Parameters::Load() arguments, applied over
+// the server default arguments, e.g.
+//   -m simplex -i LorenzData1000.csv -l "1 500" -p "501 510" -E 3 -c V1
+// Response:
+//   OK <N> rho=<rho> RMSE=<RMSE> MAE=<MAE>
+//   followed by N csv lines: Time,Observations,Predictions header
+//   and one line per output row
+// or
+//   ERROR <message>
+//
+// Other requests: "stats" (cache sizes, hits, misses), "clear"
+// (empty the caches), "quit" (close the connection), "shutdown"
+// (stop the server). A data file is reloaded when its modification
+// time (in nanoseconds) or size changes.
+//---------------------------------------------------------
+class Server {
+
+    typedef std::shared_ptr< const DataIO >        DataPtr;
+    typedef std::shared_ptr< const DataEmbedNN >   EmbeddingPtr;
+    typedef std::shared_ptr< const NeighborIndex > IndexPtr;
+
+    struct DataEntry {
+        DataPtr     dio;
+        std::string version; // mtime and size of the file when loaded
+    };
+
+    std::vector< std::string > defaultArgs;
+
+    std::mutex                                 mutex; // guards the caches
+    LRUCache< std::string, DataEntry >         data;
+    LRUCache< std::string, EmbeddingPtr >      embeddings;
+    LRUCache< std::string, IndexPtr >          indices;
+
+    std::atomic< bool >   stopped;
+    std::atomic< size_t > nConnections;
+
+    // Cached or new: keys of the data and embedding are returned
+    // for the keys of the dependent entries
+    DataPtr      Data     ( const Parameters &param, std::string &dataKey );
+    EmbeddingPtr Embedding( const Parameters  &param,
+                            const DataIO      &dio,
+                            const std::string &dataKey,
+                            std::string       &embedKey );
+    IndexPtr     Index    ( const Parameters  &param,
+                            const DataEmbedNN &embedding,
+                            const std::string &embedKey );
+
+    std::string Forecast( const std::vector< std::string > &args );
+
+    void ServeConnection( int fd );
+
+public:
+    // cacheSize : entries of each of the data, embedding and index caches
+    Server( const std::vector< std::string > &defaultArgs,
+            size_t                            cacheSize = 16 );
+
+    // Response to one request line, empty for quit
+    std::string Request( const std::string &line );
+
+    bool Stopped() const { return stopped; }
+
+    // Line protocol on in/out until quit, shutdown or end of input
+    void Serve( std::istream &in, std::ostream &out );
+
+    // Line protocol on connections to a Unix domain socket at
+    // socketPath until shutdown, one thread per connection
+    void ServeSocket( const std::string &socketPath );
+};
+
+#endif
@@ -5,6 +5,27 @@
 #include "Neighbors.h"
 #include "Embed.h"
 #include "AuxFunc.h"
+#include "Async.h"
+
+namespace {
+    //------------------------------------------------------------
+    // Simplex projection, written to pathOut/predictFile if given
+    //------------------------------------------------------------
+    DataFrame<double> SimplexOutput( const Parameters  &param,
+                                     const DataEmbedNN &dataEmbedNN ) {
+
+        DataFrame<double> dataFrame = SimplexProjection( param,
+                                                         dataEmbedNN );
+
+        if ( param.predictOutputFile.size() ) {
+            // Write to disk, first embed in a DataIO object
+            DataIO dout( dataFrame );
+            dout.WriteData( param.pathOut, param.predictOutputFile );
+        }
+
+        return dataFrame;
+    }
+}
 
 //----------------------------------------------------------------
 // 
@@ -22,27 +43,99 @@ DataFrame<double> Simplex( std::string pathIn,
                            std::string columns,
                            std::string target,
                            bool        embedded,
-                           bool        verbose ) {
+                           bool        verbose,
+                           std::string neighborCache ) {
 
     Parameters param = Parameters( Method::Simplex, pathIn, dataFile,
                                    pathOut, predictFile,
                                    lib, pred, E, Tp, knn, tau, 0,
                                    columns, target, embedded, verbose );
 
+    param.neighborCachePath = neighborCache;
+
     //----------------------------------------------------------
     // Load data, Embed, compute Neighbors
     //----------------------------------------------------------
     DataEmbedNN dataEmbedNN = LoadDataEmbedNN( param, columns );
-    DataIO                dio        = dataEmbedNN.dio;
-    DataFrame<double>     dataBlock  = dataEmbedNN.dataFrame;
-    std::valarray<double> target_vec = dataEmbedNN.targetVec;
-    Neighbors             neighbors  = dataEmbedNN.neighbors;
 
-    //----------------------------------------------------------
-    // Simplex projection
-    //----------------------------------------------------------
-    size_t library_N_row = param.library.size();
-    size_t N_row         = neighbors.neighbors.NRows();
+    return SimplexOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// Simplex of data in memory
+//----------------------------------------------------------------
+DataFrame<double> Simplex( const DataFrame<double> &dataFrame,
+                           std::string lib,
+                           std::string pred,
+                           int         E,
+                           int         Tp,
+                           int         knn,
+                           int         tau,
+                           std::string columns,
+                           std::string target,
+                           bool        embedded,
+                           bool        verbose,
+                           std::string pathOut,
+                           std::string predictFile,
+                           std::string neighborCache ) {
+
+    Parameters param = Parameters( Method::Simplex, "", "",
+                                   pathOut, predictFile,
+                                   lib, pred, E, Tp, knn, tau, 0,
+                                   columns, target, embedded, verbose );
+
+    param.neighborCachePath = neighborCache;
+
+    DataEmbedNN dataEmbedNN = EmbedNN( DataIO( dataFrame ), param, columns );
+
+    return SimplexOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// Simplex of an embedding block and its target
+//----------------------------------------------------------------
+DataFrame<double> Simplex( const DataFrame<double>     &block,
+                           const std::valarray<double> &target,
+                           std::string lib,
+                           std::string pred,
+                           int         Tp,
+                           int         knn,
+                           bool        verbose,
+                           std::string pathOut,
+                           std::string predictFile ) {
+
+    Parameters param = Parameters( Method::Simplex, "", "",
+                                   pathOut, predictFile,
+                                   lib, pred, block.NColumns(), Tp, knn,
+                                   1, 0, "", "", true, verbose );
+
+    DataEmbedNN dataEmbedNN = BlockNN( block, target, param );
+
+    return SimplexOutput( param, dataEmbedNN );
+}
+
+//----------------------------------------------------------------
+// Simplex projection of the prediction rows of dataEmbedNN
+//----------------------------------------------------------------
+DataFrame<double> SimplexProjection( const Parameters  &param,
+                                     const DataEmbedNN &dataEmbedNN ) {
+    return SimplexProjection( param, dataEmbedNN, dataEmbedNN.neighbors );
+}
+
+//----------------------------------------------------------------
+// Simplex projection of the prediction rows with neighbors
+//----------------------------------------------------------------
+DataFrame<double> SimplexProjection( const Parameters  &param,
+                                     const DataEmbedNN &dataEmbedNN,
+                                     const Neighbors   &neighbors ) {
+
+    EDM_PROFILE_SCOPE( Projection );
+
+    const DataIO                &dio        = dataEmbedNN.dio;
+    const std::valarray<double> &target_vec = dataEmbedNN.targetVec;
+    const DataFrame<double>     &targets    = dataEmbedNN.targets;
+
+    size_t N_row = neighbors.neighbors.NRows();
 
     if ( N_row != neighbors.distances.NRows() ) {
         std::stringstream errMsg;
@@ -53,85 +146,96 @@ DataFrame<double> Simplex( std::string pathIn,
     }
 
     double minWeight = 1.E-6;
-    std::valarray<double> predictions( 0., N_row );
+    size_t N_targets = targets.NColumns();
+
+    // Prediction row for each target, accumulated as the weighted sum
+    // of the contiguous library target rows: an axpy per neighbor.
+    DataFrame<double> predictions( N_row, N_targets );
+
+    // Weight vector of a row, call scoped on the thread arena
+    ArenaScope          scope;
+    ArenaVector<double> weights( param.knn );
 
     // Process each prediction row in neighbors
     for ( size_t row = 0; row < N_row; row++ ) {
+        ReportProgress( "Simplex", row, N_row );
 
-        std::valarray<double> distanceRow = neighbors.distances.Row( row );
+        const double *distanceRow = &neighbors.distances( row, 0 );
         
         // Establish exponential weight reference, the 'distance scale'
-        double minDistance = distanceRow.min();
-
-        // Compute weight (vector) for each k_NN
-        std::valarray<double> weightedDistances( minWeight, param.knn );
-        
-        if ( minDistance == 0 ) {
-            // Handle cases of distanceRow = 0 : can't divide by minDistance
-            for ( size_t i = 0; i < param.knn; i++ ) {
-                if ( distanceRow[i] > 0 ) {
-                    weightedDistances[i] = exp( -distanceRow[i] / minDistance );
-                }
-                else {
-                    // Setting weight = 1 implies that the corresponding
-                    // library target vector is the same as the observation
-                    // so it will be given full-weight in the prediction.
-                    weightedDistances[i] = 1;
-                }
+        double minDistance = *std::min_element( distanceRow,
+                                                distanceRow + param.knn );
+
+        // Compute weight for each k_NN
+        for ( size_t i = 0; i < param.knn; i++ ) {
+            double weightedDistance;
+            if ( minDistance == 0 ) {
+                // Handle cases of distanceRow = 0 : can't divide by
+                // minDistance. Setting weight = 1 implies that the
+                // corresponding library target vector is the same as the
+                // observation so it will be given full-weight.
+                weightedDistance = distanceRow[i] > 0 ?
+                    exp( -distanceRow[i] / minDistance ) : 1;
             }
-        }
-        else {
-            // exp() is a valarray<> overload (vectorized?)
-            weightedDistances = exp( -distanceRow / minDistance );
+            else {
+                weightedDistance = exp( -distanceRow[i] / minDistance );
+            }
+            weights[i] = std::max( weightedDistance, minWeight );
         }
 
-        // weight vector
-        std::valarray<double> weights( param.knn );
-        for  ( size_t i = 0; i < param.knn; i++ ) {
-            weights[i] = std::max( weightedDistances[i], minWeight );
+        double sumWeights = 0;
+        for ( size_t i = 0; i < param.knn; i++ ) {
+            sumWeights += weights[i];
         }
 
-        // target library vector, one element for each knn
-        std::valarray<double> libTarget( param.knn );
-
         for ( size_t k = 0; k < param.knn; k++ ) {
-            double libRow = neighbors.neighbors( row, k ) + param.Tp;
+            size_t libRow = neighbors.neighbors( row, k ) + param.Tp;
 
-            if ( libRow > library_N_row ) {
+            if ( not param.library.Contains( libRow ) ) {
                 // The k_NN index + Tp is outside the library domain
                 // Can only happen if noNeighborLimit = true is used.
                 if ( param.verbose ) {
                     std::stringstream msg;
                     msg << "Simplex() in row " << row << " libRow " << libRow
                         << " exceeds library domain.\n";
-                    std::cout << msg.str();
+                    Message( msg.str() );
                 }
                 
                 // Use the neighbor at the 'base' of the trajectory
-                libTarget[ k ] = target_vec[ libRow - param.Tp ];
+                libRow = libRow - param.Tp;
             }
-            else {
-                libTarget[ k ] = target_vec[ libRow ];
+
+            // Accumulate weighted library projections of all targets
+            double        weight    = weights[ k ];
+            const double *libTarget = &targets( libRow, 0 );
+            double       *predRow   = &predictions( row, 0 );
+            for ( size_t t = 0; t < N_targets; t++ ) {
+                predRow[ t ] += weight * libTarget[ t ];
             }
         }
 
         // Prediction is average of weighted library projections
-        predictions[ row ] = ( weights * libTarget ).sum() / weights.sum();
+        for ( size_t t = 0; t < N_targets; t++ ) {
+            predictions( row, t ) = predictions( row, t ) / sumWeights;
+        }
         
     } // for ( row = 0; row < N_row; row++ )
 
+    ReportProgress( "Simplex", N_row, N_row );
+
     //----------------------------------------------------
     // Ouput
     //----------------------------------------------------
-    DataFrame<double> dataFrame = FormatOutput( param, N_row, predictions, 
-                                                dio.DFrame(), target_vec );
-
-    if ( param.predictOutputFile.size() ) {
-        // Write to disk, first embed in a DataIO object
-        DataIO dout( dataFrame );
-        dout.WriteData( param.pathOut, param.predictOutputFile );
+    DataFrame<double> dataFrame;
+    if ( N_targets == 1 ) {
+        dataFrame = FormatOutput( param, N_row, predictions.Column( 0 ),
+                                  dio.DFrame(), target_vec );
     }
-    
+    else {
+        dataFrame = FormatOutput( param, N_row, predictions,
+                                  dio.DFrame(), targets );
+    }
+
 #ifdef DEBUG_ALL
     std::cout << "Simplex -----------------------------------\n";
     std::cout << "time \tobserve \tpredict\n";
@@ -2,11 +2,21 @@
 #include "DataIO.h"
 #include "Neighbors.h"
 #include "Embed.h"
+#include "OnlineEDM.h"
+#include "Async.h"
+#include "CrossValidation.h"
+#include "Eval.h"
 
 //#define EMBED_TEST
 #define SIMPLEX_TEST1
 #define SIMPLEX_TEST2
 #define SMAP_TEST
+#define ONLINE_TEST
+#define ASYNC_TEST
+#define MEMORY_TEST
+#define NEIGHBOR_TEST
+#define CROSSVALIDATION_TEST
+#define MULTIRANGE_TEST
 
 //----------------------------------------------------------------
 // Intended to execute tests to validate the code.
@@ -103,6 +113,409 @@ int main( int argc, char *argv[] ) {
                   << "  MAE " << vesm.MAE << std::endl << std::endl;
 #endif
 
+#ifdef ONLINE_TEST
+        //----------------------------------------------------------
+        // OnlineSimplex : stream x_t, forecast Tp = 1 ahead
+        //----------------------------------------------------------
+        DataIO online_dio = DataIO( "../data/", "block_3sp.csv" );
+        std::valarray< double > time_vec =
+            online_dio.DFrame().VectorColumnName( "time" );
+        std::valarray< double > x_vec =
+            online_dio.DFrame().VectorColumnName( "x_t" );
+
+        OnlineSimplex onlineSimplex( 3, 1, 0, 1, 100 );
+        OnlineSMap    onlineSMap   ( 3, 1, 0, 1, 4., 100 );
+
+        size_t N_online = x_vec.size() - 101;
+        std::valarray< double > online_obs ( N_online );
+        std::valarray< double > online_pred( N_online );
+        std::valarray< double > smap_pred  ( N_online );
+
+        for ( size_t row = 0; row < x_vec.size() - 1; row++ ) {
+            std::valarray< double > x( x_vec[ row ], 1 );
+            double forecast = onlineSimplex.Append( time_vec[ row ], x );
+            double smap     = onlineSMap.Append   ( time_vec[ row ], x );
+            if ( row >= 100 ) {
+                online_obs [ row - 100 ] = x_vec[ row + 1 ];
+                online_pred[ row - 100 ] = forecast;
+                smap_pred  [ row - 100 ] = smap;
+            }
+        }
+
+        VectorError veo = ComputeError( online_obs, online_pred );
+        std::cout << "OnlineSimplex library " << onlineSimplex.LibrarySize()
+                  << " rho " << veo.rho << "  RMSE " << veo.RMSE
+                  << "  MAE " << veo.MAE << std::endl;
+
+        VectorError veos = ComputeError( online_obs, smap_pred );
+        std::cout << "OnlineSMap    library " << onlineSMap.LibrarySize()
+                  << " rho " << veos.rho << "  RMSE " << veos.RMSE
+                  << "  MAE " << veos.MAE << std::endl << std::endl;
+#endif
+
+#ifdef ASYNC_TEST
+        //----------------------------------------------------------
+        // SimplexAsync and SMapAsync on the shared pool, a cancelled job
+        //----------------------------------------------------------
+        std::atomic< size_t > progressCalls( 0 );
+        AsyncControl control(
+            [ &progressCalls ]( const std::string &, size_t, size_t ) {
+                progressCalls++; } );
+
+        std::future< DataFrame<double> > simplexFuture =
+            SimplexAsync( control, "../data/", "block_3sp.csv", "./", "",
+                          "1 100", "101 198", 3, 1, 0, 1,
+                          "x_t y_t z_t", "x_t", true, true );
+        std::future< SMapValues > smapFuture =
+            SMapAsync( control, "../data/", "block_3sp.csv", "./", "",
+                       "1 100", "101 198", 3, 1, 0, 1, 4.,
+                       "x_t y_t z_t", "x_t", "", "", true, true );
+
+        AsyncControl cancelled;
+        cancelled.Cancel();
+        std::future< DataFrame<double> > cancelledFuture =
+            SimplexAsync( cancelled, "../data/", "block_3sp.csv", "./", "",
+                          "1 100", "101 198", 3, 1, 0, 1,
+                          "x_t y_t z_t", "x_t", true, true );
+
+        DataFrame<double> asyncSimplex = simplexFuture.get();
+        VectorError vea = ComputeError(
+            asyncSimplex.VectorColumnName( "Observations" ),
+            asyncSimplex.VectorColumnName( "Predictions"  ) );
+        DataFrame<double> asyncSMap = smapFuture.get().predictions;
+        VectorError veas = ComputeError(
+            asyncSMap.VectorColumnName( "Observations" ),
+            asyncSMap.VectorColumnName( "Predictions"  ) );
+
+        std::cout << "SimplexAsync rho " << vea.rho << "  SMapAsync rho "
+                  << veas.rho << "  progress calls " << progressCalls
+                  << std::endl;
+
+        try {
+            cancelledFuture.get();
+            std::cout << "Cancelled job was not cancelled." << std::endl;
+            return -1;
+        }
+        catch ( const AsyncCancelled &e ) {
+            std::cout << "Cancelled job: " << e.what() << std::endl;
+        }
+#endif
+
+#ifdef MEMORY_TEST
+        //----------------------------------------------------------
+        // Simplex of a DataFrame in memory, and of an embedding
+        // block with its target: no file read or written
+        //----------------------------------------------------------
+        DataIO memory_dio = DataIO( "../data/", "block_3sp.csv" );
+        DataFrame< double > memoryFrame =
+            Simplex( memory_dio.DFrame(), "1 100", "101 198", 3, 1, 0, 1,
+                     "x_t y_t z_t", "x_t", true, false );
+
+        DataFrame< double > block =
+            memory_dio.DFrame().DataFrameFromColumnNames(
+                { "x_t", "y_t", "z_t" } );
+        DataFrame< double > blockFrame =
+            Simplex( block, memory_dio.DFrame().VectorColumnName( "x_t" ),
+                     "1 100", "101 198", 1, 0, false );
+
+        VectorError vem = ComputeError(
+            memoryFrame.VectorColumnName( "Observations" ),
+            memoryFrame.VectorColumnName( "Predictions"  ) );
+        VectorError veb = ComputeError(
+            blockFrame.VectorColumnName( "Observations" ),
+            blockFrame.VectorColumnName( "Predictions"  ) );
+
+        std::cout << "Simplex DataFrame rho " << vem.rho
+                  << "  block rho " << veb.rho << std::endl << std::endl;
+#endif
+
+#ifdef NEIGHBOR_TEST
+        //----------------------------------------------------------
+        // KDTree, VPTree and HNSW neighbors against brute force for
+        // each metric, pred inside lib with exclusionRadius 5. Brute
+        // force rows are not sorted: compare sorted distances.
+        // KDTree and VPTree are exact, HNSW reports its recall.
+        //----------------------------------------------------------
+        DataIO lorenz_dio = DataIO( "../data/", "LorenzData1000.csv" );
+        DataFrame< double > lorenzBlock =
+            Embed( lorenz_dio.DFrame(), 3, 1, "V1" );
+        DataFrame< float > lorenzFloatBlock =
+            MakeBlock< float >( lorenz_dio.DFrame(), 3, 1, { 1 }, { "V1" },
+                                false );
+
+        for ( std::string metric : { "euclidean", "manhattan", "chebyshev" } ) {
+            Parameters bruteParam;
+            bruteParam.Load( { "-m", "simplex", "-l", "1 600",
+                               "-p", "301 400", "-E", "3", "-k", "5",
+                               "-x", "5", "-d", metric } );
+            bruteParam.Validate();
+            Neighbors brute = FindNeighbors( lorenzBlock, bruteParam );
+
+            std::cout << "Neighbors " << metric;
+            for ( std::string algorithm : { "kdtree", "vptree", "hnsw" } ) {
+                Parameters param = bruteParam;
+                param.Load( { "-a", algorithm } );
+                param.Validate();
+                Neighbors nn = FindNeighbors( lorenzBlock, param );
+
+                size_t N_nn     = nn.neighbors.NRows() * param.knn;
+                size_t matched  = 0;
+                size_t excluded = 0;
+                for ( size_t row = 0; row < nn.neighbors.NRows(); row++ ) {
+                    int pred_row = param.prediction[ row ];
+                    std::valarray< double > nnRow = nn.distances.Row( row );
+                    std::valarray< double > bruteRow =
+                        brute.distances.Row( row );
+                    std::sort( std::begin( nnRow ),    std::end( nnRow ) );
+                    std::sort( std::begin( bruteRow ), std::end( bruteRow ) );
+
+                    for ( size_t k = 0; k < param.knn; k++ ) {
+                        if ( std::abs( nn.neighbors( row, k ) - pred_row ) <=
+                             param.exclusionRadius ) {
+                            excluded++;
+                        }
+                        if ( std::abs( nnRow[ k ] - bruteRow[ k ] ) < 1E-9 ) {
+                            matched++;
+                        }
+                    }
+                }
+                std::cout << "  " << algorithm << " " << matched
+                          << "/" << N_nn;
+
+                if ( excluded or
+                     ( algorithm != "hnsw" and matched != N_nn ) ) {
+                    std::cout << std::endl << algorithm << " " << metric
+                              << " differs from brute force, "
+                              << excluded << " excluded neighbors."
+                              << std::endl;
+                    return -1;
+                }
+            }
+
+            // Single precision block: brute force and KDTree agree,
+            // and agree with double to float rounding
+            Parameters floatParam = bruteParam;
+            Neighbors floatBrute = FindNeighbors( lorenzFloatBlock,
+                                                  floatParam );
+            floatParam.Load( { "-a", "kdtree" } );
+            floatParam.Validate();
+            Neighbors floatTree = FindNeighbors( lorenzFloatBlock,
+                                                 floatParam );
+
+            size_t N_float       = brute.neighbors.NRows() * bruteParam.knn;
+            size_t floatMatched  = 0;
+            for ( size_t row = 0; row < brute.neighbors.NRows(); row++ ) {
+                std::valarray< double > bruteRow = brute.distances.Row( row );
+                std::valarray< double > fBruteRow =
+                    floatBrute.distances.Row( row );
+                std::valarray< double > fTreeRow =
+                    floatTree.distances.Row( row );
+                std::sort( std::begin( bruteRow ),  std::end( bruteRow ) );
+                std::sort( std::begin( fBruteRow ), std::end( fBruteRow ) );
+                std::sort( std::begin( fTreeRow ),  std::end( fTreeRow ) );
+
+                for ( size_t k = 0; k < bruteParam.knn; k++ ) {
+                    if ( fTreeRow[ k ] == fBruteRow[ k ] and
+                         std::abs( fBruteRow[ k ] - bruteRow[ k ] ) < 1E-4 ) {
+                        floatMatched++;
+                    }
+                }
+            }
+            std::cout << "  float " << floatMatched << "/" << N_float;
+
+            if ( floatMatched != N_float ) {
+                std::cout << std::endl << "float " << metric
+                          << " differs from brute force." << std::endl;
+                return -1;
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+#endif
+
+#ifdef CROSSVALIDATION_TEST
+        //----------------------------------------------------------
+        // Leave one out CrossValidate on each neighbor backend: the
+        // exact backends agree. Eval of a Simplex grid, its E = 3
+        // row agrees with Simplex() to rounding, and of an S-Map grid
+        // with SMap().
+        //----------------------------------------------------------
+        std::vector< double > looRho;
+        for ( NeighborAlgorithm algorithm : { NeighborAlgorithm::BruteForce,
+                                              NeighborAlgorithm::KDTree,
+                                              NeighborAlgorithm::VPTree,
+                                              NeighborAlgorithm::HNSW } ) {
+            CrossValidationResult cv =
+                CrossValidate( "../data/", "LorenzData1000.csv", "1 500",
+                               3, 1, 0, 1, 0, "V1", "V1", false,
+                               Method::Simplex, 0, 5, algorithm );
+            looRho.push_back( cv.error.rho );
+        }
+        std::cout << "CrossValidate LOO rho BruteForce " << looRho[ 0 ]
+                  << "  KDTree " << looRho[ 1 ] << "  VPTree " << looRho[ 2 ]
+                  << "  HNSW " << looRho[ 3 ] << std::endl;
+
+        if ( looRho[ 1 ] != looRho[ 0 ] or looRho[ 2 ] != looRho[ 0 ] ) {
+            std::cout << "CrossValidate LOO differs across backends."
+                      << std::endl;
+            return -1;
+        }
+
+        EvalGrid grid;
+        grid.E = { 2, 3, 4 };
+        DataFrame< double > evalFrame =
+            Eval( "../data/", "LorenzData1000.csv", "1 400", "501 700",
+                  "V1", "V1", false, grid );
+
+        DataFrame< double > evalSimplex =
+            Simplex( "../data/", "LorenzData1000.csv", "./", "",
+                     "1 400", "501 700", 3, 1, 0, 1, "V1", "V1",
+                     false, false );
+        VectorError vev = ComputeError(
+            evalSimplex.VectorColumnName( "Observations" ),
+            evalSimplex.VectorColumnName( "Predictions"  ) );
+
+        double evalRho =
+            evalFrame( 1, evalFrame.ColumnNameToIndex()[ "rho" ] );
+        std::cout << "Eval E 3 rho " << evalRho << "  Simplex rho "
+                  << vev.rho << std::endl;
+
+        if ( std::abs( evalRho - vev.rho ) > 1E-12 ) {
+            std::cout << "Eval differs from Simplex()." << std::endl;
+            return -1;
+        }
+
+        // S-Map grid, knn 0 and 10 share one neighbor search
+        EvalGrid smapGrid;
+        smapGrid.E       = { 2 };
+        smapGrid.Tp      = { 3 };
+        smapGrid.knn     = { 0, 10 };
+        smapGrid.methods = { Method::SMap };
+        DataFrame< double > evalSMap =
+            Eval( "../data/", "LorenzData1000.csv", "1 400", "501 700",
+                  "V1", "V1", false, smapGrid );
+
+        for ( size_t row = 0; row < evalSMap.NRows(); row++ ) {
+            int knn = row ? 10 : 0;
+            SMapValues smapValues =
+                SMap( "../data/", "LorenzData1000.csv", "./", "",
+                      "1 400", "501 700", 2, 3, knn, 1, 0., "V1", "V1",
+                      "", "", false, false );
+            VectorError ves = ComputeError(
+                smapValues.predictions.VectorColumnName( "Observations" ),
+                smapValues.predictions.VectorColumnName( "Predictions"  ) );
+
+            double evalSMapRho =
+                evalSMap( row, evalSMap.ColumnNameToIndex()[ "rho" ] );
+            std::cout << "Eval S-Map knn " << knn << " rho " << evalSMapRho
+                      << "  SMap rho " << ves.rho << std::endl;
+
+            if ( std::abs( evalSMapRho - ves.rho ) > 1E-12 ) {
+                std::cout << "Eval differs from SMap()." << std::endl;
+                return -1;
+            }
+        }
+        std::cout << std::endl;
+#endif
+
+#ifdef MULTIRANGE_TEST
+        //----------------------------------------------------------
+        // Disjoint prediction ranges: the output of each range is
+        // the output of Simplex() of that range alone
+        //----------------------------------------------------------
+        DataFrame< double > multiRange =
+            Simplex( "../data/", "LorenzData1000.csv", "./", "",
+                     "1 400", "501 510 701 710", 3, 1, 0, 1, "V1", "V1",
+                     false, false );
+
+        size_t multiRow = 0;
+        for ( std::string range : { "501 510", "701 710" } ) {
+            DataFrame< double > singleRange =
+                Simplex( "../data/", "LorenzData1000.csv", "./", "",
+                         "1 400", range, 3, 1, 0, 1, "V1", "V1",
+                         false, false );
+
+            for ( size_t row = 0; row < singleRange.NRows(); row++ ) {
+                for ( size_t col = 0; col < 3; col++ ) {
+                    double single = singleRange( row, col );
+                    double multi  = multiRange( multiRow + row, col );
+                    bool bothNan = std::isnan( single ) and
+                                   std::isnan( multi );
+                    if ( single != multi and not bothNan ) {
+                        std::cout << "Multiple pred ranges differ from "
+                                  << range << " in row " << row << std::endl;
+                        return -1;
+                    }
+                }
+            }
+            multiRow += singleRange.NRows();
+        }
+
+        VectorError vemr = ComputeError(
+            multiRange.VectorColumnName( "Observations" ),
+            multiRange.VectorColumnName( "Predictions"  ) );
+        std::cout << "Simplex pred 501 510 701 710 rows "
+                  << multiRange.NRows() << " rho " << vemr.rho
+                  << "  RMSE " << vemr.RMSE << "  MAE " << vemr.MAE
+                  << std::endl << std::endl;
+#endif
+
+#ifdef EDM_PROFILE
+        //----------------------------------------------------------
+        // Built with -DEDM_PROFILE: the profile of Simplex() and
+        // SMap() in a ProfileRecorder has timed neighbor and
+        // projection stages, distance evaluations and SVD calls.
+        //----------------------------------------------------------
+        ProfileStats simplexProfile;
+        {
+            ProfileRecorder recorder;
+            Simplex( "../data/", "block_3sp.csv", "./", "",
+                     "1 100", "101 198", 3, 1, 0, 1,
+                     "x_t y_t z_t", "x_t", true, false );
+            simplexProfile = recorder.Stats();
+        }
+        ProfileStats smapProfile;
+        {
+            ProfileRecorder recorder;
+            SMap( "../data/", "block_3sp.csv", "./", "",
+                  "1 100", "101 198", 3, 1, 0, 1, 4.,
+                  "x_t y_t z_t", "x_t", "", "", true, false );
+            smapProfile = recorder.Stats();
+        }
+
+        auto Timed = []( const ProfileStats &stats, ProfileStage stage ) {
+            return stats.seconds[ (size_t) stage ] > 0 and
+                   stats.calls  [ (size_t) stage ] > 0;
+        };
+        auto Count = []( const ProfileStats &stats, ProfileCounter counter ) {
+            return stats.counters[ (size_t) counter ];
+        };
+
+        std::cout << "Profile Simplex distances "
+                  << Count( simplexProfile,
+                            ProfileCounter::DistanceEvaluations )
+                  << "  SMap distances "
+                  << Count( smapProfile, ProfileCounter::DistanceEvaluations )
+                  << "  SVD calls "
+                  << Count( smapProfile, ProfileCounter::SVDCalls )
+                  << std::endl << std::endl;
+
+        for ( const ProfileStats &stats : { simplexProfile, smapProfile } ) {
+            if ( not Timed( stats, ProfileStage::FindNeighbors ) or
+                 not Timed( stats, ProfileStage::Projection )    or
+                 not Count( stats, ProfileCounter::DistanceEvaluations ) ) {
+                std::cout << "Profile is missing a stage or counter:\n"
+                          << stats.JSON() << std::endl;
+                return -1;
+            }
+        }
+        if ( not Count( smapProfile, ProfileCounter::SVDCalls ) ) {
+            std::cout << "Profile of SMap() has no SVD calls:\n"
+                      << smapProfile.JSON() << std::endl;
+            return -1;
+        }
+#endif
+
     }
     
     catch ( const std::exception& e ) {
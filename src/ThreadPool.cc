@@ -0,0 +1,347 @@
+
+#include <cstdlib>
+
+#include "ThreadPool.h"
+
+namespace {
+    // Worker identity of the calling thread
+    thread_local int               workerIndex = -1;
+    thread_local const ThreadPool *workerPool  = nullptr;
+
+    // Shared pool, never replaced
+    std::mutex                    sharedMutex;
+    std::unique_ptr< ThreadPool > sharedPool;
+    size_t                        sharedThreads = 0; // 0 : default
+
+    //------------------------------------------------------------
+    // Workers of the shared pool for nThreads, 0 : default
+    //------------------------------------------------------------
+    size_t SharedPoolThreads( size_t nThreads ) {
+        if ( nThreads == 0 ) {
+            const char *env = std::getenv( "EDM_THREADS" );
+            nThreads = env ? std::strtoul( env, nullptr, 10 ) : 0;
+        }
+        if ( nThreads == 0 ) {
+            nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+        }
+        return nThreads;
+    }
+}
+
+//----------------------------------------------------------------
+// Constructor : start nThreads workers
+//----------------------------------------------------------------
+ThreadPool::ThreadPool( size_t nThreads ) :
+    nQueued( 0 ), nextQueue( 0 ), nPending( 0 ), stop( false )
+{
+    if ( nThreads == 0 ) {
+        nThreads = std::max( 1U, std::thread::hardware_concurrency() );
+    }
+
+    for ( size_t i = 0; i < nThreads; i++ ) {
+        queues.push_back( std::unique_ptr< WorkQueue >( new WorkQueue() ) );
+    }
+    for ( size_t i = 0; i < nThreads; i++ ) {
+        threads.push_back( std::thread( &ThreadPool::WorkerLoop, this, i ) );
+    }
+}
+
+//----------------------------------------------------------------
+// Destructor : finish queued tasks, join workers
+//----------------------------------------------------------------
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        stop = true;
+    }
+    wake.notify_all();
+
+    for ( auto &thread : threads ) {
+        thread.join();
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+void ThreadPool::Submit( std::function< void() > task ) {
+
+    size_t queue_i;
+    if ( workerPool == this ) {
+        queue_i = workerIndex;
+    }
+    else {
+        queue_i = nextQueue++ % queues.size();
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        nPending++;
+    }
+    {
+        std::lock_guard< std::mutex > lock( queues[ queue_i ]->mutex );
+        queues[ queue_i ]->tasks.push_back( std::move( task ) );
+        nQueued++;
+    }
+    {
+        // Lock so that a worker between its wait predicate check and
+        // its wait can not miss the notification
+        std::lock_guard< std::mutex > lock( mutex );
+    }
+    wake.notify_one();
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+void ThreadPool::Wait() {
+
+    std::unique_lock< std::mutex > lock( mutex );
+    done.wait( lock, [this]() { return nPending == 0; } );
+
+    if ( exception ) {
+        std::exception_ptr e = exception;
+        exception = nullptr;
+        std::rethrow_exception( e );
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+int ThreadPool::WorkerIndex() {
+    return workerIndex;
+}
+
+//----------------------------------------------------------------
+// Pop from the back of own queue, else steal from the front of others
+//----------------------------------------------------------------
+bool ThreadPool::PopTask( size_t self, std::function< void() > &task ) {
+
+    {
+        WorkQueue &own = *queues[ self ];
+        std::lock_guard< std::mutex > lock( own.mutex );
+        if ( own.tasks.size() ) {
+            task = std::move( own.tasks.back() );
+            own.tasks.pop_back();
+            nQueued--;
+            return true;
+        }
+    }
+
+    for ( size_t i = 1; i < queues.size(); i++ ) {
+        WorkQueue &other = *queues[ ( self + i ) % queues.size() ];
+        std::lock_guard< std::mutex > lock( other.mutex );
+        if ( other.tasks.size() ) {
+            task = std::move( other.tasks.front() );
+            other.tasks.pop_front();
+            nQueued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+void ThreadPool::RunTask( std::function< void() > &task ) {
+
+    try {
+        task();
+    }
+    catch ( ... ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( not exception ) {
+            exception = std::current_exception();
+        }
+    }
+
+    std::lock_guard< std::mutex > lock( mutex );
+    nPending--;
+    if ( nPending == 0 ) {
+        done.notify_all();
+    }
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+void ThreadPool::WorkerLoop( size_t self ) {
+
+    workerIndex = self;
+    workerPool  = this;
+
+    std::function< void() > task;
+
+    while ( true ) {
+        if ( PopTask( self, task ) ) {
+            RunTask( task );
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock< std::mutex > lock( mutex );
+        wake.wait( lock, [this]() { return stop or nQueued > 0; } );
+
+        if ( stop and nQueued == 0 ) {
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------
+// Shared pool
+//----------------------------------------------------------------
+ThreadPool &SharedThreadPool() {
+    std::lock_guard< std::mutex > lock( sharedMutex );
+    if ( not sharedPool ) {
+        size_t nThreads = SharedPoolThreads( sharedThreads );
+        sharedPool.reset( new ThreadPool( nThreads ) );
+    }
+    return *sharedPool;
+}
+
+bool SetSharedThreads( size_t nThreads ) {
+    std::lock_guard< std::mutex > lock( sharedMutex );
+    if ( sharedPool ) {
+        return sharedPool->NThreads() == SharedPoolThreads( nThreads );
+    }
+    sharedThreads = nThreads;
+    return true;
+}
+
+size_t SharedThreads() {
+    return SharedThreadPool().NThreads();
+}
+
+//----------------------------------------------------------------
+// TaskGroup
+//----------------------------------------------------------------
+TaskGroup::TaskGroup( size_t maxConcurrency ) :
+    TaskGroup( SharedThreadPool(), maxConcurrency ) {}
+
+TaskGroup::TaskGroup( ThreadPool &pool, size_t maxConcurrency ) :
+    pool( pool ), state( std::make_shared< State >() ),
+    concurrency( pool.NThreads() )
+{
+    if ( maxConcurrency and maxConcurrency < concurrency ) {
+        concurrency = maxConcurrency;
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        Wait();
+    }
+    catch ( ... ) {} // unobserved task exception
+}
+
+//----------------------------------------------------------------
+// Queue the task, post a runner if fewer than Concurrency() - 1 are
+// posted. The caller is the last thread of the group, in Wait().
+//----------------------------------------------------------------
+void TaskGroup::Submit( std::function< void() > task ) {
+
+#ifdef EDM_PROFILE
+    // Profile the task into the recorder of the submitter
+    ProfileSink *sink = ProfileCurrentSink();
+    if ( sink ) {
+        std::function< void() > profiledTask = std::move( task );
+        task = [ sink, profiledTask ]() {
+            ProfileSinkScope scope( sink );
+            profiledTask();
+        };
+    }
+#endif
+
+    bool post = false;
+    {
+        std::lock_guard< std::mutex > lock( state->mutex );
+        state->tasks.push_back( std::move( task ) );
+        state->nPending++;
+        if ( state->nRunners + 1 < concurrency and
+             state->nRunners < state->tasks.size() ) {
+            state->nRunners++;
+            post = true;
+        }
+    }
+    state->done.notify_all(); // Wait() of a task submitting a task
+
+    if ( post ) {
+        std::shared_ptr< State > runnerState = state;
+        pool.Submit( [ runnerState ]() { Runner( runnerState ); } );
+    }
+}
+
+//----------------------------------------------------------------
+// Run queued tasks of the group until none is pending.
+// A runner still queued in the pool finds the queue empty and exits.
+//----------------------------------------------------------------
+void TaskGroup::Wait() {
+
+    std::unique_lock< std::mutex > lock( state->mutex );
+
+    while ( true ) {
+        if ( state->tasks.size() ) {
+            std::function< void() > task = std::move( state->tasks.front() );
+            state->tasks.pop_front();
+            lock.unlock();
+            RunTask( *state, task );
+            lock.lock();
+            continue;
+        }
+        if ( state->nPending == 0 ) { break; }
+        state->done.wait( lock );
+    }
+
+    if ( state->exception ) {
+        std::exception_ptr e = state->exception;
+        state->exception = nullptr;
+        std::rethrow_exception( e );
+    }
+}
+
+//----------------------------------------------------------------
+size_t TaskGroup::ThreadSlot() const {
+    return workerPool == &pool ? workerIndex : pool.NThreads();
+}
+
+//----------------------------------------------------------------
+void TaskGroup::RunTask( State &state, std::function< void() > &task ) {
+
+    std::exception_ptr exception;
+    try {
+        task();
+    }
+    catch ( ... ) {
+        exception = std::current_exception();
+    }
+    task = nullptr; // release captures before the group may return
+
+    std::lock_guard< std::mutex > lock( state.mutex );
+    if ( exception and not state.exception ) {
+        state.exception = exception;
+    }
+    state.nPending--;
+    if ( state.nPending == 0 ) {
+        state.done.notify_all();
+    }
+}
+
+//----------------------------------------------------------------
+void TaskGroup::Runner( std::shared_ptr< State > state ) {
+
+    std::unique_lock< std::mutex > lock( state->mutex );
+
+    while ( state->tasks.size() ) {
+        std::function< void() > task = std::move( state->tasks.front() );
+        state->tasks.pop_front();
+        lock.unlock();
+        RunTask( *state, task );
+        lock.lock();
+    }
+
+    state->nRunners--;
+}
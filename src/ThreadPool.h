@@ -0,0 +1,140 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// ThreadPool class
+// Work stealing pool: each worker thread has its own task deque.
+// A worker pops tasks from the back of its own deque, and when that
+// is empty steals from the front of the other deques. Tasks
+// submitted by a worker go to its own deque, others are dealt
+// round-robin.
+//
+// The first exception thrown by a task is rethrown by Wait().
+//
+// Engines do not create pools: they run TaskGroups on the library
+// wide SharedThreadPool().
+//---------------------------------------------------------
+class ThreadPool {
+
+    struct WorkQueue {
+        std::deque< std::function< void() > > tasks;
+        std::mutex                            mutex;
+    };
+
+    std::vector< std::unique_ptr< WorkQueue > > queues;
+    std::vector< std::thread >                  threads;
+
+    std::mutex              mutex;      // guards nPending, stop, exception
+    std::condition_variable wake;       // tasks available or stop
+    std::condition_variable done;       // nPending reached 0
+    std::atomic< size_t >   nQueued;    // tasks in queues
+    std::atomic< size_t >   nextQueue;  // round-robin submit
+    size_t                  nPending;   // tasks submitted, not finished
+    bool                    stop;
+    std::exception_ptr      exception;
+
+    bool PopTask( size_t self, std::function< void() > &task );
+    void RunTask( std::function< void() > &task );
+    void WorkerLoop( size_t self );
+
+public:
+    // nThreads = 0 : std::thread::hardware_concurrency()
+    explicit ThreadPool( size_t nThreads = 0 );
+    ~ThreadPool();
+
+    void   Submit( std::function< void() > task );
+    void   Wait(); // Block until all submitted tasks have finished
+
+    size_t NThreads() const { return threads.size(); }
+
+    // Index of the calling worker thread in its pool, -1 if the
+    // caller is not a pool worker.
+    static int WorkerIndex();
+};
+
+//---------------------------------------------------------
+// Library wide pool shared by all engines, created on first use and
+// kept until the process exits: TaskGroups and pool tasks refer to
+// it, it is never replaced.
+//
+// SetSharedThreads( n ) sets the number of workers of the pool before
+// it is created, 0 : the EDM_THREADS environment variable, else all
+// cores. Once the pool exists the call has no effect and returns
+// false if n differs from its workers. SharedThreads() is the number
+// of workers, the pool is created if needed.
+//---------------------------------------------------------
+ThreadPool &SharedThreadPool();
+bool        SetSharedThreads( size_t nThreads );
+size_t      SharedThreads();
+
+//---------------------------------------------------------
+// TaskGroup class
+// Tasks of one parallel region run on a ThreadPool, the shared pool
+// by default, on at most Concurrency() threads including the caller.
+// Tasks are queued in the group; the group posts Concurrency() - 1
+// runner tasks to the pool that run group tasks until the queue is
+// empty, and Wait() runs group tasks on the calling thread.
+//
+// Since a waiting thread only runs tasks of its own group, groups
+// nest: a task that runs a TaskGroup (CCM library sizes calling a
+// parallel neighbor search) does not block its worker and starts
+// no threads, the inner tasks are run by the waiting worker and
+// stolen by idle workers.
+//
+// The first exception thrown by a task is rethrown by Wait().
+// The destructor waits for the tasks still queued or running.
+//---------------------------------------------------------
+class TaskGroup {
+
+    struct State {
+        std::deque< std::function< void() > > tasks;
+        std::mutex              mutex;
+        std::condition_variable done;     // nPending reached 0, or task
+        size_t                  nPending; // tasks submitted, not finished
+        size_t                  nRunners; // runners posted, not exited
+        std::exception_ptr      exception;
+
+        State() : nPending( 0 ), nRunners( 0 ) {}
+    };
+
+    ThreadPool              &pool;
+    std::shared_ptr< State > state;       // shared with the runners
+    size_t                   concurrency;
+
+    static void RunTask( State &state, std::function< void() > &task );
+    static void Runner ( std::shared_ptr< State > state );
+
+public:
+    // maxConcurrency = 0 : all threads of the pool
+    explicit TaskGroup( size_t maxConcurrency = 0 );
+    TaskGroup( ThreadPool &pool, size_t maxConcurrency = 0 );
+    ~TaskGroup();
+
+    TaskGroup( const TaskGroup & )            = delete;
+    TaskGroup &operator=( const TaskGroup & ) = delete;
+
+    void Submit( std::function< void() > task );
+    void Wait();
+
+    size_t Concurrency() const { return concurrency; }
+
+    // Index in [ 0, Slots() ) of the calling thread among the threads
+    // that run the group tasks: the pool workers and the caller. For
+    // per thread buffers of the tasks.
+    size_t Slots()      const { return pool.NThreads() + 1; }
+    size_t ThreadSlot() const;
+};
+
+#endif
@@ -0,0 +1,186 @@
+
+#include <algorithm>
+#include <numeric>
+
+#include "VPTree.h"
+#include "Neighbors.h"
+
+//----------------------------------------------------------------
+// Constructor
+//----------------------------------------------------------------
+template< class T >
+VPTree< T >::VPTree( size_t dim, DistanceMetric metric, unsigned seed ) :
+    dim( dim ), metric( metric ), root( -1 ), generator( seed ) {}
+
+//----------------------------------------------------------------
+// Build the tree from points (N x dim, row-major) and ids
+//----------------------------------------------------------------
+template< class T >
+void VPTree< T >::Build( const std::vector<T>      &points,
+                         const std::vector<size_t> &ids ) {
+
+    if ( dim == 0 or points.size() != ids.size() * dim ) {
+        std::stringstream errMsg;
+        errMsg << "VPTree::Build(): " << points.size() << " coordinates "
+               << "do not match " << ids.size() << " ids of dimension "
+               << dim << ".\n";
+        throw std::runtime_error( errMsg.str() );
+    }
+
+    Clear();
+
+    nodes.reserve ( ids.size() );
+    coords.reserve( points.size() );
+
+    std::vector<int> order( ids.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::vector<double> distances( ids.size() );
+
+    root = BuildRange( points, ids, order, distances, 0, order.size() );
+}
+
+//----------------------------------------------------------------
+// Recursive build of order[begin, end): a random vantage point,
+// the remaining points split at their median distance to it.
+// Returns the index of the subtree root in nodes.
+//----------------------------------------------------------------
+template< class T >
+int VPTree< T >::BuildRange( const std::vector<T>      &points,
+                             const std::vector<size_t> &ids,
+                             std::vector<int>          &order,
+                             std::vector<double>       &distances,
+                             size_t                     begin,
+                             size_t                     end ) {
+
+    if ( begin >= end ) { return -1; }
+
+    // Vantage point to the front of the range
+    std::uniform_int_distribution< size_t > pick( begin, end - 1 );
+    std::swap( order[ begin ], order[ pick( generator ) ] );
+
+    int           vp   = order[ begin ];
+    const T      *vpX  = &points[ vp * dim ];
+    int           node = nodes.size();
+
+    nodes.push_back( Node{ ids[ vp ], 0, -1, -1 } );
+    coords.insert( coords.end(), vpX, vpX + dim );
+
+    if ( end - begin == 1 ) { return node; }
+
+    for ( size_t i = begin + 1; i < end; i++ ) {
+        distances[ order[ i ] ] = Distance( vpX, &points[ order[ i ] * dim ],
+                                            dim, metric );
+    }
+
+    size_t mid = begin + 1 + ( end - begin - 1 ) / 2;
+    std::nth_element( order.begin() + begin + 1, order.begin() + mid,
+                      order.begin() + end,
+                      [&distances]( int a, int b ) {
+                          return distances[ a ] < distances[ b ]; } );
+
+    nodes[ node ].mu = distances[ order[ mid ] ];
+
+    int inside  = BuildRange( points, ids, order, distances, begin + 1, mid );
+    int outside = BuildRange( points, ids, order, distances, mid,       end );
+
+    nodes[ node ].inside  = inside;
+    nodes[ node ].outside = outside;
+
+    return node;
+}
+
+//----------------------------------------------------------------
+//
+//----------------------------------------------------------------
+template< class T >
+void VPTree< T >::Clear() {
+    nodes.clear();
+    coords.clear();
+    root = -1;
+}
+
+//----------------------------------------------------------------
+// k nearest neighbors of point
+//----------------------------------------------------------------
+template< class T >
+void VPTree< T >::Query(
+    const T                               *point,
+    size_t                                 knn,
+    const std::function< bool( size_t ) > &accept,
+    std::vector< size_t >                 &neighborIds,
+    std::vector< double >                 &neighborDistances )
+    const {
+
+    // max-heap of ( distance, id ) : top is the current k-th neighbor
+    std::vector< std::pair< double, size_t > > heap;
+    heap.reserve( knn + 1 );
+
+    if ( knn > 0 ) {
+        Search( root, point, knn, accept, heap );
+    }
+
+    std::sort_heap( heap.begin(), heap.end() );
+
+    neighborIds.resize      ( heap.size() );
+    neighborDistances.resize( heap.size() );
+    for ( size_t i = 0; i < heap.size(); i++ ) {
+        neighborDistances[ i ] = heap[ i ].first;
+        neighborIds      [ i ] = heap[ i ].second;
+    }
+}
+
+//----------------------------------------------------------------
+// Depth first search, the side of mu holding the query first.
+// With d the distance from the query to the vantage point and
+// r the current k-th neighbor distance, the inside subtree can
+// only hold a closer point if d - r < mu, the outside subtree
+// if d + r >= mu.
+//----------------------------------------------------------------
+template< class T >
+void VPTree< T >::Search(
+    int                                    node_i,
+    const T                               *point,
+    size_t                                 knn,
+    const std::function< bool( size_t ) > &accept,
+    std::vector< std::pair< double, size_t > > &heap ) const {
+
+    if ( node_i < 0 ) { return; }
+
+    const Node &node = nodes[ node_i ];
+    double      d    = Distance( point, &coords[ node_i * dim ], dim, metric );
+
+    if ( accept( node.id ) ) {
+        if ( heap.size() < knn ) {
+            heap.push_back( std::make_pair( d, node.id ) );
+            std::push_heap( heap.begin(), heap.end() );
+        }
+        else if ( d < heap.front().first ) {
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = std::make_pair( d, node.id );
+            std::push_heap( heap.begin(), heap.end() );
+        }
+    }
+
+    if ( d < node.mu ) {
+        Search( node.inside, point, knn, accept, heap );
+        if ( heap.size() < knn or d + heap.front().first >= node.mu ) {
+            Search( node.outside, point, knn, accept, heap );
+        }
+        else if ( node.outside >= 0 ) {
+            EDM_PROFILE_COUNT( CandidatesPruned, 1 );
+        }
+    }
+    else {
+        Search( node.outside, point, knn, accept, heap );
+        if ( heap.size() < knn or d - heap.front().first < node.mu ) {
+            Search( node.inside, point, knn, accept, heap );
+        }
+        else if ( node.inside >= 0 ) {
+            EDM_PROFILE_COUNT( CandidatesPruned, 1 );
+        }
+    }
+}
+
+// Coordinate types of the neighbor indices
+template class VPTree< double >;
+template class VPTree< float  >;
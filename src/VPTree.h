@@ -0,0 +1,78 @@
+#ifndef VPTREE_H
+#define VPTREE_H
+
+#include <functional>
+#include <random>
+
+#include "Common.h"
+
+//---------------------------------------------------------
+// VPTree class
+// Vantage point tree (metric tree) for exact k nearest neighbors
+// under any true metric of Distance(): Euclidean, Manhattan,
+// Chebyshev.
+//
+// Each node holds a vantage point and the median distance mu of
+// the points below it to the vantage point: points with distance
+// < mu are in the inside subtree, the others in the outside subtree.
+// The triangle inequality bounds the distance from a query to any
+// point of a subtree, subtrees that can not hold a point closer
+// than the current k-th neighbor are pruned.
+//
+// Point coordinates of type T (double or float) are held in a single
+// contiguous vector, each point tagged with a caller supplied id
+// (typically a data row index). Distances are returned as double.
+//---------------------------------------------------------
+template< class T >
+class VPTree {
+
+    struct Node {
+        size_t id;      // caller id of the vantage point
+        double mu;      // median distance of the subtree points
+        int    inside;  // node index, -1 if none
+        int    outside; // node index, -1 if none
+    };
+
+    size_t              dim;
+    DistanceMetric      metric;
+    std::vector<Node>   nodes;
+    std::vector<T>      coords;   // nodes[i] point at coords[ i * dim ]
+    int                 root;
+    std::mt19937        generator;
+
+    int  BuildRange( const std::vector<T>      &points,
+                     const std::vector<size_t> &ids,
+                     std::vector<int>          &order,
+                     std::vector<double>       &distances,
+                     size_t begin, size_t end );
+
+    void Search( int node, const T *point, size_t knn,
+                 const std::function< bool( size_t ) > &accept,
+                 std::vector< std::pair< double, size_t > > &heap ) const;
+
+public:
+    VPTree( size_t         dim    = 0,
+            DistanceMetric metric = DistanceMetric::Euclidean,
+            unsigned       seed   = 0 );
+
+    // Replace the tree with points (row-major, N x dim) tagged by ids
+    void Build( const std::vector<T>      &points,
+                const std::vector<size_t> &ids );
+
+    void Clear();
+
+    // k nearest neighbors of point among ids for which accept(id)
+    // is true. Results are sorted by increasing distance.
+    void Query( const T                             *point,
+                size_t                               knn,
+                const std::function< bool( size_t ) > &accept,
+                std::vector< size_t >               &neighborIds,
+                std::vector< double >               &neighborDistances ) const;
+
+    // Accessors
+    size_t         Size()      const { return nodes.size(); }
+    size_t         Dimension() const { return dim;    }
+    DistanceMetric Metric()    const { return metric; }
+};
+
+#endif
@@ -0,0 +1,9 @@
+
+#include "Interface.h"
+
+//----------------------------------------------------------------
+// edm command line executable: see Interface.h
+//----------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+    return Interface( argc, argv );
+}